@@ -0,0 +1,1377 @@
+#include "Kr/KrMedia.h"
+#include "Kr/KrMath.h"
+#include "Kr/KrArray.h"
+#include "Kr/KrString.h"
+#include "Kr/KrLog.h"
+
+#include "Benchmark.h"
+#include "KrSpatialHash.h"
+#include "KrEdgeColoring.h"
+#include "Render2dSoftware.h"
+#include "Jobs.h"
+
+#include <stdio.h>
+
+struct Benchmark_Options {
+	bool update_golden = false;
+};
+
+struct Benchmark_Random {
+	uint64_t state = 0x9e3779b97f4a7c15ull;
+
+	uint32_t Next() {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return (uint32_t)(state >> 32);
+	}
+
+	float NextFloat(float min, float max) {
+		return min + (max - min) * ((float)(Next() >> 8) / (float)(1u << 24));
+	}
+};
+
+struct Benchmark_Timer {
+	uint64_t start;
+	float    frequency;
+
+	Benchmark_Timer() {
+		frequency = (float)PL_GetPerformanceFrequency();
+		start     = PL_GetPerformanceCounter();
+	}
+
+	float ElapsedMs() const {
+		uint64_t counts = PL_GetPerformanceCounter() - start;
+		return (1000.0f * (float)counts) / frequency;
+	}
+};
+
+//
+// Spatial hash
+//
+
+static uint32_t LinearNearest(const Vec2 *points, uint32_t count, Vec2 p) {
+	float best2     = LengthSq(points[0] - p);
+	uint32_t result = 0;
+	for (uint32_t index = 1; index < count; ++index) {
+		float d2 = LengthSq(points[index] - p);
+		if (d2 < best2) {
+			best2  = d2;
+			result = index;
+		}
+	}
+	return result;
+}
+
+static bool BenchmarkSpatialHash(const Benchmark_Options &options) {
+	constexpr uint32_t POINT_COUNT = 100000;
+	constexpr uint32_t QUERY_COUNT = 1000;
+	constexpr float    RADIUS      = 0.1f;
+	constexpr float    EXTENT      = 100.0f;
+
+	Array<Vec2> points;
+	Resize(&points, POINT_COUNT);
+	Defer{ Free(&points); };
+
+	Benchmark_Random random;
+	for (Vec2 &p : points)
+		p = Vec2(random.NextFloat(-EXTENT, EXTENT), random.NextFloat(-EXTENT, EXTENT));
+
+	Vec2 queries[QUERY_COUNT];
+	for (Vec2 &q : queries)
+		q = Vec2(random.NextFloat(-EXTENT, EXTENT), random.NextFloat(-EXTENT, EXTENT));
+
+	Spatial_Hash hash;
+	Defer{ FreeSpatialHash(&hash); };
+
+	Benchmark_Timer build_timer;
+	BuildSpatialHash(&hash, points.data, POINT_COUNT, 2.0f * RADIUS);
+	float build_ms = build_timer.ElapsedMs();
+
+	uint32_t linear_result = 0;
+	Benchmark_Timer linear_timer;
+	for (Vec2 q : queries)
+		linear_result += LinearNearest(points.data, POINT_COUNT, q);
+	float linear_ms = linear_timer.ElapsedMs();
+
+	uint32_t hash_result = 0, mismatches = 0;
+	Benchmark_Timer hash_timer;
+	for (Vec2 q : queries) {
+		uint32_t index; float dist;
+		if (QueryNearestPoint(hash, q, 2.0f * EXTENT, &index, &dist))
+			hash_result += index;
+	}
+	float hash_ms = hash_timer.ElapsedMs();
+
+	if (hash_result != linear_result) {
+		for (Vec2 q : queries) {
+			uint32_t index; float dist;
+			QueryNearestPoint(hash, q, 2.0f * EXTENT, &index, &dist);
+			uint32_t expected = LinearNearest(points.data, POINT_COUNT, q);
+			if (index != expected && LengthSq(points[index] - q) != LengthSq(points[expected] - q))
+				mismatches += 1;
+		}
+	}
+
+	Array<Spatial_Pair> pairs;
+	Defer{ Free(&pairs); };
+
+	Benchmark_Timer pairs_timer;
+	QueryPairs(hash, 2.0f * RADIUS, &pairs);
+	float pairs_ms = pairs_timer.ElapsedMs();
+
+	LogInfo("[Benchmark] Spatial hash: % points, build % ms", POINT_COUNT, build_ms);
+	LogInfo("[Benchmark] Nearest x%: linear % ms, hash % ms (% mismatches)", QUERY_COUNT, linear_ms, hash_ms, mismatches);
+	LogInfo("[Benchmark] Pairs: % pairs in % ms", pairs.count, pairs_ms);
+
+	return mismatches == 0;
+}
+
+//
+// Force batches
+//
+
+struct Benchmark_Cloth {
+	Array<Vec2>  x;
+	Array<Vec2>  v;
+	Array<Vec2>  force;
+	Array<Edge>  springs;
+	Array<float> rest;
+};
+
+struct Benchmark_Spring_Batch {
+	Benchmark_Cloth *cloth;
+	const uint32_t * springs;
+};
+
+// Same bungee as the rope forces of the simulation
+static void GenerateClothSprings(void *data, uint32_t first, uint32_t last, uint32_t thread) {
+	Benchmark_Spring_Batch *batch = (Benchmark_Spring_Batch *)data;
+	Benchmark_Cloth *cloth        = batch->cloth;
+
+	for (uint32_t index = first; index < last; ++index) {
+		uint32_t spring = batch->springs[index];
+		uint32_t i      = cloth->springs[spring].i;
+		uint32_t j      = cloth->springs[spring].j;
+
+		float dist = Distance(cloth->x[i], cloth->x[j]);
+		if (dist <= cloth->rest[spring]) continue;
+
+		Vec2 f = -0.5f * (dist - cloth->rest[spring]) * NormalizeZ(cloth->x[i] - cloth->x[j]) - 0.1f * (cloth->v[i] - cloth->v[j]);
+		cloth->force[i] += f;
+		cloth->force[j] -= f;
+	}
+}
+
+// Every color batch is split into "ranges" ranges, so at most that many threads generate it
+static void GenerateClothForces(Benchmark_Cloth *cloth, const Edge_Coloring &coloring, uint32_t ranges) {
+	memset(cloth->force.data, 0, sizeof(Vec2) * cloth->force.count);
+
+	Benchmark_Spring_Batch batch = { cloth, nullptr };
+
+	uint32_t color_count = (uint32_t)coloring.batches.count - 1;
+	for (uint32_t color = 0; color < color_count; ++color) {
+		uint32_t first = coloring.batches[color];
+		uint32_t count = coloring.batches[color + 1] - first;
+
+		batch.springs = coloring.order.data + first;
+		J_ParallelFor(count, (count + ranges - 1) / ranges, GenerateClothSprings, &batch);
+	}
+
+	batch.springs = coloring.reduction.data;
+	GenerateClothSprings(&batch, 0, (uint32_t)coloring.reduction.count, 0);
+}
+
+// Cloth with structural and shear springs, far larger than the simulation so every color batch
+// is split across all the threads, the forces must match the serial generation exactly
+static bool BenchmarkForceBatches(const Benchmark_Options &options) {
+	constexpr uint32_t CLOTH_SIZE = 256;
+	constexpr int      ITERATIONS = 16;
+
+	Benchmark_Cloth cloth;
+	Defer{ Free(&cloth.x); Free(&cloth.v); Free(&cloth.force); Free(&cloth.springs); Free(&cloth.rest); };
+
+	Resize(&cloth.x, CLOTH_SIZE * CLOTH_SIZE);
+	Resize(&cloth.v, CLOTH_SIZE * CLOTH_SIZE);
+	Resize(&cloth.force, CLOTH_SIZE * CLOTH_SIZE);
+
+	Benchmark_Random random;
+	for (uint32_t y = 0; y < CLOTH_SIZE; ++y) {
+		for (uint32_t x = 0; x < CLOTH_SIZE; ++x) {
+			cloth.x[y * CLOTH_SIZE + x] = Vec2((float)x, (float)y) * 1.1f + Vec2(random.NextFloat(-0.05f, 0.05f), random.NextFloat(-0.05f, 0.05f));
+			cloth.v[y * CLOTH_SIZE + x] = Vec2(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+		}
+	}
+
+	for (uint32_t y = 0; y < CLOTH_SIZE; ++y) {
+		for (uint32_t x = 0; x < CLOTH_SIZE; ++x) {
+			uint32_t i = y * CLOTH_SIZE + x;
+			if (x + 1 < CLOTH_SIZE) Append(&cloth.springs, Edge{ i, i + 1 });
+			if (y + 1 < CLOTH_SIZE) Append(&cloth.springs, Edge{ i, i + CLOTH_SIZE });
+			if (x + 1 < CLOTH_SIZE && y + 1 < CLOTH_SIZE) Append(&cloth.springs, Edge{ i, i + CLOTH_SIZE + 1 });
+			if (x > 0 && y + 1 < CLOTH_SIZE) Append(&cloth.springs, Edge{ i, i + CLOTH_SIZE - 1 });
+		}
+	}
+
+	Resize(&cloth.rest, cloth.springs.count);
+	for (ptrdiff_t index = 0; index < cloth.springs.count; ++index)
+		cloth.rest[index] = Distance(Vec2((float)(cloth.springs[index].i % CLOTH_SIZE), (float)(cloth.springs[index].i / CLOTH_SIZE)),
+			Vec2((float)(cloth.springs[index].j % CLOTH_SIZE), (float)(cloth.springs[index].j / CLOTH_SIZE)));
+
+	Edge_Coloring coloring;
+	Defer{ FreeEdgeColoring(&coloring); };
+
+	Benchmark_Timer color_timer;
+	ColorEdges(&coloring, cloth.springs.data, (uint32_t)cloth.springs.count, (uint32_t)cloth.x.count);
+	float color_ms = color_timer.ElapsedMs();
+
+	uint32_t color_count = (uint32_t)coloring.batches.count - 1;
+	uint32_t smallest    = UINT32_MAX;
+	for (uint32_t color = 0; color < color_count; ++color)
+		smallest = Min(smallest, coloring.batches[color + 1] - coloring.batches[color]);
+
+	LogInfo("[Benchmark] Force batches: % springs, % colors (smallest batch %), % in the reduction, coloring % ms",
+		cloth.springs.count, color_count, smallest, coloring.reduction.count, color_ms);
+
+	Array<Vec2> serial;
+	Defer{ Free(&serial); };
+
+	GenerateClothForces(&cloth, coloring, 1);
+	Resize(&serial, cloth.force.count);
+	memcpy(serial.data, cloth.force.data, sizeof(Vec2) * cloth.force.count);
+
+	bool  matched   = true;
+	float serial_ms = 0.0f;
+
+	uint32_t threads = J_ThreadCount();
+
+	for (uint32_t ranges = 1;; ranges = Min(2 * ranges, threads)) {
+		Benchmark_Timer timer;
+		for (int iteration = 0; iteration < ITERATIONS; ++iteration)
+			GenerateClothForces(&cloth, coloring, ranges);
+		float ms = timer.ElapsedMs() / ITERATIONS;
+
+		if (ranges == 1)
+			serial_ms = ms;
+
+		if (memcmp(serial.data, cloth.force.data, sizeof(Vec2) * cloth.force.count) != 0) {
+			LogError("[Benchmark] Forces generated with % ranges per batch differ from the serial forces", ranges);
+			matched = false;
+		}
+
+		LogInfo("[Benchmark] Force batches: % ranges per batch, % ms, % x", ranges, ms, ms > 0.0f ? serial_ms / ms : 0.0f);
+
+		if (ranges == threads)
+			break;
+	}
+
+	return matched;
+}
+
+//
+// Render2d
+//
+
+static constexpr uint32_t RENDER_BENCHMARK_WIDTH  = 640;
+static constexpr uint32_t RENDER_BENCHMARK_HEIGHT = 480;
+static constexpr int      RENDER_BENCHMARK_FRAMES = 8;
+static constexpr int      RENDER_TEXTURE_COUNT    = 8;
+static constexpr int      RENDER_CONTEXT_COUNT    = 16;
+
+// Maximum per channel difference before a pixel counts as mismatched against the golden image
+static constexpr int      GOLDEN_TOLERANCE        = 2;
+
+struct Benchmark_Render_Stats {
+	uint64_t draw_calls;
+	uint64_t vertex_bytes;
+	uint64_t index_bytes;
+	uint64_t instance_bytes;
+	uint64_t draw_data_bytes;
+};
+
+// Counts everything R_FinishFrame submits and only forwards the draws to the
+// software backend when a frame has to be rasterized for the golden image
+struct Benchmark_Recorder {
+	R_Backend2d            backend;
+	R_Backend2d *          target;
+	bool                   forward;
+	Benchmark_Render_Stats stats;
+};
+
+struct Benchmark_Render_Resources {
+	R_Texture *   textures[RENDER_TEXTURE_COUNT];
+	R_Renderer2d *contexts[RENDER_CONTEXT_COUNT];
+	R_Mesh2d *    mesh;
+};
+
+typedef void(*Benchmark_Render_Proc)(R_Renderer2d *r2, const Benchmark_Render_Resources &resources);
+
+static R_Texture *RecorderCreateTexture(R_Backend2d *backend, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	return recorder->target->CreateTexture(recorder->target, w, h, n, pixels);
+}
+
+static R_Texture *RecorderCreateTextureSRGBA(R_Backend2d *backend, uint32_t w, uint32_t h, const uint8_t *pixels) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	return recorder->target->CreateTextureSRGBA(recorder->target, w, h, pixels);
+}
+
+static void RecorderDestroyTexture(R_Backend2d *backend, R_Texture *texture) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->target->DestroyTexture(recorder->target, texture);
+}
+
+static R_Font *RecorderCreateFont(R_Backend2d *backend, const R_Font_Config &config, float height_in_pixels) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	return recorder->target->CreateFont(recorder->target, config, height_in_pixels);
+}
+
+static void RecorderDestroyFont(R_Backend2d *backend, R_Font *font) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->target->DestroyFont(recorder->target, font);
+}
+
+static R_Geometry *RecorderCreateGeometry(R_Backend2d *backend, const R_Vertex2d *vertices, uint32_t vertex_count, const R_Index2d *indices, uint32_t index_count) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	return recorder->target->CreateGeometry(recorder->target, vertices, vertex_count, indices, index_count);
+}
+
+static void RecorderDestroyGeometry(R_Backend2d *backend, R_Geometry *geometry) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->target->DestroyGeometry(recorder->target, geometry);
+}
+
+static bool RecorderUploadVertexData(R_Backend2d *backend, void *context, void *ptr, uint32_t size) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->stats.vertex_bytes += size;
+	return recorder->forward ? recorder->target->UploadVertexData(recorder->target, context, ptr, size) : true;
+}
+
+static bool RecorderUploadIndexData(R_Backend2d *backend, void *context, void *ptr, uint32_t size) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->stats.index_bytes += size;
+	return recorder->forward ? recorder->target->UploadIndexData(recorder->target, context, ptr, size) : true;
+}
+
+static bool RecorderUploadInstanceData(R_Backend2d *backend, void *context, void *ptr, uint32_t size) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->stats.instance_bytes += size;
+	return recorder->forward ? recorder->target->UploadInstanceData(recorder->target, context, ptr, size) : true;
+}
+
+static void RecorderUploadDrawData(R_Backend2d *backend, void *context, const R_Backend2d_Draw_Data &draw_data) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->stats.draw_data_bytes += sizeof(draw_data);
+	if (recorder->forward) recorder->target->UploadDrawData(recorder->target, context, draw_data);
+}
+
+static void RecorderSetPipeline(R_Backend2d *backend, void *context, R_Pipeline *pipeline) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	if (recorder->forward) recorder->target->SetPipeline(recorder->target, context, pipeline);
+}
+
+static void RecorderSetScissor(R_Backend2d *backend, void *context, R_Rect rect) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	if (recorder->forward) recorder->target->SetScissor(recorder->target, context, rect);
+}
+
+static void RecorderSetTexture(R_Backend2d *backend, void *context, R_Texture *texture) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	if (recorder->forward) recorder->target->SetTexture(recorder->target, context, texture);
+}
+
+static void RecorderSetGeometry(R_Backend2d *backend, void *context, R_Geometry *geometry) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	if (recorder->forward) recorder->target->SetGeometry(recorder->target, context, geometry);
+}
+
+static void RecorderDrawTriangleList(R_Backend2d *backend, void *context, uint32_t index_count, uint32_t index_offset, int32_t vertex_offset) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->stats.draw_calls += 1;
+	if (recorder->forward) recorder->target->DrawTriangleList(recorder->target, context, index_count, index_offset, vertex_offset);
+}
+
+static void RecorderDrawInstancedQuads(R_Backend2d *backend, void *context, uint32_t instance_count, uint32_t instance_offset) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->stats.draw_calls += 1;
+	if (recorder->forward) recorder->target->DrawInstancedQuads(recorder->target, context, instance_count, instance_offset);
+}
+
+static void RecorderDrawInstancedShapes(R_Backend2d *backend, void *context, uint32_t instance_count, uint32_t instance_offset) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->stats.draw_calls += 1;
+	if (recorder->forward) recorder->target->DrawInstancedShapes(recorder->target, context, instance_count, instance_offset);
+}
+
+static void RecorderRelease(R_Backend2d *backend) {
+	Benchmark_Recorder *recorder = (Benchmark_Recorder *)backend;
+	recorder->target->Release(recorder->target);
+}
+
+static bool WriteImagePPM(const char *path, const uint8_t *pixels, uint32_t w, uint32_t h) {
+	FILE *fp = nullptr;
+#if defined(_MSC_VER)
+	fopen_s(&fp, path, "wb");
+#else
+	fp = fopen(path, "wb");
+#endif
+	if (!fp) {
+		LogError("[Benchmark] Failed to open % for writing", path);
+		return false;
+	}
+
+	fprintf(fp, "P6\n%u %u\n255\n", w, h);
+	for (uint32_t index = 0; index < w * h; ++index) {
+		fwrite(pixels + index * 4, 1, 3, fp);
+	}
+
+	bool result = !ferror(fp);
+	fclose(fp);
+
+	return result;
+}
+
+static bool ParseImageValue(String *content, uint32_t *value) {
+	while (content->count && (content->data[0] == ' ' || content->data[0] == '\n' || content->data[0] == '\r')) {
+		content->data += 1;
+		content->count -= 1;
+	}
+
+	if (!content->count || content->data[0] < '0' || content->data[0] > '9')
+		return false;
+
+	*value = 0;
+	while (content->count && content->data[0] >= '0' && content->data[0] <= '9') {
+		*value = *value * 10 + (content->data[0] - '0');
+		content->data += 1;
+		content->count -= 1;
+	}
+
+	return true;
+}
+
+static bool CompareGoldenImage(const Benchmark_Options &options, const char *name, const uint8_t *pixels, uint32_t w, uint32_t h) {
+	char path[256];
+	snprintf(path, sizeof(path), "Golden/Render2d/%s.ppm", name);
+
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	if (options.update_golden) {
+		if (!WriteImagePPM(path, pixels, w, h))
+			return false;
+		LogInfo("[Benchmark] Written golden image %", path);
+		return true;
+	}
+
+	String content = PL_ReadEntireFile(String(path), M_GetArenaAllocator(arena));
+
+	if (content.count == 0) {
+		LogError("[Benchmark] Golden image % is missing, run with --update-golden to write it", path);
+		return false;
+	}
+
+	uint32_t golden_w = 0, golden_h = 0, golden_max = 0;
+
+	bool valid = content.count > 2 && content.data[0] == 'P' && content.data[1] == '6';
+	if (valid) {
+		content.data += 2;
+		content.count -= 2;
+		valid = ParseImageValue(&content, &golden_w) && ParseImageValue(&content, &golden_h) && ParseImageValue(&content, &golden_max);
+	}
+
+	// Single whitespace after the header
+	valid = valid && golden_max == 255 && content.count == (ptrdiff_t)golden_w * golden_h * 3 + 1;
+
+	if (!valid) {
+		LogError("[Benchmark] Golden image % is not a valid binary PPM", path);
+		return false;
+	}
+
+	if (golden_w != w || golden_h != h) {
+		LogError("[Benchmark] Golden image % is %x%, rendered %x%", path, golden_w, golden_h, w, h);
+		return false;
+	}
+
+	const uint8_t *golden = content.data + 1;
+
+	uint32_t mismatches = 0;
+	int      max_error  = 0;
+
+	for (uint32_t index = 0; index < w * h; ++index) {
+		int error = 0;
+		for (int c = 0; c < 3; ++c) {
+			int diff = (int)pixels[index * 4 + c] - (int)golden[index * 3 + c];
+			error = Max(error, diff < 0 ? -diff : diff);
+		}
+		max_error = Max(max_error, error);
+		if (error > GOLDEN_TOLERANCE)
+			mismatches += 1;
+	}
+
+	if (mismatches) {
+		char actual[256];
+		snprintf(actual, sizeof(actual), "Golden/Render2d/%s.actual.ppm", name);
+		WriteImagePPM(actual, pixels, w, h);
+
+		LogError("[Benchmark] % pixels differ from % (max error %), output written to %", mismatches, path, max_error, actual);
+		return false;
+	}
+
+	return true;
+}
+
+static void DrawRects(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	Benchmark_Random random;
+	for (int index = 0; index < 100000; ++index) {
+		Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		Vec2 dim = Vec2(random.NextFloat(2.0f, 24.0f), random.NextFloat(2.0f, 24.0f));
+		Vec4 color = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.5f, 1.0f));
+		R_DrawRect(r2, pos, dim, color);
+	}
+}
+
+static void DrawCircles(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	Benchmark_Random random;
+	for (int index = 0; index < 50000; ++index) {
+		Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		float radius = random.NextFloat(2.0f, 12.0f);
+		Vec4 color = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.5f, 1.0f));
+		R_DrawCircle(r2, pos, radius, color);
+	}
+}
+
+// Small default-segment circles, the shape the particle systems draw the most
+static void DrawSmallCircles(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	Benchmark_Random random;
+	for (int index = 0; index < 100000; ++index) {
+		Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		float radius = random.NextFloat(1.0f, 4.0f);
+		Vec4 color = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.5f, 1.0f));
+		R_DrawCircle(r2, pos, radius, color);
+	}
+}
+
+// Same rects as DrawRects, gathered into arrays and submitted with one call
+static void DrawRectsBulk(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int RECT_COUNT = 100000;
+	static Vec2 positions[RECT_COUNT];
+	static Vec2 dims[RECT_COUNT];
+	static Vec4 colors[RECT_COUNT];
+
+	Benchmark_Random random;
+	for (int index = 0; index < RECT_COUNT; ++index) {
+		positions[index] = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		dims[index]      = Vec2(random.NextFloat(2.0f, 24.0f), random.NextFloat(2.0f, 24.0f));
+		colors[index]    = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.5f, 1.0f));
+	}
+
+	R_DrawRects(r2, positions, dims, colors, RECT_COUNT);
+}
+
+// Same circles as DrawSmallCircles, gathered into arrays and submitted with one call
+static void DrawSmallCirclesBulk(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int CIRCLE_COUNT = 100000;
+	static Vec2  positions[CIRCLE_COUNT];
+	static float radii[CIRCLE_COUNT];
+	static Vec4  colors[CIRCLE_COUNT];
+
+	Benchmark_Random random;
+	for (int index = 0; index < CIRCLE_COUNT; ++index) {
+		positions[index] = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		radii[index]     = random.NextFloat(1.0f, 4.0f);
+		colors[index]    = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.5f, 1.0f));
+	}
+
+	R_DrawCircles(r2, positions, radii, colors, CIRCLE_COUNT);
+}
+
+// Same circles as DrawSmallCircles, drawn as signed distance shapes, followed by the other shape kinds
+static void DrawShapes(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	Benchmark_Random random;
+	for (int index = 0; index < 100000; ++index) {
+		Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		float radius = random.NextFloat(1.0f, 4.0f);
+		Vec4 color = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.5f, 1.0f));
+		R_DrawShapeCircle(r2, pos, radius, color);
+	}
+
+	for (int index = 0; index < 400; ++index) {
+		Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		Vec2 dim = Vec2(random.NextFloat(8.0f, 48.0f), random.NextFloat(8.0f, 48.0f));
+		Vec4 color = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), 1.0f);
+
+		switch (index % 5) {
+			case 0: R_DrawShapeEllipse(r2, pos, dim.x, dim.y, color); break;
+			case 1: R_DrawShapeRing(r2, pos, dim.x, 0.25f * dim.y, color); break;
+			case 2: R_DrawShapeCapsule(r2, pos, pos + dim, 0.2f * dim.x, color); break;
+			case 3: R_DrawShapeRoundedRect(r2, pos, dim, color, 0.25f * Min(dim.x, dim.y)); break;
+			case 4: R_DrawShapeRoundedRectOutline(r2, pos, dim, color, 0.25f * Min(dim.x, dim.y)); break;
+		}
+	}
+}
+
+static void DrawPaths(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int PATH_COUNT  = 32;
+	constexpr int PATH_POINTS = 4096;
+
+	Benchmark_Random random;
+	R_SetLineThickness(r2, 1.5f);
+
+	for (int path = 0; path < PATH_COUNT; ++path) {
+		float base      = random.NextFloat(0.1f, 0.9f) * RENDER_BENCHMARK_HEIGHT;
+		float amplitude = random.NextFloat(10.0f, 80.0f);
+		float frequency = random.NextFloat(0.01f, 0.2f);
+
+		for (int point = 0; point < PATH_POINTS; ++point) {
+			float x = (float)point * RENDER_BENCHMARK_WIDTH / (float)(PATH_POINTS - 1);
+			float y = base + amplitude * Sin(frequency * x) + random.NextFloat(-2.0f, 2.0f);
+			R_PathTo(r2, Vec2(x, y));
+		}
+
+		Vec4 color = Vec4(random.NextFloat(0.2f, 1.0f), random.NextFloat(0.2f, 1.0f), random.NextFloat(0.2f, 1.0f), 1.0f);
+		R_DrawPathStroked(r2, color);
+	}
+}
+
+// Concave stars, convex polygons that take the fan path, a large comb and two squares touching at a corner
+static void DrawPolygons(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	Benchmark_Random random;
+
+	Vec2 points[64];
+	for (int index = 0; index < 4000; ++index) {
+		Vec2  center = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		float radius = random.NextFloat(4.0f, 24.0f);
+		int   count  = 16 + (int)(random.Next() % 48);
+		bool  convex = index & 1;
+
+		for (int point = 0; point < count; ++point) {
+			float angle = 2.0f * PI * (float)point / (float)count;
+			float scale = convex ? 1.0f : random.NextFloat(0.3f, 1.0f);
+			points[point] = center + radius * scale * Vec2(Cos(angle), Sin(angle));
+		}
+
+		Vec4 color = Vec4(random.NextFloat(0.2f, 1.0f), random.NextFloat(0.2f, 1.0f), random.NextFloat(0.2f, 1.0f), 0.75f);
+		R_DrawPolygon(r2, points, count, color);
+	}
+
+	constexpr int TEETH = 256;
+	for (int tooth = 0; tooth < TEETH; ++tooth) {
+		float x = 20.0f + 600.0f * (float)tooth / (float)TEETH;
+		R_PathTo(r2, Vec2(x, 420.0f));
+		R_PathTo(r2, Vec2(x + 600.0f / (2.0f * TEETH), 420.0f - 60.0f - 20.0f * Sin(0.1f * tooth)));
+	}
+	R_PathTo(r2, Vec2(620.0f, 420.0f));
+	R_PathTo(r2, Vec2(620.0f, 460.0f));
+	R_PathTo(r2, Vec2(20.0f, 460.0f));
+	R_DrawPathFilled(r2, Vec4(0.9f, 0.9f, 0.9f, 0.75f));
+
+	const Vec2 touching[] = {
+		Vec2(20.0f, 20.0f), Vec2(60.0f, 20.0f), Vec2(60.0f, 60.0f), Vec2(100.0f, 60.0f),
+		Vec2(100.0f, 100.0f), Vec2(60.0f, 100.0f), Vec2(60.0f, 60.0f), Vec2(20.0f, 60.0f),
+	};
+	R_DrawPolygon(r2, touching, (uint32_t)ArrayCount(touching), Vec4(1.0f, 0.4f, 0.2f, 1.0f));
+}
+
+// Thick zigzags and stars with every join and cap, the sharpest corners exceed the default miter limit
+static void DrawStrokes(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	const R_Line_Join2d joins[] = { R_LINE_JOIN_MITER, R_LINE_JOIN_BEVEL, R_LINE_JOIN_ROUND };
+	const R_Line_Cap2d  caps[]  = { R_LINE_CAP_BUTT, R_LINE_CAP_SQUARE, R_LINE_CAP_ROUND };
+
+	R_SetLineThickness(r2, 10.0f);
+
+	for (int row = 0; row < 3; ++row) {
+		for (int column = 0; column < 3; ++column) {
+			R_SetLineJoin(r2, joins[row]);
+			R_SetLineCap(r2, caps[column]);
+
+			Vec2 origin = Vec2(30.0f + 165.0f * column, 40.0f + 150.0f * row);
+			Vec4 color  = Vec4(0.3f + 0.3f * row, 0.9f - 0.3f * column, 0.6f, 0.75f);
+
+			for (int point = 0; point < 6; ++point) {
+				float x = origin.x + 12.0f * point + 8.0f * column * (point & 1);
+				float y = origin.y + ((point & 1) ? 80.0f : 0.0f);
+				R_PathTo(r2, Vec2(x, y));
+			}
+			R_DrawPathStroked(r2, color);
+		}
+
+		// Closed five pointed star
+		Vec2 center = Vec2(570.0f, 80.0f + 150.0f * row);
+		for (int point = 0; point < 10; ++point) {
+			float angle  = 0.5f * PI + (float)point * PI / 5.0f;
+			float radius = (point & 1) ? 18.0f : 50.0f;
+			R_PathTo(r2, center + radius * Vec2(Cos(angle), Sin(angle)));
+		}
+		R_DrawPathStroked(r2, Vec4(1.0f, 0.8f, 0.2f, 0.75f), true);
+	}
+
+	R_SetLineJoin(r2, R_LINE_JOIN_MITER);
+	R_SetLineCap(r2, R_LINE_CAP_BUTT);
+}
+
+// One telemetry graph of a million samples, most of its segments are shorter than a pixel
+static void DrawTelemetry(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int SAMPLE_COUNT = 1000000;
+
+	Benchmark_Random random;
+	R_SetLineThickness(r2, 2.0f);
+
+	float value = 0.5f * RENDER_BENCHMARK_HEIGHT;
+	for (int sample = 0; sample < SAMPLE_COUNT; ++sample) {
+		float x = (float)sample * RENDER_BENCHMARK_WIDTH / (float)(SAMPLE_COUNT - 1);
+		value   = Clamp(20.0f, RENDER_BENCHMARK_HEIGHT - 20.0f, value + random.NextFloat(-1.0f, 1.0f));
+		R_PathTo(r2, Vec2(x, value));
+	}
+	R_DrawPathStroked(r2, Vec4(0.2f, 0.9f, 0.4f, 1.0f));
+}
+
+// Debug overlay of constraints and contact normals, short segments written in one batch
+template <void (*DrawLines)(R_Renderer2d *, const Vec2 *, uint32_t, Vec4)>
+static void DrawDebugLines(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int LINE_COUNT = 100000;
+	static Vec2 points[2 * LINE_COUNT];
+
+	Benchmark_Random random;
+	for (int index = 0; index < LINE_COUNT; ++index) {
+		Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		points[2 * index + 0] = pos;
+		points[2 * index + 1] = pos + Vec2(random.NextFloat(-8.0f, 8.0f), random.NextFloat(-8.0f, 8.0f));
+	}
+
+	R_SetLineThickness(r2, 1.0f);
+	DrawLines(r2, points, 2 * LINE_COUNT, Vec4(0.3f, 0.9f, 0.5f, 0.4f));
+}
+
+// Hex map with a label on some of the tiles, many times larger than the camera that looks at a part of it
+template <bool Cull>
+static void DrawHexWorld(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int   HEX_COLUMNS = 200;
+	constexpr int   HEX_ROWS    = 200;
+	constexpr float HEX_RADIUS  = 10.0f;
+
+	static const String labels[] = { "Forest", "Plains", "Hills", "Water" };
+
+	R_Font *font = R_DefaultFont(r2);
+
+	R_SetCulling(r2, Cull);
+	R_CameraView(r2, 1500.0f, 1500.0f + RENDER_BENCHMARK_WIDTH, 1200.0f, 1200.0f + RENDER_BENCHMARK_HEIGHT, -1.0f, 1.0f);
+
+	float step_x = SquareRoot(3.0f) * HEX_RADIUS;
+	float step_y = 1.5f * HEX_RADIUS;
+
+	Benchmark_Random random;
+	for (int row = 0; row < HEX_ROWS; ++row) {
+		for (int column = 0; column < HEX_COLUMNS; ++column) {
+			Vec2 center = Vec2(((float)column + 0.5f * (float)(row & 1)) * step_x, (float)row * step_y);
+			Vec4 color  = Vec4(random.NextFloat(0.2f, 0.6f), random.NextFloat(0.4f, 0.8f), random.NextFloat(0.1f, 0.4f), 1.0f);
+
+			Vec2 corners[6];
+			for (int corner = 0; corner < 6; ++corner) {
+				float angle = PI / 6.0f + (float)corner * PI / 3.0f;
+				corners[corner] = center + (HEX_RADIUS - 0.5f) * Vec2(Cos(angle), Sin(angle));
+			}
+
+			R_DrawPolygon(r2, corners, 6, color);
+
+			if ((row * 3 + column) % 7 == 0)
+				R_DrawText(r2, center - Vec2(12.0f, 4.0f), Vec4(1.0f), labels[(row + column) & 3], font, 0.5f);
+		}
+	}
+
+	R_SetCulling(r2, false);
+}
+
+static void DrawTextPages(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int PAGE_COUNT = 16;
+
+	const String line = "The quick brown fox jumps over the lazy dog. 0123456789 !\"#$%&'()*+,-./:;<=>?@[]^_{|}~";
+
+	R_Font *font   = R_DefaultFont(r2);
+	float   height = 1.0f + font->height;
+
+	for (int page = 0; page < PAGE_COUNT; ++page) {
+		Vec4 color = Vec4(1.0f, 1.0f, 1.0f, 1.0f / (float)(PAGE_COUNT - page));
+		float x = 4.0f + (float)page;
+		for (float y = RENDER_BENCHMARK_HEIGHT - height; y > 0.0f; y -= height) {
+			R_DrawText(r2, Vec2(x, y), color, line, font);
+		}
+	}
+}
+
+// Many short strings from a small set, like the labels and counters of a HUD
+static void DrawTextLabels(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	static const String labels[] = {
+		"Health", "Mana", "Stamina", "Gold: 1250", "Level 12", "Quest updated", "x3", "FPS 60",
+		"Inventory", "Map", "Settings", "Resume", "Speed +10%", "Armor 45", "Poisoned", "Ready",
+	};
+
+	R_Font *font = R_DefaultFont(r2);
+
+	Benchmark_Random random;
+	for (int index = 0; index < 8000; ++index) {
+		Vec2 pos   = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH - 64.0f), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT - 16.0f));
+		Vec4 color = Vec4(random.NextFloat(0.5f, 1.0f), random.NextFloat(0.5f, 1.0f), random.NextFloat(0.5f, 1.0f), 0.25f);
+		R_DrawText(r2, pos, color, labels[index % ArrayCount(labels)], font);
+	}
+}
+
+static void DrawTextureSwitches(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	Benchmark_Random random;
+	for (int index = 0; index < 20000; ++index) {
+		Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		Vec2 dim = Vec2(random.NextFloat(4.0f, 32.0f));
+		R_DrawTexture(r2, resources.textures[index % RENDER_TEXTURE_COUNT], pos, dim);
+	}
+}
+
+// Interleaved widget backgrounds, icons and labels, layered so that sorting keeps the output identical
+static void DrawInterface(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	constexpr int   COLUMNS = 8;
+	constexpr int   ROWS    = 24;
+	constexpr float WIDTH   = (float)RENDER_BENCHMARK_WIDTH / COLUMNS;
+	constexpr float HEIGHT  = (float)RENDER_BENCHMARK_HEIGHT / ROWS;
+
+	const String label = "Item";
+
+	for (int row = 0; row < ROWS; ++row) {
+		for (int column = 0; column < COLUMNS; ++column) {
+			Vec2 pos = Vec2(column * WIDTH, row * HEIGHT);
+
+			R_SetLayer(r2, 0);
+			R_DrawRect(r2, pos + Vec2(1.0f), Vec2(WIDTH, HEIGHT) - Vec2(2.0f), Vec4(0.2f, 0.2f, 0.25f, 1.0f));
+
+			R_SetLayer(r2, 1);
+			R_DrawTexture(r2, resources.textures[(row + column) % RENDER_TEXTURE_COUNT], pos + Vec2(2.0f), Vec2(HEIGHT - 4.0f));
+
+			R_SetLayer(r2, 2);
+			R_DrawText(r2, pos + Vec2(HEIGHT, 5.0f), Vec4(1.0f), label);
+		}
+	}
+}
+
+static void DrawInterfaceUnsorted(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	R_SetSortMode(r2, R_SORT_MODE_NONE);
+	DrawInterface(r2, resources);
+}
+
+static void DrawInterfaceSorted(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	R_SetSortMode(r2, R_SORT_MODE_STATE);
+	DrawInterface(r2, resources);
+}
+
+// Same particles drawn as vertex quads and as instanced sprites, so the upload sizes can be compared
+static constexpr int PARTICLE_COUNT = 200000;
+
+template <typename Draw_Particle>
+static void DrawParticleField(Draw_Particle draw) {
+	Benchmark_Random random;
+	for (int index = 0; index < PARTICLE_COUNT; ++index) {
+		Vec2 pos    = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+		Vec2 dim    = Vec2(random.NextFloat(1.0f, 6.0f));
+		float angle = random.NextFloat(0.0f, 2.0f * PI);
+		Vec4 color  = Vec4(random.NextFloat(0.5f, 1.0f), random.NextFloat(0.2f, 0.8f), random.NextFloat(0.0f, 0.3f), random.NextFloat(0.1f, 0.6f));
+		draw(pos, dim, angle, color);
+	}
+}
+
+static void DrawParticleQuads(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	DrawParticleField([r2](Vec2 pos, Vec2 dim, float angle, Vec4 color) {
+		R_DrawRectCenteredRotated(r2, pos, dim, angle, color);
+	});
+}
+
+static void DrawParticleSprites(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	DrawParticleField([r2](Vec2 pos, Vec2 dim, float angle, Vec4 color) {
+		R_DrawSprite(r2, pos, dim, angle, color);
+	});
+}
+
+static void DrawParticleSpritesBulk(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	static Vec2  positions[PARTICLE_COUNT];
+	static Vec2  dims[PARTICLE_COUNT];
+	static float angles[PARTICLE_COUNT];
+	static Vec4  colors[PARTICLE_COUNT];
+
+	int count = 0;
+	DrawParticleField([&count](Vec2 pos, Vec2 dim, float angle, Vec4 color) {
+		positions[count] = pos;
+		dims[count]      = dim;
+		angles[count]    = angle;
+		colors[count]    = color;
+		count += 1;
+	});
+
+	R_DrawSprites(r2, positions, dims, angles, colors, (uint32_t)count);
+}
+
+// Same amount of rects as DrawRects, split into chunks that are recorded in parallel
+// into their own contexts and appended to the frame in chunk order
+static constexpr int RECTS_PER_CHUNK = 100000 / RENDER_CONTEXT_COUNT;
+
+static void RecordRectChunks(void *data, uint32_t first, uint32_t last, uint32_t thread) {
+	const Benchmark_Render_Resources *resources = (const Benchmark_Render_Resources *)data;
+
+	for (uint32_t chunk = first; chunk < last; ++chunk) {
+		R_Renderer2d *r2 = resources->contexts[chunk];
+		R_NextFrame(r2, R_Rect(0.0f, 0.0f, (float)RENDER_BENCHMARK_WIDTH, (float)RENDER_BENCHMARK_HEIGHT));
+		R_CameraView(r2, 0.0f, (float)RENDER_BENCHMARK_WIDTH, 0.0f, (float)RENDER_BENCHMARK_HEIGHT, -1.0f, 1.0f);
+
+		Benchmark_Random random;
+		random.state += chunk;
+
+		for (int index = 0; index < RECTS_PER_CHUNK; ++index) {
+			Vec2 pos = Vec2(random.NextFloat(0.0f, RENDER_BENCHMARK_WIDTH), random.NextFloat(0.0f, RENDER_BENCHMARK_HEIGHT));
+			Vec2 dim = Vec2(random.NextFloat(2.0f, 24.0f), random.NextFloat(2.0f, 24.0f));
+			Vec4 color = Vec4(random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.0f, 1.0f), random.NextFloat(0.5f, 1.0f));
+			R_DrawRect(r2, pos, dim, color);
+		}
+	}
+}
+
+static void DrawRectsParallel(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	J_ParallelFor(RENDER_CONTEXT_COUNT, 1, RecordRectChunks, (void *)&resources);
+
+	for (R_Renderer2d *context : resources.contexts)
+		R_AppendContext(r2, context);
+}
+
+static void DrawMesh(R_Renderer2d *r2, const Benchmark_Render_Resources &resources) {
+	R_DrawMesh(r2, resources.mesh);
+}
+
+static void RecordRenderFrame(R_Renderer2d *r2, Benchmark_Render_Proc draw, const Benchmark_Render_Resources &resources) {
+	R_NextFrame(r2, R_Rect(0.0f, 0.0f, (float)RENDER_BENCHMARK_WIDTH, (float)RENDER_BENCHMARK_HEIGHT));
+	R_CameraView(r2, 0.0f, (float)RENDER_BENCHMARK_WIDTH, 0.0f, (float)RENDER_BENCHMARK_HEIGHT, -1.0f, 1.0f);
+	draw(r2, resources);
+}
+
+static bool RunRenderBenchmark(const Benchmark_Options &options, const char *name, Benchmark_Render_Proc draw, const R_Specification2d &spec = Renderer2dDefaultSpec, bool contexts = false, Benchmark_Render_Proc record = nullptr) {
+	Benchmark_Recorder recorder = {};
+	recorder.backend.CreateTexture       = RecorderCreateTexture;
+	recorder.backend.CreateTextureSRGBA  = RecorderCreateTextureSRGBA;
+	recorder.backend.DestroyTexture      = RecorderDestroyTexture;
+	recorder.backend.CreateFont          = RecorderCreateFont;
+	recorder.backend.DestroyFont         = RecorderDestroyFont;
+	recorder.backend.CreateGeometry      = RecorderCreateGeometry;
+	recorder.backend.DestroyGeometry     = RecorderDestroyGeometry;
+	recorder.backend.UploadVertexData    = RecorderUploadVertexData;
+	recorder.backend.UploadIndexData     = RecorderUploadIndexData;
+	recorder.backend.UploadInstanceData  = RecorderUploadInstanceData;
+	recorder.backend.UploadDrawData      = RecorderUploadDrawData;
+	recorder.backend.SetPipeline         = RecorderSetPipeline;
+	recorder.backend.SetScissor          = RecorderSetScissor;
+	recorder.backend.SetTexture          = RecorderSetTexture;
+	recorder.backend.SetGeometry         = RecorderSetGeometry;
+	recorder.backend.DrawTriangleList    = RecorderDrawTriangleList;
+	recorder.backend.DrawInstancedQuads  = RecorderDrawInstancedQuads;
+	recorder.backend.DrawInstancedShapes = RecorderDrawInstancedShapes;
+	recorder.backend.Release             = RecorderRelease;
+
+	recorder.target = R_CreateSoftwareBackend2d(RENDER_BENCHMARK_WIDTH, RENDER_BENCHMARK_HEIGHT);
+
+	R_Renderer2d *r2 = R_CreateRenderer2d(&recorder.backend, spec);
+	if (!r2) {
+		LogError("[Benchmark] Failed to create renderer for %", name);
+		return false;
+	}
+	Defer{ R_DestroyRenderer2d(r2); };
+
+	Benchmark_Render_Resources resources = {};
+	for (int index = 0; index < RENDER_TEXTURE_COUNT; ++index) {
+		uint8_t pixels[16 * 16 * 4];
+		for (int texel = 0; texel < 16 * 16; ++texel) {
+			bool checker = ((texel % 16) / 4 + (texel / 64)) & 1;
+			pixels[texel * 4 + 0] = checker ? (uint8_t)(index * 32) : 0xff;
+			pixels[texel * 4 + 1] = checker ? (uint8_t)(255 - index * 32) : 0xff;
+			pixels[texel * 4 + 2] = checker ? 0x80 : 0xff;
+			pixels[texel * 4 + 3] = 0xff;
+		}
+		resources.textures[index] = R_Backend_CreateTexture(r2, 16, 16, 4, pixels);
+	}
+	Defer{
+		for (R_Texture *texture : resources.textures)
+			if (texture) R_Backend_DestroyTexture(r2, texture);
+	};
+
+	if (contexts) {
+		R_Specification2d context_spec = spec;
+		context_spec.vertex = 4 * RECTS_PER_CHUNK;
+		context_spec.index  = 6 * RECTS_PER_CHUNK;
+		for (R_Renderer2d *&context : resources.contexts) {
+			context = R_CreateRecordingContext(r2, context_spec);
+			if (!context) {
+				LogError("[Benchmark] Failed to create recording context for %", name);
+				return false;
+			}
+		}
+	}
+	Defer{
+		for (R_Renderer2d *context : resources.contexts)
+			if (context) R_DestroyRecordingContext(context);
+	};
+
+	// Retained geometry is recorded once, the frames only replay it
+	if (record) {
+		R_NextFrame(r2, R_Rect(0.0f, 0.0f, (float)RENDER_BENCHMARK_WIDTH, (float)RENDER_BENCHMARK_HEIGHT));
+		R_CameraView(r2, 0.0f, (float)RENDER_BENCHMARK_WIDTH, 0.0f, (float)RENDER_BENCHMARK_HEIGHT, -1.0f, 1.0f);
+		R_BeginRecord(r2);
+		record(r2, resources);
+		resources.mesh = R_EndRecord(r2);
+		if (!resources.mesh) {
+			LogError("[Benchmark] Failed to record mesh for %", name);
+			return false;
+		}
+	}
+	Defer{ R_DestroyMesh(r2, resources.mesh); };
+
+	// The first frame is rasterized for the golden image, it also grows the renderer's buffers
+	recorder.forward = true;
+	R_SoftwareClearTarget(recorder.target, Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	RecordRenderFrame(r2, draw, resources);
+	R_FinishFrame(r2, nullptr);
+
+	Benchmark_Timer raster_timer;
+	uint32_t w, h;
+	const uint8_t *pixels = R_SoftwareResolve(recorder.target, &w, &h);
+	float raster_ms = raster_timer.ElapsedMs();
+
+	bool matched = CompareGoldenImage(options, name, pixels, w, h);
+
+	recorder.forward = false;
+	recorder.stats   = {};
+
+	float record_ms = 0.0f, submit_ms = 0.0f;
+	for (int frame = 0; frame < RENDER_BENCHMARK_FRAMES; ++frame) {
+		Benchmark_Timer record_timer;
+		RecordRenderFrame(r2, draw, resources);
+		record_ms += record_timer.ElapsedMs();
+
+		Benchmark_Timer submit_timer;
+		R_FinishFrame(r2, nullptr);
+		submit_ms += submit_timer.ElapsedMs();
+	}
+
+	const Benchmark_Render_Stats &stats = recorder.stats;
+
+	// Sprites count as the 4 vertices they are expanded to
+	uint64_t vertices = stats.vertex_bytes / sizeof(R_Vertex2d) + 4 * (stats.instance_bytes / sizeof(R_Sprite2d));
+	uint64_t uploaded = stats.vertex_bytes + stats.index_bytes + stats.instance_bytes + stats.draw_data_bytes;
+	float    seconds  = 0.001f * (record_ms + submit_ms);
+
+	LogInfo("[Benchmark] %: record % ms, submit % ms per frame, rasterize % ms", name,
+		record_ms / RENDER_BENCHMARK_FRAMES, submit_ms / RENDER_BENCHMARK_FRAMES, raster_ms);
+	LogInfo("[Benchmark] %: % vertices/sec, % commands/frame, % bytes uploaded/frame", name,
+		seconds > 0.0f ? (double)vertices / seconds : 0.0, stats.draw_calls / RENDER_BENCHMARK_FRAMES, uploaded / RENDER_BENCHMARK_FRAMES);
+
+	return matched;
+}
+
+static bool BenchmarkRenderRects(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_rects", DrawRects);
+}
+
+static bool BenchmarkRenderRectsParallel(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_rects_parallel", DrawRectsParallel, Renderer2dDefaultSpec, true);
+}
+
+static bool BenchmarkRenderRectsBulk(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_rects_bulk", DrawRectsBulk);
+}
+
+static bool BenchmarkRenderCircles(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_circles", DrawCircles);
+}
+
+// Every circle keeps its requested segments, compared against render_circles which reduces them by screen size
+static bool BenchmarkRenderCirclesExact(const Benchmark_Options &options) {
+	R_Specification2d spec = Renderer2dDefaultSpec;
+	spec.tolerance = 0.0f;
+	return RunRenderBenchmark(options, "render_circles_exact", DrawCircles, spec);
+}
+
+static bool BenchmarkRenderCirclesMesh(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_circles_mesh", DrawMesh, Renderer2dDefaultSpec, false, DrawCircles);
+}
+
+// A frame that ends on a mesh followed by a frame of immediate draws, which must not read the mesh's buffers
+// The second frame is the frame of render_rects, so it is compared with that golden image
+static bool BenchmarkRenderMeshThenImmediate(const Benchmark_Options &options) {
+	R_Backend2d * backend = R_CreateSoftwareBackend2d(RENDER_BENCHMARK_WIDTH, RENDER_BENCHMARK_HEIGHT);
+	R_Renderer2d *r2      = R_CreateRenderer2d(backend, Renderer2dDefaultSpec);
+	if (!r2) {
+		LogError("[Benchmark] Failed to create renderer for mesh then immediate");
+		return false;
+	}
+	Defer{ R_DestroyRenderer2d(r2); };
+
+	Benchmark_Render_Resources resources = {};
+
+	R_NextFrame(r2, R_Rect(0.0f, 0.0f, (float)RENDER_BENCHMARK_WIDTH, (float)RENDER_BENCHMARK_HEIGHT));
+	R_CameraView(r2, 0.0f, (float)RENDER_BENCHMARK_WIDTH, 0.0f, (float)RENDER_BENCHMARK_HEIGHT, -1.0f, 1.0f);
+	R_BeginRecord(r2);
+	DrawCircles(r2, resources);
+	resources.mesh = R_EndRecord(r2);
+	if (!resources.mesh) {
+		LogError("[Benchmark] Failed to record mesh for mesh then immediate");
+		return false;
+	}
+	Defer{ R_DestroyMesh(r2, resources.mesh); };
+
+	R_SoftwareClearTarget(backend, Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	RecordRenderFrame(r2, DrawMesh, resources);
+	R_FinishFrame(r2, nullptr);
+
+	uint32_t w, h;
+	R_SoftwareResolve(backend, &w, &h);
+
+	R_SoftwareClearTarget(backend, Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	RecordRenderFrame(r2, DrawRects, resources);
+	R_FinishFrame(r2, nullptr);
+
+	const uint8_t *pixels = R_SoftwareResolve(backend, &w, &h);
+
+	// The golden image belongs to render_rects, so it is never written from here
+	Benchmark_Options compare = options;
+	compare.update_golden     = false;
+
+	return CompareGoldenImage(compare, "render_rects", pixels, w, h);
+}
+
+static bool BenchmarkRenderCirclesSmall(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_circles_small", DrawSmallCircles);
+}
+
+static bool BenchmarkRenderCirclesSmallBulk(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_circles_small_bulk", DrawSmallCirclesBulk);
+}
+
+static bool BenchmarkRenderShapes(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_shapes", DrawShapes);
+}
+
+static bool BenchmarkRenderPaths(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_paths", DrawPaths);
+}
+
+static bool BenchmarkRenderPolygons(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_polygons", DrawPolygons);
+}
+
+static bool BenchmarkRenderStrokes(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_strokes", DrawStrokes);
+}
+
+static bool BenchmarkRenderTelemetry(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_telemetry", DrawTelemetry);
+}
+
+static bool BenchmarkRenderLines(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_lines", DrawDebugLines<R_DrawLines>);
+}
+
+static bool BenchmarkRenderLinesAntiAliased(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_lines_aa", DrawDebugLines<R_DrawShapeLines>);
+}
+
+static bool BenchmarkRenderHexWorld(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_hex_world", DrawHexWorld<false>);
+}
+
+static bool BenchmarkRenderHexWorldCulled(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_hex_world_culled", DrawHexWorld<true>);
+}
+
+static bool BenchmarkRenderText(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_text", DrawTextPages);
+}
+
+static bool BenchmarkRenderTextLabels(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_text_labels", DrawTextLabels);
+}
+
+// Lines of a log view, the mixed log has accented, symbol and emoji text in between
+static void BuildBenchmarkLog(Array<uint8_t> *log, size_t size, bool mixed) {
+	static const char *messages[] = {
+		"Renderer2d: frame submitted", "Jobs: worker idle", "Physics: contacts resolved", "Audio: stream refilled",
+	};
+	static const char *mixed_messages[] = {
+		"Größe der Welt geändert", "naïve café résumé", "→ état ✓ — 完了", "joueur connecté 😀",
+	};
+
+	Benchmark_Random random;
+	while ((size_t)log->count < size) {
+		char line[160];
+		int  length = snprintf(line, sizeof(line), "[%02u:%02u:%02u.%03u] INFO  %s, %u commands, %u vertices\n",
+			(uint32_t)random.NextFloat(0.0f, 24.0f), (uint32_t)random.NextFloat(0.0f, 60.0f), (uint32_t)random.NextFloat(0.0f, 60.0f),
+			(uint32_t)random.NextFloat(0.0f, 1000.0f), (mixed ? mixed_messages : messages)[log->count % 4],
+			(uint32_t)random.NextFloat(0.0f, 1000.0f), (uint32_t)random.NextFloat(0.0f, 100000.0f));
+		for (int index = 0; index < length; ++index)
+			Append(log, (uint8_t)line[index]);
+	}
+}
+
+static bool BenchmarkTextLayout(const Benchmark_Options &options) {
+	constexpr size_t LOG_SIZE   = 256 * 1024;
+	constexpr int    ITERATIONS = 16;
+
+	R_Renderer2d *r2 = R_CreateRenderer2dSoftware(RENDER_BENCHMARK_WIDTH, RENDER_BENCHMARK_HEIGHT);
+	if (!r2) {
+		LogError("[Benchmark] Failed to create renderer for text layout");
+		return false;
+	}
+	Defer{ R_DestroyRenderer2d(r2); };
+
+	R_Font *font = R_DefaultFont(r2);
+
+	bool matched = true;
+
+	for (int mixed = 0; mixed < 2; ++mixed) {
+		Array<uint8_t> log;
+		Defer{ Free(&log); };
+		BuildBenchmarkLog(&log, LOG_SIZE, mixed != 0);
+
+		String text = String(log.data, log.count);
+		float  mb   = (float)log.count / (1024.0f * 1024.0f);
+
+		float width = 0.0f;
+		Benchmark_Timer measure_timer;
+		for (int iteration = 0; iteration < ITERATIONS; ++iteration)
+			width = R_PrepareText(r2, text, font);
+		float measure_ms = measure_timer.ElapsedMs() / ITERATIONS;
+
+		// Every codepoint of ASCII text is a byte
+		if (!mixed) {
+			float expected = 0.0f;
+			for (uint8_t byte : log)
+				expected += R_FontFindGlyph(font, byte)->advance;
+			if (expected != width) {
+				LogError("[Benchmark] Text width is %, expected %", width, expected);
+				matched = false;
+			}
+		}
+
+		// Too large for the glyph run cache, so every frame decodes and lays out the whole log
+		float draw_ms = 0.0f;
+		for (int iteration = 0; iteration < ITERATIONS; ++iteration) {
+			R_NextFrame(r2, R_Rect(0.0f, 0.0f, (float)RENDER_BENCHMARK_WIDTH, (float)RENDER_BENCHMARK_HEIGHT));
+			R_CameraView(r2, 0.0f, (float)RENDER_BENCHMARK_WIDTH, 0.0f, (float)RENDER_BENCHMARK_HEIGHT, -1.0f, 1.0f);
+
+			Benchmark_Timer draw_timer;
+			R_DrawText(r2, Vec2(4.0f, (float)RENDER_BENCHMARK_HEIGHT - 16.0f), Vec4(1.0f), text, font);
+			draw_ms += draw_timer.ElapsedMs();
+		}
+		draw_ms /= ITERATIONS;
+
+		LogInfo("[Benchmark] Text layout (%): % KB, measure % MB/s, draw % MB/s", mixed ? "mixed" : "ascii",
+			log.count / 1024, measure_ms > 0.0f ? 1000.0f * mb / measure_ms : 0.0f, draw_ms > 0.0f ? 1000.0f * mb / draw_ms : 0.0f);
+	}
+
+	return matched;
+}
+
+static bool BenchmarkRenderTextures(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_textures", DrawTextureSwitches);
+}
+
+static bool BenchmarkRenderInterface(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_ui", DrawInterfaceUnsorted);
+}
+
+static bool BenchmarkRenderInterfaceSorted(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_ui_sorted", DrawInterfaceSorted);
+}
+
+static bool BenchmarkRenderInterfaceAtlas(const Benchmark_Options &options) {
+	R_Specification2d spec = Renderer2dDefaultSpec;
+	spec.atlas = { 1024, 1024, 64 };
+	return RunRenderBenchmark(options, "render_ui_atlas", DrawInterfaceUnsorted, spec);
+}
+
+static bool BenchmarkRenderParticles(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_particles", DrawParticleQuads);
+}
+
+static bool BenchmarkRenderParticlesInstanced(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_particles_instanced", DrawParticleSprites);
+}
+
+static bool BenchmarkRenderParticlesBulk(const Benchmark_Options &options) {
+	return RunRenderBenchmark(options, "render_particles_bulk", DrawParticleSpritesBulk);
+}
+
+struct Benchmark {
+	const char *name;
+	bool (*proc)(const Benchmark_Options &options);
+};
+
+static const Benchmark Benchmarks[] = {
+	{ "spatial_hash",               BenchmarkSpatialHash },
+	{ "force_batches",              BenchmarkForceBatches },
+	{ "render_rects",               BenchmarkRenderRects },
+	{ "render_rects_bulk",          BenchmarkRenderRectsBulk },
+	{ "render_rects_parallel",      BenchmarkRenderRectsParallel },
+	{ "render_circles",             BenchmarkRenderCircles },
+	{ "render_circles_exact",       BenchmarkRenderCirclesExact },
+	{ "render_circles_mesh",        BenchmarkRenderCirclesMesh },
+	{ "render_mesh_then_immediate", BenchmarkRenderMeshThenImmediate },
+	{ "render_circles_small",       BenchmarkRenderCirclesSmall },
+	{ "render_circles_small_bulk",  BenchmarkRenderCirclesSmallBulk },
+	{ "render_shapes",              BenchmarkRenderShapes },
+	{ "render_paths",               BenchmarkRenderPaths },
+	{ "render_polygons",            BenchmarkRenderPolygons },
+	{ "render_strokes",             BenchmarkRenderStrokes },
+	{ "render_telemetry",           BenchmarkRenderTelemetry },
+	{ "render_lines",               BenchmarkRenderLines },
+	{ "render_lines_aa",            BenchmarkRenderLinesAntiAliased },
+	{ "render_hex_world",           BenchmarkRenderHexWorld },
+	{ "render_hex_world_culled",    BenchmarkRenderHexWorldCulled },
+	{ "render_text",                BenchmarkRenderText },
+	{ "render_text_labels",         BenchmarkRenderTextLabels },
+	{ "text_layout",                BenchmarkTextLayout },
+	{ "render_textures",            BenchmarkRenderTextures },
+	{ "render_ui",                  BenchmarkRenderInterface },
+	{ "render_ui_sorted",           BenchmarkRenderInterfaceSorted },
+	{ "render_ui_atlas",            BenchmarkRenderInterfaceAtlas },
+	{ "render_particles",           BenchmarkRenderParticles },
+	{ "render_particles_instanced", BenchmarkRenderParticlesInstanced },
+	{ "render_particles_bulk",      BenchmarkRenderParticlesBulk },
+};
+
+int RunBenchmarks(int argc, char **argv) {
+	Benchmark_Options options;
+
+	int names = 0;
+	for (int arg = 0; arg < argc; ++arg) {
+		if (String(argv[arg]) == String("--update-golden")) {
+			options.update_golden = true;
+		} else {
+			names += 1;
+		}
+	}
+
+	int ran = 0, failed = 0;
+
+	for (const Benchmark &benchmark : Benchmarks) {
+		bool selected = names == 0;
+		for (int arg = 0; arg < argc && !selected; ++arg) {
+			selected = String(argv[arg]) == String(benchmark.name);
+		}
+
+		if (selected) {
+			if (!benchmark.proc(options)) {
+				LogError("[Benchmark] % failed", benchmark.name);
+				failed += 1;
+			}
+			ran += 1;
+		}
+	}
+
+	if (ran == 0) {
+		LogError("[Benchmark] No benchmark matched the given names");
+		return 1;
+	}
+
+	return failed ? 1 : 0;
+}
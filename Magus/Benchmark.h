@@ -0,0 +1,5 @@
+#pragma once
+
+// Runs the benchmarks named in argv (all of them when no name is given), "Magus --benchmark [--update-golden] [names...]"
+// Render benchmarks compare their first frame against RunTree/Golden/Render2d, --update-golden writes the golden images instead
+int RunBenchmarks(int argc, char **argv);
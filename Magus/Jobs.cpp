@@ -0,0 +1,154 @@
+#include "Jobs.h"
+#include "Kr/KrLog.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+struct J_Job {
+	J_Range_Proc          proc    = nullptr;
+	void *                data    = nullptr;
+	uint32_t              count   = 0;
+	uint32_t              grain   = 1;
+
+	std::atomic<uint32_t> next    = 0;
+	std::atomic<uint32_t> pending = 0;
+};
+
+struct J_Workers {
+	std::thread             threads[J_MAX_THREADS - 1];
+	uint32_t                count      = 0;
+
+	std::mutex              dispatch;
+	std::mutex              lock;
+	std::condition_variable wake;
+	std::condition_variable idle;
+
+	uint64_t                generation = 0;
+	uint32_t                active     = 0;
+	bool                    quit       = false;
+
+	J_Job                   job;
+};
+
+static J_Workers Workers;
+
+static void J_RunJob(J_Job *job, uint32_t thread) {
+	for (;;) {
+		uint32_t first = job->next.fetch_add(job->grain, std::memory_order_relaxed);
+		if (first >= job->count)
+			break;
+
+		uint32_t last = Min(first + job->grain, job->count);
+		job->proc(job->data, first, last, thread);
+
+		job->pending.fetch_sub(last - first, std::memory_order_release);
+	}
+}
+
+static void J_WorkerMain(uint32_t thread) {
+	uint64_t seen = 0;
+
+	for (;;) {
+		std::unique_lock<std::mutex> guard(Workers.lock);
+		Workers.wake.wait(guard, [&seen] { return Workers.quit || Workers.generation != seen; });
+
+		if (Workers.quit)
+			break;
+
+		seen            = Workers.generation;
+		Workers.active += 1;
+		guard.unlock();
+
+		J_RunJob(&Workers.job, thread);
+
+		guard.lock();
+		Workers.active -= 1;
+		if (Workers.active == 0)
+			Workers.idle.notify_all();
+	}
+}
+
+void J_InitWorkers(uint32_t count) {
+	Assert(Workers.count == 0);
+
+	if (count == 0) {
+		uint32_t hardware = std::thread::hardware_concurrency();
+		count = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	count = Min(count, J_MAX_THREADS - 1);
+
+	Workers.quit       = false;
+	Workers.generation = 0;
+
+	for (uint32_t index = 0; index < count; ++index) {
+		Workers.threads[index] = std::thread(J_WorkerMain, index + 1);
+	}
+
+	Workers.count = count;
+
+	LogInfo("[Jobs] Started % worker threads", count);
+}
+
+void J_ShutdownWorkers() {
+	{
+		std::lock_guard<std::mutex> guard(Workers.lock);
+		Workers.quit = true;
+	}
+	Workers.wake.notify_all();
+
+	for (uint32_t index = 0; index < Workers.count; ++index) {
+		Workers.threads[index].join();
+	}
+
+	Workers.count = 0;
+}
+
+uint32_t J_ThreadCount() {
+	return Workers.count + 1;
+}
+
+uint32_t J_SplitGrain(uint32_t count, uint32_t min_grain) {
+	uint32_t threads = J_ThreadCount();
+	return Max((count + threads - 1) / threads, Max(min_grain, 1u));
+}
+
+void J_ParallelFor(uint32_t count, uint32_t grain, J_Range_Proc proc, void *data) {
+	if (count == 0)
+		return;
+
+	grain = Max(grain, 1u);
+
+	if (Workers.count == 0 || count <= grain) {
+		proc(data, 0, count, 0);
+		return;
+	}
+
+	std::lock_guard<std::mutex> serialize(Workers.dispatch);
+
+	J_Job *job = &Workers.job;
+
+	{
+		// Workers that are still leaving the previous job must be done before it is overwritten
+		std::unique_lock<std::mutex> guard(Workers.lock);
+		Workers.idle.wait(guard, [] { return Workers.active == 0; });
+
+		job->proc  = proc;
+		job->data  = data;
+		job->count = count;
+		job->grain = grain;
+		job->next.store(0, std::memory_order_relaxed);
+		job->pending.store(count, std::memory_order_relaxed);
+
+		Workers.generation += 1;
+	}
+	Workers.wake.notify_all();
+
+	J_RunJob(job, 0);
+
+	while (job->pending.load(std::memory_order_acquire) != 0) {
+		std::this_thread::yield();
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "Kr/KrCommon.h"
+
+static constexpr uint32_t J_MAX_THREADS = 64;
+
+// first and last are the half open range [first, last) of items to process
+// thread is 0 for the calling thread and [1, J_ThreadCount()) for the workers
+typedef void (*J_Range_Proc)(void *data, uint32_t first, uint32_t last, uint32_t thread);
+
+void     J_InitWorkers(uint32_t count = 0);
+void     J_ShutdownWorkers();
+uint32_t J_ThreadCount();
+
+// Splits [0, count) into ranges of "grain" items and blocks until all of them are processed
+// Ranges are processed by the calling thread and the workers, must not be called from inside a J_Range_Proc
+void     J_ParallelFor(uint32_t count, uint32_t grain, J_Range_Proc proc, void *data);
+
+// Grain that splits [0, count) evenly across the threads, but never into ranges smaller than min_grain
+uint32_t J_SplitGrain(uint32_t count, uint32_t min_grain);
@@ -0,0 +1,73 @@
+#include "KrEdgeColoring.h"
+
+constexpr uint8_t EDGE_REDUCTION = 0xff;
+
+void ColorEdges(Edge_Coloring *coloring, const Edge *edges, uint32_t edge_count, uint32_t vertex_count) {
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	uint32_t *degree = M_PushArray(arena, uint32_t, vertex_count);
+	uint64_t *used   = M_PushArray(arena, uint64_t, vertex_count);
+	uint8_t * colors = M_PushArray(arena, uint8_t, edge_count);
+
+	memset(degree, 0, sizeof(uint32_t) * vertex_count);
+	memset(used, 0, sizeof(uint64_t) * vertex_count);
+
+	for (uint32_t index = 0; index < edge_count; ++index) {
+		degree[edges[index].i] += 1;
+		degree[edges[index].j] += 1;
+	}
+
+	uint32_t counts[EDGE_MAX_COLORS] = {};
+	uint32_t color_count = 0;
+
+	coloring->reduction.count = 0;
+
+	for (uint32_t index = 0; index < edge_count; ++index) {
+		uint32_t i = edges[index].i;
+		uint32_t j = edges[index].j;
+
+		uint64_t available = ~(used[i] | used[j]);
+
+		if (degree[i] > EDGE_DENSE_DEGREE || degree[j] > EDGE_DENSE_DEGREE || available == 0) {
+			colors[index] = EDGE_REDUCTION;
+			Append(&coloring->reduction, index);
+			continue;
+		}
+
+		uint32_t color = 0;
+		while ((available & (1ull << color)) == 0)
+			color += 1;
+
+		used[i] |= (1ull << color);
+		used[j] |= (1ull << color);
+
+		colors[index]  = (uint8_t)color;
+		counts[color] += 1;
+		color_count    = Max(color_count, color + 1);
+	}
+
+	Resize(&coloring->batches, color_count + 1);
+
+	uint32_t offset = 0;
+	for (uint32_t color = 0; color < color_count; ++color) {
+		coloring->batches[color] = offset;
+		offset += counts[color];
+		counts[color] = coloring->batches[color];
+	}
+	coloring->batches[color_count] = offset;
+
+	Resize(&coloring->order, offset);
+
+	for (uint32_t index = 0; index < edge_count; ++index) {
+		if (colors[index] == EDGE_REDUCTION) continue;
+		coloring->order[counts[colors[index]]++] = index;
+	}
+}
+
+void FreeEdgeColoring(Edge_Coloring *coloring) {
+	Free(&coloring->order);
+	Free(&coloring->batches);
+	Free(&coloring->reduction);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "Kr/KrArray.h"
+
+//
+// Edges are colored so that no two edges of the same color share a vertex, each color batch
+// can then be processed in parallel without synchronization. Edges attached to dense vertices
+// (or those that run out of colors) are left out of the batches for a reduction instead.
+//
+
+constexpr uint32_t EDGE_MAX_COLORS   = 64;
+constexpr uint32_t EDGE_DENSE_DEGREE = 16;
+
+struct Edge {
+	uint32_t i, j;
+};
+
+struct Edge_Coloring {
+	Array<uint32_t> order;     // indices into edges, sorted by color
+	Array<uint32_t> batches;   // offsets into order, color c is [batches[c], batches[c + 1])
+	Array<uint32_t> reduction; // indices into edges that touch dense vertices
+};
+
+// Vertices of the edges must be less than vertex_count
+void ColorEdges(Edge_Coloring *coloring, const Edge *edges, uint32_t edge_count, uint32_t vertex_count);
+void FreeEdgeColoring(Edge_Coloring *coloring);
@@ -1,34 +1,5 @@
-#include "Kr/KrCommon.h"
-
-struct Matrix {
-	uint32_t d;
-	float   *m;
-
-	float *operator[](uint32_t y) {
-		Assert(y < d);
-		return &m[y * d];
-	}
-
-	const float *operator[](uint32_t y) const {
-		Assert(y < d);
-		return &m[y * d];
-	}
-};
-
-struct Vector {
-	uint32_t d;
-	float   *m;
-
-	float &operator[](uint32_t i) {
-		Assert(i < d);
-		return m[i];
-	}
-
-	const float &operator[](uint32_t i) const {
-		Assert(i < d);
-		return m[i];
-	}
-};
+#include "KrSolver.h"
+#include "Kr/KrLog.h"
 
 void Multiply(Matrix *dst, const Matrix &l, const Matrix &r) {
 	Matrix &result = *dst;
@@ -132,3 +103,181 @@ void Ode(Physics_System *system, float t, float dt) {
 	}
 }
 #endif
+
+Sparse_Matrix BuildSparseMatrix(uint32_t rows, Array_View<Sparse_Entry> entries, M_Allocator allocator) {
+	Sparse_Matrix matrix = {};
+	matrix.rows        = rows;
+	matrix.capacity    = (uint32_t)entries.count;
+	matrix.row_offsets = (uint32_t *)M_Alloc(sizeof(uint32_t) * (rows + 1), allocator);
+	matrix.columns     = (uint32_t *)M_Alloc(sizeof(uint32_t) * matrix.capacity, allocator);
+	matrix.values      = (float *)M_Alloc(sizeof(float) * matrix.capacity, allocator);
+
+	if (!matrix.row_offsets || (matrix.capacity && (!matrix.columns || !matrix.values))) {
+		LogError("Solver: Failed to allocate memory for sparse matrix of % entries.", matrix.capacity);
+		FreeSparseMatrix(&matrix, allocator);
+		return matrix;
+	}
+
+	memset(matrix.row_offsets, 0, sizeof(uint32_t) * (rows + 1));
+
+	// Counting sort of the entries by row
+	for (const Sparse_Entry &entry : entries) {
+		Assert(entry.row < rows && entry.column < rows);
+		matrix.row_offsets[entry.row + 1] += 1;
+	}
+
+	for (uint32_t row = 0; row < rows; ++row) {
+		matrix.row_offsets[row + 1] += matrix.row_offsets[row];
+	}
+
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	uint32_t *cursor = M_PushArray(arena, uint32_t, rows);
+	memcpy(cursor, matrix.row_offsets, sizeof(uint32_t) * rows);
+
+	for (const Sparse_Entry &entry : entries) {
+		uint32_t index = cursor[entry.row]++;
+		matrix.columns[index] = entry.column;
+		matrix.values[index]  = entry.value;
+	}
+
+	// Sort the columns of each row (rows are short) and merge the duplicates
+	uint32_t write = 0;
+
+	for (uint32_t row = 0; row < rows; ++row) {
+		uint32_t first = matrix.row_offsets[row];
+		uint32_t last  = matrix.row_offsets[row + 1];
+
+		for (uint32_t i = first + 1; i < last; ++i) {
+			uint32_t column = matrix.columns[i];
+			float value     = matrix.values[i];
+
+			uint32_t j = i;
+			for (; j > first && matrix.columns[j - 1] > column; --j) {
+				matrix.columns[j] = matrix.columns[j - 1];
+				matrix.values[j]  = matrix.values[j - 1];
+			}
+			matrix.columns[j] = column;
+			matrix.values[j]  = value;
+		}
+
+		matrix.row_offsets[row] = write;
+
+		for (uint32_t i = first; i < last; ++i) {
+			if (write > matrix.row_offsets[row] && matrix.columns[write - 1] == matrix.columns[i]) {
+				matrix.values[write - 1] += matrix.values[i];
+			} else {
+				matrix.columns[write] = matrix.columns[i];
+				matrix.values[write]  = matrix.values[i];
+				write += 1;
+			}
+		}
+	}
+
+	matrix.row_offsets[rows] = write;
+	matrix.nonzeros          = write;
+
+	return matrix;
+}
+
+void FreeSparseMatrix(Sparse_Matrix *matrix, M_Allocator allocator) {
+	if (matrix->row_offsets)
+		M_Free(matrix->row_offsets, sizeof(uint32_t) * (matrix->rows + 1), allocator);
+	if (matrix->columns)
+		M_Free(matrix->columns, sizeof(uint32_t) * matrix->capacity, allocator);
+	if (matrix->values)
+		M_Free(matrix->values, sizeof(float) * matrix->capacity, allocator);
+	memset(matrix, 0, sizeof(*matrix));
+}
+
+void Transform(Vector *dst, const Sparse_Matrix &m, const Vector &v) {
+	Vector &result = *dst;
+
+	Assert(result.d == m.rows && m.rows == v.d);
+
+	for (uint32_t row = 0; row < m.rows; ++row) {
+		float acc = 0;
+		for (uint32_t i = m.row_offsets[row]; i < m.row_offsets[row + 1]; ++i) {
+			acc += m.values[i] * v[m.columns[i]];
+		}
+		result[row] = acc;
+	}
+}
+
+static float Dot(const Vector &a, const Vector &b) {
+	float acc = 0;
+	for (uint32_t i = 0; i < a.d; ++i) {
+		acc += a[i] * b[i];
+	}
+	return acc;
+}
+
+uint32_t SolveConjugateGradient(const Sparse_Matrix &a, const Vector &b, Vector *x, uint32_t max_iterations, float tolerance) {
+	uint32_t d = a.rows;
+
+	Assert(b.d == d && x->d == d);
+
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	Vector r   = { d, M_PushArray(arena, float, d) };
+	Vector z   = { d, M_PushArray(arena, float, d) };
+	Vector p   = { d, M_PushArray(arena, float, d) };
+	Vector ap  = { d, M_PushArray(arena, float, d) };
+	Vector inv = { d, M_PushArray(arena, float, d) };
+
+	for (uint32_t row = 0; row < d; ++row) {
+		float diagonal = 0;
+		for (uint32_t i = a.row_offsets[row]; i < a.row_offsets[row + 1]; ++i) {
+			if (a.columns[i] == row) {
+				diagonal = a.values[i];
+				break;
+			}
+		}
+		inv[row] = diagonal != 0 ? 1.0f / diagonal : 1.0f;
+	}
+
+	Transform(&r, a, *x);
+	for (uint32_t i = 0; i < d; ++i) {
+		r[i] = b[i] - r[i];
+		z[i] = inv[i] * r[i];
+		p[i] = z[i];
+	}
+
+	float threshold = tolerance * tolerance * Max(Dot(b, b), 1e-20f);
+	float rz        = Dot(r, z);
+
+	uint32_t iteration = 0;
+
+	for (; iteration < max_iterations; ++iteration) {
+		if (Dot(r, r) <= threshold)
+			break;
+
+		Transform(&ap, a, p);
+
+		float pap = Dot(p, ap);
+		if (pap <= 0)
+			break; // Not positive definite along p
+
+		float alpha = rz / pap;
+
+		for (uint32_t i = 0; i < d; ++i) {
+			(*x)[i] += alpha * p[i];
+			r[i]    -= alpha * ap[i];
+			z[i]     = inv[i] * r[i];
+		}
+
+		float rz_next = Dot(r, z);
+		float beta    = rz_next / rz;
+		rz            = rz_next;
+
+		for (uint32_t i = 0; i < d; ++i) {
+			p[i] = z[i] + beta * p[i];
+		}
+	}
+
+	return iteration;
+}
@@ -1 +1,62 @@
 #pragma once
+#include "Kr/KrCommon.h"
+
+struct Matrix {
+	uint32_t d;
+	float   *m;
+
+	float *operator[](uint32_t y) {
+		Assert(y < d);
+		return &m[y * d];
+	}
+
+	const float *operator[](uint32_t y) const {
+		Assert(y < d);
+		return &m[y * d];
+	}
+};
+
+struct Vector {
+	uint32_t d;
+	float   *m;
+
+	float &operator[](uint32_t i) {
+		Assert(i < d);
+		return m[i];
+	}
+
+	const float &operator[](uint32_t i) const {
+		Assert(i < d);
+		return m[i];
+	}
+};
+
+void Multiply(Matrix *dst, const Matrix &l, const Matrix &r);
+void Transform(Vector *dst, const Matrix &m, const Vector &v);
+void TransformTransposed(Vector *dst, const Matrix &m, const Vector &v);
+
+// Compressed sparse row matrix, columns are sorted within each row
+struct Sparse_Matrix {
+	uint32_t  rows;
+	uint32_t  nonzeros;
+	uint32_t  capacity;    // allocated columns and values, more than nonzeros when duplicates are merged
+	uint32_t *row_offsets; // rows + 1 entries
+	uint32_t *columns;
+	float    *values;
+};
+
+struct Sparse_Entry {
+	uint32_t row;
+	uint32_t column;
+	float    value;
+};
+
+// Duplicate entries are summed, returns an empty matrix (no rows) when out of memory
+Sparse_Matrix BuildSparseMatrix(uint32_t rows, Array_View<Sparse_Entry> entries, M_Allocator allocator);
+void          FreeSparseMatrix(Sparse_Matrix *matrix, M_Allocator allocator);
+
+void Transform(Vector *dst, const Sparse_Matrix &m, const Vector &v);
+
+// Solves Ax = b for symmetric positive definite A using Jacobi preconditioned conjugate gradient
+// x is used as the initial guess, returns the number of iterations taken
+uint32_t SolveConjugateGradient(const Sparse_Matrix &a, const Vector &b, Vector *x, uint32_t max_iterations, float tolerance);
@@ -0,0 +1,167 @@
+#include "KrSpatialHash.h"
+
+static inline int32_t SpatialCell(float v, float inv_cell_size) {
+	return (int32_t)Floor(v * inv_cell_size);
+}
+
+static inline uint32_t SpatialBucket(int32_t x, int32_t y, uint32_t mask) {
+	return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u)) & mask;
+}
+
+static inline bool IsInCell(const Spatial_Hash &hash, Vec2 p, int32_t x, int32_t y) {
+	return SpatialCell(p.x, hash.inv_cell_size) == x && SpatialCell(p.y, hash.inv_cell_size) == y;
+}
+
+void BuildSpatialHash(Spatial_Hash *hash, const Vec2 *points, uint32_t count, float cell_size) {
+	Assert(cell_size > 0.0f);
+
+	uint32_t table_size = 64;
+	while (table_size < 2 * count)
+		table_size <<= 1;
+
+	hash->cell_size     = cell_size;
+	hash->inv_cell_size = 1.0f / cell_size;
+	hash->table_mask    = table_size - 1;
+	hash->points        = points;
+	hash->point_count   = count;
+
+	Resize(&hash->starts, table_size + 1);
+	Resize(&hash->indices, count);
+	Resize(&hash->buckets, count);
+
+	memset(hash->starts.data, 0, ArrSizeInBytes(hash->starts));
+
+	for (uint32_t index = 0; index < count; ++index) {
+		int32_t x = SpatialCell(points[index].x, hash->inv_cell_size);
+		int32_t y = SpatialCell(points[index].y, hash->inv_cell_size);
+
+		uint32_t bucket = SpatialBucket(x, y, hash->table_mask);
+		hash->buckets[index] = bucket;
+		hash->starts[bucket] += 1;
+	}
+
+	// Inclusive prefix sum, starts[b] is the end of bucket b
+	for (uint32_t bucket = 1; bucket < table_size; ++bucket) {
+		hash->starts[bucket] += hash->starts[bucket - 1];
+	}
+	hash->starts[table_size] = count;
+
+	// Scatter backwards so that starts[b] moves to the beginning of bucket b, order within a bucket is kept
+	for (uint32_t index = count; index > 0; --index) {
+		uint32_t bucket = hash->buckets[index - 1];
+		hash->indices[--hash->starts[bucket]] = index - 1;
+	}
+}
+
+void FreeSpatialHash(Spatial_Hash *hash) {
+	Free(&hash->starts);
+	Free(&hash->indices);
+	Free(&hash->buckets);
+	hash->points      = nullptr;
+	hash->point_count = 0;
+}
+
+bool QueryNearestPoint(const Spatial_Hash &hash, Vec2 p, float max_dist, uint32_t *index, float *dist) {
+	if (hash.point_count == 0)
+		return false;
+
+	int32_t cx = SpatialCell(p.x, hash.inv_cell_size);
+	int32_t cy = SpatialCell(p.y, hash.inv_cell_size);
+
+	float best2   = max_dist * max_dist;
+	bool  found   = false;
+	int32_t rings = (int32_t)Ceil(max_dist * hash.inv_cell_size);
+
+	for (int32_t ring = 0; ring <= rings; ++ring) {
+		// Every point in this ring is at least (ring - 1) cells away
+		float reach = (float)(ring - 1) * hash.cell_size;
+		if (found && reach > 0.0f && reach * reach > best2)
+			break;
+
+		for (int32_t y = cy - ring; y <= cy + ring; ++y) {
+			bool edge_row = (y == cy - ring || y == cy + ring);
+			int32_t step  = edge_row ? 1 : 2 * ring;
+
+			for (int32_t x = cx - ring; x <= cx + ring; x += Max(step, 1)) {
+				uint32_t bucket = SpatialBucket(x, y, hash.table_mask);
+
+				for (uint32_t k = hash.starts[bucket]; k < hash.starts[bucket + 1]; ++k) {
+					uint32_t point = hash.indices[k];
+					float d2 = LengthSq(hash.points[point] - p);
+					if (d2 <= best2) {
+						best2  = d2;
+						*index = point;
+						found  = true;
+					}
+				}
+			}
+		}
+	}
+
+	if (found)
+		*dist = SquareRoot(best2);
+
+	return found;
+}
+
+uint32_t QueryRadius(const Spatial_Hash &hash, Vec2 p, float radius, Array<uint32_t> *result) {
+	int32_t min_x = SpatialCell(p.x - radius, hash.inv_cell_size);
+	int32_t max_x = SpatialCell(p.x + radius, hash.inv_cell_size);
+	int32_t min_y = SpatialCell(p.y - radius, hash.inv_cell_size);
+	int32_t max_y = SpatialCell(p.y + radius, hash.inv_cell_size);
+
+	float radius2  = radius * radius;
+	uint32_t count = 0;
+
+	for (int32_t y = min_y; y <= max_y; ++y) {
+		for (int32_t x = min_x; x <= max_x; ++x) {
+			uint32_t bucket = SpatialBucket(x, y, hash.table_mask);
+
+			for (uint32_t k = hash.starts[bucket]; k < hash.starts[bucket + 1]; ++k) {
+				uint32_t point = hash.indices[k];
+				Vec2 q = hash.points[point];
+
+				// Different cells can share a bucket, only report the point from its own cell
+				if (!IsInCell(hash, q, x, y)) continue;
+
+				if (LengthSq(q - p) <= radius2) {
+					Append(result, point);
+					count += 1;
+				}
+			}
+		}
+	}
+
+	return count;
+}
+
+void QueryPairs(const Spatial_Hash &hash, float radius, Array<Spatial_Pair> *pairs) {
+	Assert(radius <= hash.cell_size);
+
+	float radius2 = radius * radius;
+
+	for (uint32_t a = 0; a < hash.point_count; ++a) {
+		Vec2 p = hash.points[a];
+
+		int32_t cx = SpatialCell(p.x, hash.inv_cell_size);
+		int32_t cy = SpatialCell(p.y, hash.inv_cell_size);
+
+		for (int32_t y = cy - 1; y <= cy + 1; ++y) {
+			for (int32_t x = cx - 1; x <= cx + 1; ++x) {
+				uint32_t bucket = SpatialBucket(x, y, hash.table_mask);
+
+				for (uint32_t k = hash.starts[bucket]; k < hash.starts[bucket + 1]; ++k) {
+					uint32_t b = hash.indices[k];
+					if (b <= a) continue;
+
+					Vec2 q = hash.points[b];
+					if (!IsInCell(hash, q, x, y)) continue;
+
+					if (LengthSq(q - p) < radius2) {
+						Append(pairs, Spatial_Pair{ a, b });
+					}
+				}
+			}
+		}
+	}
+}
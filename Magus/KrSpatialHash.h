@@ -0,0 +1,33 @@
+#pragma once
+#include "Kr/KrMath.h"
+#include "Kr/KrArray.h"
+
+// Uniform grid hashed into a fixed size table, rebuilt from scratch with a counting sort
+// Points in a bucket are stored contiguously in "indices", [starts[b], starts[b + 1])
+struct Spatial_Hash {
+	float           cell_size     = 1.0f;
+	float           inv_cell_size = 1.0f;
+	uint32_t        table_mask    = 0;
+
+	const Vec2 *    points        = nullptr;
+	uint32_t        point_count   = 0;
+
+	Array<uint32_t> starts;
+	Array<uint32_t> indices;
+	Array<uint32_t> buckets; // bucket of each point
+};
+
+struct Spatial_Pair {
+	uint32_t a, b;
+};
+
+// points must be kept alive (and unchanged) until the next build
+void     BuildSpatialHash(Spatial_Hash *hash, const Vec2 *points, uint32_t count, float cell_size);
+void     FreeSpatialHash(Spatial_Hash *hash);
+
+// Returns false if there is no point within max_dist of p
+bool     QueryNearestPoint(const Spatial_Hash &hash, Vec2 p, float max_dist, uint32_t *index, float *dist);
+uint32_t QueryRadius(const Spatial_Hash &hash, Vec2 p, float radius, Array<uint32_t> *result);
+
+// All pairs (a < b) closer than radius, radius must not be larger than the cell size
+void     QueryPairs(const Spatial_Hash &hash, float radius, Array<Spatial_Pair> *pairs);
@@ -0,0 +1,506 @@
+#include "KrTriangulate.h"
+
+#include <string.h>
+#include <algorithm>
+
+enum Polygon_Vertex_Type {
+	POLYGON_VERTEX_REGULAR,
+	POLYGON_VERTEX_START,
+	POLYGON_VERTEX_END,
+	POLYGON_VERTEX_SPLIT,
+	POLYGON_VERTEX_MERGE,
+};
+
+// Positive when a, b, c turn counter clockwise
+static inline float PolygonOrient(Vec2 a, Vec2 b, Vec2 c) {
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// Monotone with the counter clockwise angle of d, in [0, 4)
+static inline float PolygonPseudoAngle(Vec2 d) {
+	float p = d.y / (Abs(d.x) + Abs(d.y));
+	if (d.x < 0.0f) return 2.0f - p;
+	if (d.y < 0.0f) return 4.0f + p;
+	return p;
+}
+
+bool IsConvexPolygon(const Vec2 *points, uint32_t count) {
+	if (count < 3) return false;
+
+	float sign  = 0.0f;
+	float dx    = 0.0f;
+	float first = 0.0f;
+	int   flips = 0;
+
+	for (uint32_t index = 0; index < count; ++index) {
+		Vec2 a = points[index];
+		Vec2 b = points[(index + 1) % count];
+		Vec2 c = points[(index + 2) % count];
+
+		float turn = PolygonOrient(a, b, c);
+		if (turn != 0.0f) {
+			if (sign == 0.0f)
+				sign = turn;
+			else if ((turn > 0.0f) != (sign > 0.0f))
+				return false;
+		}
+
+		float next_dx = b.x - a.x;
+		if (next_dx != 0.0f) {
+			if (dx != 0.0f && (next_dx > 0.0f) != (dx > 0.0f))
+				flips += 1;
+			if (first == 0.0f)
+				first = next_dx;
+			dx = next_dx;
+		}
+	}
+
+	if (first != 0.0f && (first > 0.0f) != (dx > 0.0f))
+		flips += 1;
+
+	// Polygons that wind more than once, like stars, change their horizontal direction more than twice
+	return sign != 0.0f && flips == 2;
+}
+
+static inline uint32_t PolygonNext(const Polygon_Triangulator &t, uint32_t index) {
+	return t.next[index];
+}
+
+static inline uint32_t PolygonPrev(const Polygon_Triangulator &t, uint32_t index) {
+	return t.prev[index];
+}
+
+static inline bool PolygonBelow(const Polygon_Triangulator &t, uint32_t a, uint32_t b) {
+	return t.rank[a] > t.rank[b];
+}
+
+static Polygon_Vertex_Type PolygonVertexType(const Polygon_Triangulator &t, uint32_t index) {
+	uint32_t prev = PolygonPrev(t, index);
+	uint32_t next = PolygonNext(t, index);
+
+	bool prev_below = PolygonBelow(t, prev, index);
+	bool next_below = PolygonBelow(t, next, index);
+
+	if (prev_below != next_below)
+		return POLYGON_VERTEX_REGULAR;
+
+	bool convex = PolygonOrient(t.points[prev], t.points[index], t.points[next]) > 0.0f;
+	if (prev_below)
+		return convex ? POLYGON_VERTEX_START : POLYGON_VERTEX_SPLIT;
+	return convex ? POLYGON_VERTEX_END : POLYGON_VERTEX_MERGE;
+}
+
+// True when the point is strictly right of the edge starting at the given point
+// A point at the same position as an end of the edge is right of it when it comes later in the sweep,
+// as if points were moved apart by their order
+static bool PolygonRightOfEdge(const Polygon_Triangulator &t, uint32_t edge, uint32_t point) {
+	uint32_t upper = edge;
+	uint32_t lower = PolygonNext(t, edge);
+	if (PolygonBelow(t, upper, lower)) {
+		upper = lower;
+		lower = edge;
+	}
+
+	Vec2 p = t.points[point];
+	float turn = PolygonOrient(t.points[upper], t.points[lower], p);
+	if (turn != 0.0f) return turn > 0.0f;
+
+	if (IsNull(t.points[upper] - p)) return PolygonBelow(t, point, upper);
+	if (IsNull(t.points[lower] - p)) return PolygonBelow(t, point, lower);
+	return false;
+}
+
+// Number of edges in the status that are left of the point
+static uint32_t PolygonStatusSearch(const Polygon_Triangulator &t, uint32_t point) {
+	uint32_t first = 0;
+	uint32_t last  = (uint32_t)t.status.count;
+	while (first < last) {
+		uint32_t mid = (first + last) / 2;
+		if (PolygonRightOfEdge(t, t.status[mid], point))
+			first = mid + 1;
+		else
+			last = mid;
+	}
+	return first;
+}
+
+static bool PolygonStatusInsert(Polygon_Triangulator *t, uint32_t edge) {
+	uint32_t position = PolygonStatusSearch(*t, edge);
+	if (!Append(&t->status, edge))
+		return false;
+	memmove(t->status.data + position + 1, t->status.data + position, sizeof(uint32_t) * (t->status.count - position - 1));
+	t->status[position] = edge;
+	return true;
+}
+
+static bool PolygonStatusRemove(Polygon_Triangulator *t, uint32_t edge, uint32_t lower) {
+	// The edge ends at lower, so it is never left of it, only edges touching lower are skipped
+	for (uint32_t index = PolygonStatusSearch(*t, lower); index < (uint32_t)t->status.count; ++index) {
+		if (t->status[index] == edge) {
+			Remove(&t->status, index);
+			return true;
+		}
+	}
+	for (uint32_t index = 0; index < (uint32_t)t->status.count; ++index) {
+		if (t->status[index] == edge) {
+			Remove(&t->status, index);
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool PolygonStatusLeft(const Polygon_Triangulator &t, uint32_t point, uint32_t *edge) {
+	uint32_t position = PolygonStatusSearch(t, point);
+	if (!position) return false;
+	*edge = t.status[position - 1];
+	return true;
+}
+
+static void PolygonDiagonal(Polygon_Triangulator *t, uint32_t a, uint32_t b) {
+	Append(&t->diagonals, a);
+	Append(&t->diagonals, b);
+}
+
+// Swapping the successors of two points at the same position splits a loop in two at that position,
+// or joins two loops into one
+static void PolygonSwapLoops(Polygon_Triangulator *t, uint32_t a, uint32_t b) {
+	uint32_t next = t->next[a];
+	t->next[a] = t->next[b];
+	t->next[b] = next;
+	t->prev[t->next[a]] = a;
+	t->prev[t->next[b]] = b;
+}
+
+// Ends the edge arriving at point
+static bool PolygonCloseEdge(Polygon_Triangulator *t, uint32_t point) {
+	uint32_t edge = PolygonPrev(*t, point);
+	if (PolygonVertexType(*t, t->helpers[edge]) == POLYGON_VERTEX_MERGE)
+		PolygonDiagonal(t, point, t->helpers[edge]);
+	return PolygonStatusRemove(t, edge, point);
+}
+
+static bool PolygonOpenEdge(Polygon_Triangulator *t, uint32_t point) {
+	t->helpers[point] = point;
+	return PolygonStatusInsert(t, point);
+}
+
+// Makes point the helper of the edge left of it
+static bool PolygonHelpLeft(Polygon_Triangulator *t, uint32_t point, bool split) {
+	uint32_t edge;
+	if (!PolygonStatusLeft(*t, point, &edge))
+		return false;
+	if (split || PolygonVertexType(*t, t->helpers[edge]) == POLYGON_VERTEX_MERGE)
+		PolygonDiagonal(t, point, t->helpers[edge]);
+	t->helpers[edge] = point;
+	return true;
+}
+
+static bool PolygonSplitMonotone(Polygon_Triangulator *t) {
+	for (uint32_t point : t->order) {
+		switch (PolygonVertexType(*t, point)) {
+			case POLYGON_VERTEX_START: {
+				if (!PolygonOpenEdge(t, point)) return false;
+			} break;
+
+			case POLYGON_VERTEX_END: {
+				if (!PolygonCloseEdge(t, point)) return false;
+			} break;
+
+			case POLYGON_VERTEX_SPLIT: {
+				if (!PolygonHelpLeft(t, point, true)) return false;
+				if (!PolygonOpenEdge(t, point)) return false;
+			} break;
+
+			case POLYGON_VERTEX_MERGE: {
+				if (!PolygonCloseEdge(t, point)) return false;
+				if (!PolygonHelpLeft(t, point, false)) return false;
+			} break;
+
+			case POLYGON_VERTEX_REGULAR: {
+				// Points going down the left side have the inside on their right
+				if (PolygonBelow(*t, point, PolygonPrev(*t, point))) {
+					if (!PolygonCloseEdge(t, point)) return false;
+					if (!PolygonOpenEdge(t, point)) return false;
+				} else {
+					if (!PolygonHelpLeft(t, point, false)) return false;
+				}
+			} break;
+		}
+	}
+	return true;
+}
+
+static void PolygonTriangle(Polygon_Triangulator *t, uint32_t a, uint32_t b, uint32_t c) {
+	if (PolygonOrient(t->points[a], t->points[b], t->points[c]) < 0.0f) {
+		uint32_t swap = b;
+		b = c;
+		c = swap;
+	}
+	Append(&t->indices, t->source[a]);
+	Append(&t->indices, t->source[b]);
+	Append(&t->indices, t->source[c]);
+}
+
+// Triangulates the monotone piece in t->piece, counter clockwise
+static void PolygonTriangulateMonotone(Polygon_Triangulator *t) {
+	const uint32_t *piece = t->piece.data;
+	uint32_t count = (uint32_t)t->piece.count;
+
+	if (count == 3) {
+		PolygonTriangle(t, piece[0], piece[1], piece[2]);
+		return;
+	}
+
+	uint32_t top = 0, bottom = 0;
+	for (uint32_t index = 1; index < count; ++index) {
+		if (t->rank[piece[index]] < t->rank[piece[top]]) top = index;
+		if (t->rank[piece[index]] > t->rank[piece[bottom]]) bottom = index;
+	}
+
+	// Counter clockwise from the top runs down the left chain, clockwise runs down the right chain
+	// Points are merged from top to bottom with the chain in the highest bit
+	constexpr uint32_t RIGHT_CHAIN = 0x80000000u;
+
+	if (!Resize(&t->stack, count))
+		return;
+
+	uint32_t *sorted = t->stack.data;
+	uint32_t  left   = top + 1 < count ? top + 1 : 0;
+	uint32_t  right  = top ? top - 1 : count - 1;
+
+	sorted[0] = piece[top];
+
+	for (uint32_t index = 1; index < count; ++index) {
+		if (left != bottom && (right == bottom || t->rank[piece[left]] < t->rank[piece[right]])) {
+			sorted[index] = piece[left];
+			left = left + 1 < count ? left + 1 : 0;
+		} else if (right != bottom) {
+			sorted[index] = piece[right] | RIGHT_CHAIN;
+			right = right ? right - 1 : count - 1;
+		} else {
+			sorted[index] = piece[bottom];
+		}
+	}
+
+	// The stack is reused for the sweep, the sorted points are moved to the piece
+	memcpy(t->piece.data, sorted, sizeof(uint32_t) * count);
+	sorted = t->piece.data;
+	Reset(&t->stack);
+
+	Append(&t->stack, sorted[0]);
+	Append(&t->stack, sorted[1]);
+
+	for (uint32_t index = 2; index + 1 < count; ++index) {
+		uint32_t current = sorted[index];
+		uint32_t point   = current & ~RIGHT_CHAIN;
+
+		if ((current & RIGHT_CHAIN) != (Last(t->stack) & RIGHT_CHAIN)) {
+			for (ptrdiff_t s = 1; s < t->stack.count; ++s)
+				PolygonTriangle(t, point, t->stack[s] & ~RIGHT_CHAIN, t->stack[s - 1] & ~RIGHT_CHAIN);
+			Reset(&t->stack);
+			Append(&t->stack, sorted[index - 1]);
+			Append(&t->stack, current);
+		} else {
+			uint32_t popped = Last(t->stack);
+			Pop(&t->stack);
+
+			while (t->stack.count) {
+				uint32_t a = popped & ~RIGHT_CHAIN;
+				uint32_t b = Last(t->stack) & ~RIGHT_CHAIN;
+
+				float turn = (current & RIGHT_CHAIN) ?
+					PolygonOrient(t->points[point], t->points[a], t->points[b]) :
+					PolygonOrient(t->points[b], t->points[a], t->points[point]);
+				if (turn <= 0.0f) break;
+
+				PolygonTriangle(t, point, a, b);
+				popped = Last(t->stack);
+				Pop(&t->stack);
+			}
+
+			Append(&t->stack, popped);
+			Append(&t->stack, current);
+		}
+	}
+
+	uint32_t last = sorted[count - 1] & ~RIGHT_CHAIN;
+	for (ptrdiff_t s = 1; s < t->stack.count; ++s)
+		PolygonTriangle(t, last, t->stack[s] & ~RIGHT_CHAIN, t->stack[s - 1] & ~RIGHT_CHAIN);
+}
+
+// Walks the faces of the polygon split by the diagonals, every face is a monotone piece
+static bool PolygonTriangulatePieces(Polygon_Triangulator *t) {
+	// Diagonals between points at the same position have no direction, the loops are joined there instead
+	uint32_t diagonals = 0;
+	for (ptrdiff_t index = 0; index < t->diagonals.count; index += 2) {
+		uint32_t a = t->diagonals[index];
+		uint32_t b = t->diagonals[index + 1];
+		if (IsNull(t->points[a] - t->points[b])) {
+			PolygonSwapLoops(t, a, b);
+		} else {
+			t->diagonals[diagonals++] = a;
+			t->diagonals[diagonals++] = b;
+		}
+	}
+	t->diagonals.count = diagonals;
+
+	uint32_t count     = (uint32_t)t->points.count;
+	uint32_t total     = count + diagonals;
+
+	if (!Resize(&t->starts, count + 1) || !Resize(&t->edges, total) || !Resize(&t->visited, total) || !Resize(&t->stack, count))
+		return false;
+
+	memset(t->starts.data, 0, sizeof(uint32_t) * (count + 1));
+	memset(t->visited.data, 0, total);
+
+	for (uint32_t point = 0; point < count; ++point)
+		t->starts[point + 1] += 1;
+	for (uint32_t point : t->diagonals)
+		t->starts[point + 1] += 1;
+	for (uint32_t point = 0; point < count; ++point)
+		t->starts[point + 1] += t->starts[point];
+
+	// The boundary edge is the first outgoing edge of every point, diagonals go both ways
+	for (uint32_t point = 0; point < count; ++point)
+		t->edges[t->starts[point]] = PolygonNext(*t, point);
+
+	// Next free slot of each point
+	for (uint32_t point = 0; point < count; ++point)
+		t->stack[point] = t->starts[point] + 1;
+
+	for (uint32_t index = 0; index < diagonals; index += 2) {
+		uint32_t a = t->diagonals[index];
+		uint32_t b = t->diagonals[index + 1];
+		t->edges[t->stack[a]++] = b;
+		t->edges[t->stack[b]++] = a;
+	}
+
+	for (uint32_t first = 0; first < total; ++first) {
+		if (t->visited[first]) continue;
+
+		// Origin of the first edge
+		uint32_t from = (uint32_t)(std::upper_bound(t->starts.data, t->starts.data + count + 1, first) - t->starts.data) - 1;
+
+		Reset(&t->piece);
+
+		uint32_t edge = first;
+		while (!t->visited[edge]) {
+			t->visited[edge] = 1;
+			Append(&t->piece, from);
+
+			uint32_t to = t->edges[edge];
+
+			// The face continues with the outgoing edge closest clockwise from the way back
+			float back = PolygonPseudoAngle(t->points[from] - t->points[to]);
+			float best = 5.0f;
+			uint32_t next = edge;
+			for (uint32_t out = t->starts[to]; out < t->starts[to + 1]; ++out) {
+				float angle = back - PolygonPseudoAngle(t->points[t->edges[out]] - t->points[to]);
+				if (angle <= 0.0f) angle += 4.0f;
+				if (angle < best) {
+					best = angle;
+					next = out;
+				}
+			}
+
+			from = to;
+			edge = next;
+		}
+
+		if (edge != first || t->piece.count < 3)
+			return false;
+
+		PolygonTriangulateMonotone(t);
+	}
+
+	return true;
+}
+
+bool TriangulatePolygon(Polygon_Triangulator *t, const Vec2 *points, uint32_t count) {
+	Reset(&t->points);
+	Reset(&t->source);
+	Reset(&t->status);
+	Reset(&t->diagonals);
+	Reset(&t->indices);
+
+	float area = 0.0f;
+	for (uint32_t index = 0; index < count; ++index) {
+		Vec2 a = points[index];
+		Vec2 b = points[(index + 1) % count];
+		area += a.x * b.y - b.x * a.y;
+	}
+
+	// Repeated points have no direction, they are dropped
+	for (uint32_t step = 0; step < count; ++step) {
+		uint32_t index = area >= 0.0f ? step : count - 1 - step;
+		if (t->points.count && IsNull(Last(t->points) - points[index]))
+			continue;
+		Append(&t->points, points[index]);
+		Append(&t->source, index);
+	}
+
+	while (t->points.count > 1 && IsNull(Last(t->points) - t->points[0])) {
+		Pop(&t->points);
+		Pop(&t->source);
+	}
+
+	uint32_t n = (uint32_t)t->points.count;
+	if (n < 3 || area == 0.0f)
+		return true;
+
+	if (t->source.count != n || !Resize(&t->order, n) || !Resize(&t->rank, n) || !Resize(&t->helpers, n) ||
+		!Resize(&t->next, n) || !Resize(&t->prev, n))
+		return false;
+
+	for (uint32_t index = 0; index < n; ++index) {
+		t->order[index] = index;
+		t->next[index]  = index + 1 < n ? index + 1 : 0;
+		t->prev[index]  = index ? index - 1 : n - 1;
+	}
+
+	// Top to bottom, points at the same height from left to right
+	const Vec2 *sorted = t->points.data;
+	std::sort(t->order.data, t->order.data + n, [sorted](uint32_t a, uint32_t b) {
+		if (sorted[a].y != sorted[b].y) return sorted[a].y > sorted[b].y;
+		if (sorted[a].x != sorted[b].x) return sorted[a].x < sorted[b].x;
+		return a < b;
+	});
+
+	for (uint32_t index = 0; index < n; ++index)
+		t->rank[t->order[index]] = index;
+
+	// Where the polygon touches itself, the boundary is split into separate loops that share the point,
+	// the loop enclosed by the other one winds clockwise and is swept as a hole
+	for (uint32_t index = 1; index < n; ++index) {
+		uint32_t a = t->order[index - 1];
+		uint32_t b = t->order[index];
+		if (IsNull(t->points[a] - t->points[b]))
+			PolygonSwapLoops(t, a, b);
+	}
+
+	if (!PolygonSplitMonotone(t) || !PolygonTriangulatePieces(t)) {
+		Reset(&t->indices);
+		return false;
+	}
+
+	return true;
+}
+
+void FreePolygonTriangulator(Polygon_Triangulator *t) {
+	Free(&t->points);
+	Free(&t->source);
+	Free(&t->order);
+	Free(&t->rank);
+	Free(&t->helpers);
+	Free(&t->next);
+	Free(&t->prev);
+	Free(&t->status);
+	Free(&t->diagonals);
+	Free(&t->starts);
+	Free(&t->edges);
+	Free(&t->visited);
+	Free(&t->piece);
+	Free(&t->stack);
+	Free(&t->indices);
+}
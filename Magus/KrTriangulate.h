@@ -0,0 +1,34 @@
+#pragma once
+#include "Kr/KrMath.h"
+#include "Kr/KrArray.h"
+
+// Triangulates simple polygons, convex or concave, in O(n log n): a sweep line from top to bottom adds the
+// diagonals that split the polygon into y-monotone pieces, then each piece is triangulated with a stack
+// Vertices may touch other vertices of the polygon, edges must not cross
+// The arrays are kept between calls, so triangulating every frame does not allocate once they have grown
+struct Polygon_Triangulator {
+	Array<Vec2>     points;    // counter clockwise copy of the input
+	Array<uint32_t> source;    // input index of each point
+	Array<uint32_t> next;      // boundary loops, split where the polygon touches itself
+	Array<uint32_t> prev;
+	Array<uint32_t> order;     // points from top to bottom
+	Array<uint32_t> rank;      // position of each point in order
+	Array<uint32_t> helpers;   // helper of the edge starting at each point
+	Array<uint32_t> status;    // edges crossing the sweep line, from left to right
+	Array<uint32_t> diagonals; // pairs of points
+	Array<uint32_t> starts;    // outgoing edges of each point are in edges, [starts[p], starts[p + 1])
+	Array<uint32_t> edges;     // end point of each outgoing edge
+	Array<uint8_t>  visited;
+	Array<uint32_t> piece;
+	Array<uint32_t> stack;
+
+	Array<uint32_t> indices;   // result, three input indices per triangle
+};
+
+// True when every turn of the polygon bends the same way and it winds once
+bool IsConvexPolygon(const Vec2 *points, uint32_t count);
+
+// Returns false when the polygon could not be split into monotone pieces, which only happens for
+// self-intersecting input. Triangles are written counter clockwise in indices, degenerate input gives none
+bool TriangulatePolygon(Polygon_Triangulator *triangulator, const Vec2 *points, uint32_t count);
+void FreePolygonTriangulator(Polygon_Triangulator *triangulator);
@@ -11,6 +11,11 @@
 #include "RenderBackend.h"
 #include "Render2dBackend.h"
 #include "ResourceLoaders/Loaders.h"
+#include "Jobs.h"
+#include "KrSolver.h"
+#include "KrSpatialHash.h"
+#include "KrEdgeColoring.h"
+#include "Benchmark.h"
 
 //#include "KrPhysics.h"
 //#include "KrCollision.h"
@@ -530,8 +535,30 @@ struct Rigid_Body {
 
 Rigid_Body bodies[MAX_STATE];
 
+// Derivative of the force on body i with respect to the position (dx) and velocity (dv) of body j
+// Velocity derivatives are isotropic for all the generators, so dv is a scale of identity
+struct Force_Derivative {
+	uint  i, j;
+	float dx[2][2];
+	float dv;
+};
+
+void AppendForceDerivative(Array<Force_Derivative> *derivatives, uint i, uint j, const float (&dx)[2][2], float dv, float sign) {
+	Force_Derivative *d = Append(derivatives);
+	d->i = i;
+	d->j = j;
+	for (int r = 0; r < 2; ++r) {
+		for (int c = 0; c < 2; ++c)
+			d->dx[r][c] = sign * dx[r][c];
+	}
+	d->dv = sign * dv;
+}
+
 struct Force_Generator {
 	virtual void Generate(Rigid_Body *bodies, const State &state, float t) = 0;
+
+	// Used by the implicit integrator, generators that don't append derivatives are treated explicitly
+	virtual void Differentiate(Array<Force_Derivative> *derivatives, const State &state) {}
 };
 
 struct Rope_Force_Generator : Force_Generator {
@@ -556,6 +583,33 @@ struct Rope_Force_Generator : Force_Generator {
 		bodies[i].force += f;
 		bodies[j].force -= f;
 	}
+
+	virtual void Differentiate(Array<Force_Derivative> *derivatives, const State &state) {
+		uint i = indices[0], j = indices[1];
+
+		Vec2 delta = state.x[i] - state.x[j];
+		float dist = Length(delta);
+
+		// Slack bungee doesn't generate any force
+		if (dist <= length || dist == 0.0f) return;
+
+		float n[2]  = { delta.x / dist, delta.y / dist };
+		float slack = 1.0f - length / dist;
+
+		float dx[2][2];
+		for (int r = 0; r < 2; ++r) {
+			for (int c = 0; c < 2; ++c) {
+				float outer = n[r] * n[c];
+				float ident = r == c ? 1.0f : 0.0f;
+				dx[r][c] = -k1 * (slack * (ident - outer) + outer);
+			}
+		}
+
+		AppendForceDerivative(derivatives, i, i, dx, -k2, 1.0f);
+		AppendForceDerivative(derivatives, i, j, dx, -k2, -1.0f);
+		AppendForceDerivative(derivatives, j, i, dx, -k2, -1.0f);
+		AppendForceDerivative(derivatives, j, j, dx, -k2, 1.0f);
+	}
 };
 
 void ClearForces() {
@@ -568,10 +622,92 @@ static Array<Rope_Force_Generator *> Forces;
 
 static Force_Generator *Dragging;
 
+//
+// Forces are colored by their bodies (see KrEdgeColoring.h), the batches of each color are generated
+// in parallel. Forces in the reduction are generated into per thread copies and summed afterwards.
+// The coloring is rebuilt when the forces change, every change must go through AddForce.
+//
+
+// Below this many forces per range, dispatching to the workers costs more than it saves
+constexpr uint32_t FORCE_MIN_GRAIN = 256;
+
+static Edge_Coloring  Coloring;
+static bool           ColoringDirty = true;
+static Rigid_Body     ReductionBodies[J_MAX_THREADS][MAX_STATE];
+
+void AddForce(Rope_Force_Generator *force) {
+	Append(&Forces, force);
+	ColoringDirty = true;
+}
+
+void ColorForces() {
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	Edge *edges = M_PushArray(arena, Edge, Forces.count);
+
+	for (ptrdiff_t index = 0; index < Forces.count; ++index) {
+		edges[index] = Edge{ Forces[index]->indices[0], Forces[index]->indices[1] };
+	}
+
+	ColorEdges(&Coloring, edges, (uint32_t)Forces.count, MAX_STATE);
+	ColoringDirty = false;
+}
+
+struct Force_Batch {
+	const State *   state;
+	float           t;
+	const uint32_t *forces;
+};
+
+static void GenerateForceBatch(void *data, uint32_t first, uint32_t last, uint32_t thread) {
+	Force_Batch *batch = (Force_Batch *)data;
+	for (uint32_t index = first; index < last; ++index) {
+		Forces[batch->forces[index]]->Generate(bodies, *batch->state, batch->t);
+	}
+}
+
+static void GenerateForceReduction(void *data, uint32_t first, uint32_t last, uint32_t thread) {
+	Force_Batch *batch = (Force_Batch *)data;
+	for (uint32_t index = first; index < last; ++index) {
+		Forces[batch->forces[index]]->Generate(ReductionBodies[thread], *batch->state, batch->t);
+	}
+}
+
 void ComputeForces(const State &state, float t) {
-	for (Force_Generator *force : Forces) {
-		force->Generate(bodies, state, t);
+	if (ColoringDirty)
+		ColorForces();
+
+	Force_Batch batch = { &state, t, Coloring.order.data };
+
+	uint32_t color_count = (uint32_t)Coloring.batches.count - 1;
+	for (uint32_t color = 0; color < color_count; ++color) {
+		uint32_t first = Coloring.batches[color];
+		uint32_t count = Coloring.batches[color + 1] - first;
+
+		batch.forces = Coloring.order.data + first;
+		J_ParallelFor(count, J_SplitGrain(count, FORCE_MIN_GRAIN), GenerateForceBatch, &batch);
 	}
+
+	if (Coloring.reduction.count) {
+		uint32_t threads = J_ThreadCount();
+
+		for (uint32_t thread = 0; thread < threads; ++thread) {
+			for (int i = 0; i < MAX_STATE; ++i)
+				ReductionBodies[thread][i].force = Vec2(0);
+		}
+
+		batch.forces = Coloring.reduction.data;
+		uint32_t count = (uint32_t)Coloring.reduction.count;
+		J_ParallelFor(count, J_SplitGrain(count, FORCE_MIN_GRAIN), GenerateForceReduction, &batch);
+
+		for (uint32_t thread = 0; thread < threads; ++thread) {
+			for (int i = 0; i < MAX_STATE; ++i)
+				bodies[i].force += ReductionBodies[thread][i].force;
+		}
+	}
+
 	if (Dragging) {
 		Dragging->Generate(bodies, state, t);
 	}
@@ -620,9 +756,28 @@ struct Dragging_Force_Generator : Force_Generator {
 
 		bodies[i].force += dist * k * NormalizeZ(pos - x);
 	}
+
+	virtual void Differentiate(Array<Force_Derivative> *derivatives, const State &state) {
+		float dx[2][2] = { { -k, 0.0f }, { 0.0f, -k } };
+		AppendForceDerivative(derivatives, i, i, dx, 0.0f, 1.0f);
+	}
 };
 
-uint FindNearestBody(const State &state, Vec2 p, float *dist) {
+constexpr float PARTICLE_RADIUS = 0.1f;
+
+// Cells of the body hashes are one particle diameter wide
+void BuildBodyHash(Spatial_Hash *hash, const State &state) {
+	BuildSpatialHash(hash, state.x, MAX_STATE, 2.0f * PARTICLE_RADIUS);
+}
+
+// Pairs of particles that overlap in the state, the hash is rebuilt for every call and never outlives it
+void QueryParticlePairs(const State &state, Array<Spatial_Pair> *pairs) {
+	static Spatial_Hash hash;
+	BuildBodyHash(&hash, state);
+	QueryPairs(hash, 2.0f * PARTICLE_RADIUS, pairs);
+}
+
+uint FindNearestBodyLinear(const State &state, Vec2 p, float *dist) {
 	float dist2  = LengthSq(p - state.x[0]);
 	uint nearest = 0;
 
@@ -639,6 +794,18 @@ uint FindNearestBody(const State &state, Vec2 p, float *dist) {
 	return nearest;
 }
 
+// hash must be built from the current positions of state, an empty hash falls back to the linear search
+uint FindNearestBody(const Spatial_Hash &hash, const State &state, Vec2 p, float max_dist, float *dist) {
+	if (hash.point_count == MAX_STATE) {
+		uint32_t nearest;
+		if (QueryNearestPoint(hash, p, max_dist, &nearest, dist))
+			return nearest;
+		*dist = max_dist;
+		return 0;
+	}
+	return FindNearestBodyLinear(state, p, dist);
+}
+
 enum Collision_Kind {
 	COLLISION_CLEAR,
 	COLLISION_COLLIDING,
@@ -648,6 +815,7 @@ enum Collision_Kind {
 struct Constraint {
 	float distance;
 	uint i, j;
+	float compliance = 0.0f; // inverse stiffness, only used by the XPBD solver
 };
 
 Array<Constraint> Constraints;
@@ -705,6 +873,30 @@ Collision DetectCollisions(const State &state, float epsilon) {
 		}
 	}
 
+	// Particle self collision
+	Array<Spatial_Pair> pairs;
+	pairs.allocator = M_GetArenaAllocator(ThreadScratchpad());
+	QueryParticlePairs(state, &pairs);
+
+	for (const Spatial_Pair &pair : pairs) {
+		Vec2 a = state.x[pair.a];
+		Vec2 b = state.x[pair.b];
+
+		float penetration = 2.0f * PARTICLE_RADIUS - Distance(a, b);
+
+		if (penetration > epsilon)
+			result.kind = COLLISION_PENETRATING;
+
+		Vec2 normal   = NormalizeZ(a - b);
+		Vec2 velocity = state.v[pair.b] - state.v[pair.a];
+
+		if (DotProduct(normal, velocity) > 0.0f) {
+			if (result.kind != COLLISION_PENETRATING)
+				result.kind = COLLISION_COLLIDING;
+			Append(&contacts, Contact{ 0.1f, penetration, normal, pair.a, pair.b });
+		}
+	}
+
 	result.contacts = contacts;
 
 	return result;
@@ -748,8 +940,268 @@ void ResolveCollisions(State *state, const Collision &collision, float dt) {
 	}
 }
 
+//
+// Dormand-Prince 5(4): The 4th order embedded solution estimates the local error which is used
+// to choose the next step size. The last stage is evaluated at the accepted state (FSAL),
+// so it is cached and reused as the first stage of the next step.
+//
+
+struct Adaptive_Settings {
+	float atol       = 1e-4f;
+	float rtol       = 1e-3f;
+	float safety     = 0.9f;
+	float min_factor = 0.2f;
+	float max_factor = 5.0f;
+	float min_dt     = 1e-5f;
+};
+
+struct Fsal_Cache {
+	State      state;
+	float      t;     // elapsed time into the frame the state is at
+	Derivative k;
+	bool       valid = false;
+};
+
+static Adaptive_Settings Adaptive;
+static Fsal_Cache        Fsal;
+static float             AdaptiveDt = 0.0f; // step size suggested by the last step
+
+void InvalidateIntegratorCache() {
+	Fsal.valid = false;
+}
+
+static Derivative EvaluateStage(const System &f, const State &state, float t, float h, float c, const Derivative &d) {
+	State stage = NextState(state, d, h);
+	return Evaluate(f, stage, t + c * h);
+}
+
+static float ErrorComponent(float error, float a, float b) {
+	float scale = Adaptive.atol + Adaptive.rtol * Max(Abs(a), Abs(b));
+	float ratio = error / scale;
+	return ratio * ratio;
+}
+
+static float ErrorNorm(const State &a, const State &b, const Derivative &error, float h) {
+	float sum = 0.0f;
+	for (int i = 0; i < MAX_STATE; ++i) {
+		sum += ErrorComponent(h * error.dx[i].x, a.x[i].x, b.x[i].x);
+		sum += ErrorComponent(h * error.dx[i].y, a.x[i].y, b.x[i].y);
+		sum += ErrorComponent(h * error.dv[i].x, a.v[i].x, b.v[i].x);
+		sum += ErrorComponent(h * error.dv[i].y, a.v[i].y, b.v[i].y);
+	}
+	return SquareRoot(sum / (float)(4 * MAX_STATE));
+}
+
+// Steps are taken over the local elapsed time of the frame, so the step still advances the clock when
+// t is large enough for t + min_dt to round back to t
+State IntegrateDormandPrince(const System &f, const State &state, float t, float dt) {
+	float h        = AdaptiveDt > 0.0f ? Min(AdaptiveDt, dt) : dt;
+	float proposal = h;
+	float elapsed  = 0.0f;
+
+	State y = state;
+
+	while (elapsed < dt) {
+		float remaining = dt - elapsed;
+		float step      = Min(h, remaining);
+		float now       = t + elapsed;
+
+		Derivative k1, k2, k3, k4, k5, k6, k7;
+
+		if (Fsal.valid && Fsal.t == elapsed && memcmp(&Fsal.state, &y, sizeof(State)) == 0)
+			k1 = Fsal.k;
+		else
+			k1 = Evaluate(f, y, now);
+
+		k2 = EvaluateStage(f, y, now, step, 1.0f / 5.0f, (1.0f / 5.0f) * k1);
+		k3 = EvaluateStage(f, y, now, step, 3.0f / 10.0f, (3.0f / 40.0f) * k1 + (9.0f / 40.0f) * k2);
+		k4 = EvaluateStage(f, y, now, step, 4.0f / 5.0f, (44.0f / 45.0f) * k1 - (56.0f / 15.0f) * k2 + (32.0f / 9.0f) * k3);
+		k5 = EvaluateStage(f, y, now, step, 8.0f / 9.0f, (19372.0f / 6561.0f) * k1 - (25360.0f / 2187.0f) * k2 + (64448.0f / 6561.0f) * k3 - (212.0f / 729.0f) * k4);
+		k6 = EvaluateStage(f, y, now, step, 1.0f, (9017.0f / 3168.0f) * k1 - (355.0f / 33.0f) * k2 + (46732.0f / 5247.0f) * k3 + (49.0f / 176.0f) * k4 - (5103.0f / 18656.0f) * k5);
+
+		Derivative d = (35.0f / 384.0f) * k1 + (500.0f / 1113.0f) * k3 + (125.0f / 192.0f) * k4 - (2187.0f / 6784.0f) * k5 + (11.0f / 84.0f) * k6;
+
+		State next = NextState(y, d, step);
+
+		k7 = Evaluate(f, next, now + step);
+
+		Derivative error = (71.0f / 57600.0f) * k1 - (71.0f / 16695.0f) * k3 + (71.0f / 1920.0f) * k4
+			- (17253.0f / 339200.0f) * k5 + (22.0f / 525.0f) * k6 - (1.0f / 40.0f) * k7;
+
+		float norm   = ErrorNorm(y, next, error, step);
+		float factor = norm > 0.0f ? Adaptive.safety * Pow(norm, -0.2f) : Adaptive.max_factor;
+		factor = Min(Max(factor, Adaptive.min_factor), Adaptive.max_factor);
+
+		if (norm <= 1.0f || step <= Adaptive.min_dt) {
+			y       = next;
+			elapsed = step == remaining ? dt : elapsed + step;
+
+			Fsal.state = y;
+			Fsal.t     = elapsed;
+			Fsal.k     = k7;
+			Fsal.valid = true;
+		} else {
+			Fsal.state = y;
+			Fsal.t     = elapsed;
+			Fsal.k     = k1;
+			Fsal.valid = true;
+
+			factor = Min(factor, 1.0f);
+		}
+
+		bool clipped = step < h;
+
+		h = Max(step * factor, Adaptive.min_dt);
+
+		// The step clipped to the end of the frame says little about the step size for the next frame
+		if (!clipped)
+			proposal = h;
+	}
+
+	// The next frame starts where this one ended
+	if (Fsal.valid && Fsal.t == dt)
+		Fsal.t = 0.0f;
+
+	AdaptiveDt = proposal;
+
+	return y;
+}
+
+//
+// Backward Euler: Solves M (v1 - v0) = h f(x0 + h v1, v1) for v1 with Newton iterations.
+// Each iteration solves (M - h df/dv - h^2 df/dx) dv = -g with the sparse CG solver.
+// Fixed bodies (imass = 0) get identity rows and their couplings are dropped.
+//
+
+struct Implicit_Settings {
+	uint32_t newton_iterations = 2;
+	float    newton_tolerance  = 1e-5f;
+	uint32_t cg_iterations     = 100;
+	float    cg_tolerance      = 1e-4f;
+};
+
+static Implicit_Settings Implicit;
+
+State IntegrateBackwardEuler(const State &state, float t, float h) {
+	constexpr uint32_t DOF = 2 * MAX_STATE;
+
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	M_Allocator allocator = M_GetArenaAllocator(arena);
+
+	Array<Force_Derivative> derivatives;
+	derivatives.allocator = allocator;
+
+	Array<Sparse_Entry> entries;
+	entries.allocator = allocator;
+
+	float rhs_data[DOF], dv_data[DOF];
+	Vector rhs = { DOF, rhs_data };
+	Vector dv  = { DOF, dv_data };
+
+	State next = state;
+
+	for (uint32_t iteration = 0; iteration < Implicit.newton_iterations; ++iteration) {
+		for (int i = 0; i < MAX_STATE; ++i) {
+			next.x[i] = state.x[i] + h * next.v[i];
+		}
+
+		ClearForces();
+		ComputeForces(next, t + h);
+
+		derivatives.count = 0;
+		for (Force_Generator *force : Forces) {
+			force->Differentiate(&derivatives, next);
+		}
+		if (Dragging) {
+			Dragging->Differentiate(&derivatives, next);
+		}
+
+		entries.count = 0;
+
+		float residual = 0.0f;
+
+		for (uint32_t i = 0; i < (uint32_t)MAX_STATE; ++i) {
+			uint32_t row = 2 * i;
+
+			if (bodies[i].imass == 0.0f) {
+				Append(&entries, Sparse_Entry{ row + 0, row + 0, 1.0f });
+				Append(&entries, Sparse_Entry{ row + 1, row + 1, 1.0f });
+				rhs[row + 0] = 0.0f;
+				rhs[row + 1] = 0.0f;
+				continue;
+			}
+
+			float mass = 1.0f / bodies[i].imass;
+			Vec2 f     = bodies[i].force + mass * bodies[i].acceleration;
+			Vec2 g     = mass * (next.v[i] - state.v[i]) - h * f;
+
+			Append(&entries, Sparse_Entry{ row + 0, row + 0, mass });
+			Append(&entries, Sparse_Entry{ row + 1, row + 1, mass });
+			rhs[row + 0] = -g.x;
+			rhs[row + 1] = -g.y;
+
+			residual += LengthSq(g);
+		}
+
+		if (residual <= Implicit.newton_tolerance * Implicit.newton_tolerance)
+			break;
+
+		for (const Force_Derivative &d : derivatives) {
+			if (bodies[d.i].imass == 0.0f || bodies[d.j].imass == 0.0f)
+				continue;
+
+			for (uint32_t r = 0; r < 2; ++r) {
+				for (uint32_t c = 0; c < 2; ++c) {
+					float value = -h * h * d.dx[r][c] - (r == c ? h * d.dv : 0.0f);
+					if (value != 0.0f)
+						Append(&entries, Sparse_Entry{ 2 * d.i + r, 2 * d.j + c, value });
+				}
+			}
+		}
+
+		Sparse_Matrix jacobian = BuildSparseMatrix(DOF, entries, allocator);
+		if (!jacobian.rows)
+			break;
+
+		memset(dv_data, 0, sizeof(dv_data));
+		SolveConjugateGradient(jacobian, rhs, &dv, Implicit.cg_iterations, Implicit.cg_tolerance);
+
+		for (int i = 0; i < MAX_STATE; ++i) {
+			next.v[i] += Vec2(dv[2 * i + 0], dv[2 * i + 1]);
+		}
+	}
+
+	for (int i = 0; i < MAX_STATE; ++i) {
+		next.x[i] = state.x[i] + h * next.v[i];
+	}
+
+	return next;
+}
+
+enum Integrator_Kind {
+	INTEGRATOR_EULER,
+	INTEGRATOR_MODIFIED_EULER,
+	INTEGRATOR_RK4,
+	INTEGRATOR_DORMAND_PRINCE,
+	INTEGRATOR_BACKWARD_EULER,
+};
+
+// Modified Euler as before by default, the other integrators are opt-in
+static Integrator_Kind Integrator = INTEGRATOR_MODIFIED_EULER;
+
 State Integrate(const System &f, const State &state, float t, float dt) {
-	return IntegrateModifiedEuler(f, state, t, dt);
+	switch (Integrator) {
+	case INTEGRATOR_EULER:          return IntegrateEuler(f, state, t, dt);
+	case INTEGRATOR_MODIFIED_EULER: return IntegrateModifiedEuler(f, state, t, dt);
+	case INTEGRATOR_RK4:            return IntegrateRK4(f, state, t, dt);
+	case INTEGRATOR_DORMAND_PRINCE: return IntegrateDormandPrince(f, state, t, dt);
+	case INTEGRATOR_BACKWARD_EULER: return IntegrateBackwardEuler(state, t, dt);
+	}
+	Unreachable();
+	return state;
 }
 
 State Step(const System &f, const State &state, float t, float dt) {
@@ -798,9 +1250,236 @@ State Step(const System &f, const State &state, float t, float dt) {
 	return next;
 }
 
+//
+// XPBD: Constraints are solved directly on the positions with a fixed number of substeps
+// and iterations, instead of impulses + bisection in "Step". Constraints are ropes, so
+// they only pull (inequality constraints, lambda is clamped to be non-positive).
+//
+
+enum Solver_Mode {
+	SOLVER_IMPULSE,
+	SOLVER_XPBD,
+};
+
+enum Xpbd_Iteration {
+	XPBD_GAUSS_SEIDEL,
+	XPBD_JACOBI,
+};
+
+struct Xpbd_Settings {
+	uint32_t       substeps   = 8;
+	uint32_t       iterations = 1;
+	Xpbd_Iteration iteration  = XPBD_GAUSS_SEIDEL;
+	float          relaxation = 1.0f; // Jacobi over-relaxation
+};
+
+// Impulses with the integrator above by default, XPBD is opt-in
+static Solver_Mode   SolverMode = SOLVER_IMPULSE;
+static Xpbd_Settings Xpbd;
+
+static Edge_Coloring ConstraintColoring;
+static bool          ConstraintColoringDirty = true;
+static Array<float>  ConstraintLambdas;
+static Array<Vec2>   ConstraintCorrections;
+
+// The coloring is rebuilt when the constraints change, every change must go through AddConstraint
+void AddConstraint(const Constraint &constraint) {
+	Append(&Constraints, constraint);
+	ConstraintColoringDirty = true;
+}
+
+struct Xpbd_Batch {
+	State *         state;
+	float           inv_h2;
+	const uint32_t *constraints;
+};
+
+static float SolveDistanceConstraint(const State &state, uint32_t index, float inv_h2, Vec2 *correction) {
+	const Constraint &constraint = Constraints[index];
+
+	float wi = bodies[constraint.i].imass;
+	float wj = bodies[constraint.j].imass;
+
+	Vec2 delta = state.x[constraint.i] - state.x[constraint.j];
+	float dist = Length(delta);
+
+	float lambda = ConstraintLambdas[index];
+	float c      = dist - constraint.distance;
+
+	if ((c <= 0.0f && lambda == 0.0f) || dist == 0.0f || wi + wj == 0.0f) {
+		*correction = Vec2(0);
+		return 0.0f;
+	}
+
+	float alpha = constraint.compliance * inv_h2;
+
+	float delta_lambda = (-c - alpha * lambda) / (wi + wj + alpha);
+	float next_lambda  = Min(lambda + delta_lambda, 0.0f);
+	delta_lambda       = next_lambda - lambda;
+
+	ConstraintLambdas[index] = next_lambda;
+
+	*correction = delta_lambda * (delta / dist);
+
+	return delta_lambda;
+}
+
+static void SolveConstraintBatch(void *data, uint32_t first, uint32_t last, uint32_t thread) {
+	Xpbd_Batch *batch = (Xpbd_Batch *)data;
+	State *state      = batch->state;
+
+	for (uint32_t index = first; index < last; ++index) {
+		uint32_t c = batch->constraints[index];
+
+		Vec2 correction;
+		SolveDistanceConstraint(*state, c, batch->inv_h2, &correction);
+
+		const Constraint &constraint = Constraints[c];
+		state->x[constraint.i] += bodies[constraint.i].imass * correction;
+		state->x[constraint.j] -= bodies[constraint.j].imass * correction;
+	}
+}
+
+static void SolveConstraintJacobi(void *data, uint32_t first, uint32_t last, uint32_t thread) {
+	Xpbd_Batch *batch = (Xpbd_Batch *)data;
+
+	for (uint32_t index = first; index < last; ++index) {
+		SolveDistanceConstraint(*batch->state, index, batch->inv_h2, &ConstraintCorrections[index]);
+	}
+}
+
+void SolveConstraintsXpbd(State *state, float h) {
+	Xpbd_Batch batch = { state, 1.0f / (h * h), nullptr };
+
+	if (Xpbd.iteration == XPBD_GAUSS_SEIDEL) {
+		uint32_t color_count = (uint32_t)ConstraintColoring.batches.count - 1;
+
+		for (uint32_t color = 0; color < color_count; ++color) {
+			uint32_t first = ConstraintColoring.batches[color];
+			uint32_t count = ConstraintColoring.batches[color + 1] - first;
+
+			batch.constraints = ConstraintColoring.order.data + first;
+			J_ParallelFor(count, J_SplitGrain(count, FORCE_MIN_GRAIN), SolveConstraintBatch, &batch);
+		}
+
+		// Constraints on dense bodies are solved serially
+		batch.constraints = ConstraintColoring.reduction.data;
+		SolveConstraintBatch(&batch, 0, (uint32_t)ConstraintColoring.reduction.count, 0);
+	} else {
+		uint32_t count = (uint32_t)Constraints.count;
+		J_ParallelFor(count, J_SplitGrain(count, FORCE_MIN_GRAIN), SolveConstraintJacobi, &batch);
+
+		Vec2 sum[MAX_STATE]     = {};
+		uint32_t used[MAX_STATE] = {};
+
+		for (uint32_t index = 0; index < count; ++index) {
+			Vec2 correction = ConstraintCorrections[index];
+			if (correction.x == 0.0f && correction.y == 0.0f) continue;
+
+			const Constraint &constraint = Constraints[index];
+			sum[constraint.i] += bodies[constraint.i].imass * correction;
+			sum[constraint.j] -= bodies[constraint.j].imass * correction;
+			used[constraint.i] += 1;
+			used[constraint.j] += 1;
+		}
+
+		for (int i = 0; i < MAX_STATE; ++i) {
+			if (used[i])
+				state->x[i] += (Xpbd.relaxation / (float)used[i]) * sum[i];
+		}
+	}
+}
+
+// Contacts have zero compliance, so each pair is simply projected apart
+void SolveParticleCollisionsXpbd(State *state, Array_View<Spatial_Pair> pairs) {
+	for (const Spatial_Pair &pair : pairs) {
+		float wa = bodies[pair.a].imass;
+		float wb = bodies[pair.b].imass;
+		if (wa + wb == 0.0f) continue;
+
+		Vec2 delta = state->x[pair.a] - state->x[pair.b];
+		float dist = Length(delta);
+		float c    = dist - 2.0f * PARTICLE_RADIUS;
+
+		if (c >= 0.0f || dist == 0.0f) continue;
+
+		Vec2 correction = (-c / (wa + wb)) * (delta / dist);
+		state->x[pair.a] += wa * correction;
+		state->x[pair.b] -= wb * correction;
+	}
+}
+
+State StepXpbd(const State &state, float t, float dt) {
+	uint32_t constraint_count = (uint32_t)Constraints.count;
+
+	if (ConstraintColoringDirty) {
+		M_Arena *arena   = ThreadScratchpad();
+		M_Temporary temp = M_BeginTemporaryMemory(arena);
+		Defer{ M_EndTemporaryMemory(&temp); };
+
+		Edge *edges = M_PushArray(arena, Edge, constraint_count);
+
+		for (uint32_t index = 0; index < constraint_count; ++index) {
+			edges[index] = Edge{ Constraints[index].i, Constraints[index].j };
+		}
+
+		ColorEdges(&ConstraintColoring, edges, constraint_count, MAX_STATE);
+
+		Resize(&ConstraintLambdas, constraint_count);
+		Resize(&ConstraintCorrections, constraint_count);
+
+		ConstraintColoringDirty = false;
+	}
+
+	uint32_t substeps = Max(Xpbd.substeps, 1u);
+	float h = dt / (float)substeps;
+
+	State next = state;
+	Vec2 previous[MAX_STATE];
+
+	for (uint32_t substep = 0; substep < substeps; ++substep) {
+		ClearForces();
+		ComputeForces(next, t);
+
+		for (int i = 0; i < MAX_STATE; ++i) {
+			previous[i] = next.x[i];
+			next.v[i]  += h * (bodies[i].force * bodies[i].imass + bodies[i].acceleration);
+			next.x[i]  += h * next.v[i];
+		}
+
+		memset(ConstraintLambdas.data, 0, ArrSizeInBytes(ConstraintLambdas));
+
+		Array<Spatial_Pair> pairs;
+		pairs.allocator = M_GetArenaAllocator(ThreadScratchpad());
+		QueryParticlePairs(next, &pairs);
+
+		for (uint32_t iteration = 0; iteration < Xpbd.iterations; ++iteration) {
+			SolveConstraintsXpbd(&next, h);
+			SolveParticleCollisionsXpbd(&next, pairs);
+		}
+
+		float inv_h = 1.0f / h;
+		for (int i = 0; i < MAX_STATE; ++i) {
+			next.v[i] = (next.x[i] - previous[i]) * inv_h;
+		}
+
+		t += h;
+	}
+
+	return next;
+}
+
 int Main(int argc, char **argv) {
 	PL_ThreadCharacteristics(PL_THREAD_GAMES);
 
+	J_InitWorkers();
+
+	if (argc > 1 && String(argv[1]) == "--benchmark") {
+		int result = RunBenchmarks(argc - 2, argv + 2);
+		J_ShutdownWorkers();
+		return result;
+	}
+
 	PL_Window *window = PL_CreateWindow("Magus", 0, 0, false);
 	if (!window)
 		FatalError("Failed to create windows");
@@ -859,7 +1538,7 @@ int Main(int argc, char **argv) {
 		y_pos -= y_sep_dist;
 
 		if (i + 5 < MAX_STATE)
-			Append(&Forces, new Rope_Force_Generator(i, i + 5, x_sep_dist));
+			AddForce(new Rope_Force_Generator(i, i + 5, x_sep_dist));
 
 		i += 1;
 		for (int y = 1; y < 5; ++y, ++i) {
@@ -869,10 +1548,10 @@ int Main(int argc, char **argv) {
 
 			y_pos -= y_sep_dist;
 
-			Append(&Forces, new Rope_Force_Generator(i - 1, i, y_sep_dist));
+			AddForce(new Rope_Force_Generator(i - 1, i, y_sep_dist));
 
 			if (i + 5 < MAX_STATE)
-				Append(&Forces, new Rope_Force_Generator(i, i + 5, x_sep_dist));
+				AddForce(new Rope_Force_Generator(i, i + 5, x_sep_dist));
 		}
 
 		x_pos += x_sep_dist;
@@ -892,7 +1571,7 @@ int Main(int argc, char **argv) {
 		y_pos -= y_sep_dist;
 
 		if (i + 5 < MAX_STATE) {
-			Append(&Constraints, Constraint{ x_sep_dist, i, i + 5 });
+			AddConstraint(Constraint{ x_sep_dist, i, i + 5 });
 		}
 
 		i += 1;
@@ -903,10 +1582,10 @@ int Main(int argc, char **argv) {
 
 			y_pos -= y_sep_dist;
 
-			Append(&Constraints, Constraint{ y_sep_dist, i - 1, i });
+			AddConstraint(Constraint{ y_sep_dist, i - 1, i });
 
 			if (i + 5 < MAX_STATE)
-				Append(&Constraints, Constraint{ x_sep_dist, i, i + 5 });
+				AddConstraint(Constraint{ x_sep_dist, i, i + 5 });
 		}
 
 		x_pos += x_sep_dist;
@@ -934,11 +1613,15 @@ int Main(int argc, char **argv) {
 		x_pos += x_sep_dist;
 	}
 
-	Append(&Constraints, Constraint{ 2.0f, 0, 1 });
+	AddConstraint(Constraint{ 2.0f, 0, 1 });
 #endif
 
 	Rigid_Body_System system;
 
+	// Picks bodies with the cursor, rebuilt whenever the state is stepped
+	Spatial_Hash pick_hash;
+	BuildBodyHash(&pick_hash, state);
+
 
 	float frame_time_ms = 0.0f;
 
@@ -963,11 +1646,12 @@ int Main(int argc, char **argv) {
 			if (e.kind == PL_EVENT_BUTTON_PRESSED) {
 				if (e.button.id == PL_BUTTON_LEFT) {
 					float dist;
-					uint i = FindNearestBody(state, cursor, &dist);
+					uint i = FindNearestBody(pick_hash, state, cursor, 2.0f, &dist);
 					
 					if (dist < 2.0f) {
 						dragging.i  = i;
 						Dragging = &dragging;
+						InvalidateIntegratorCache();
 					}
 				}
 			}
@@ -975,6 +1659,7 @@ int Main(int argc, char **argv) {
 			if (e.kind == PL_EVENT_BUTTON_RELEASED) {
 				if (e.button.id == PL_BUTTON_LEFT) {
 					Dragging = nullptr;
+					InvalidateIntegratorCache();
 				}
 			}
 
@@ -986,12 +1671,25 @@ int Main(int argc, char **argv) {
 
 		dragging.pos = cursor;
 
+		// Cached evaluations depend on the cursor when dragging
+		if (Dragging)
+			InvalidateIntegratorCache();
+
+		bool stepped = false;
+
 		while (accumulator >= dt) {
-			state = Step(system, state, t, dt);
+			if (SolverMode == SOLVER_XPBD)
+				state = StepXpbd(state, t, dt);
+			else
+				state = Step(system, state, t, dt);
 			t += dt;
 			accumulator -= dt;
+			stepped = true;
 		}
 
+		if (stepped)
+			BuildBodyHash(&pick_hash, state);
+
 		R_GetRenderTargetSize(swap_chain, &width, &height);
 
 		aspect_ratio  = width / height;
@@ -1005,8 +1703,7 @@ int Main(int argc, char **argv) {
 
 		R_DrawCircle(renderer, cursor, 0.1f, Vec4(1));
 
-		for (int i = 0; i < MAX_STATE; ++i)
-			R_DrawCircle(renderer, state.x[i], 0.1f, Vec4(1));
+		R_DrawCircles(renderer, state.x, 0.1f, Vec4(1), MAX_STATE);
 
 		for (const auto &force: Forces) {
 			Vec2 a = state.x[force->indices[0]];
@@ -1079,5 +1776,7 @@ int Main(int argc, char **argv) {
 	R_DestroyRenderQueue(queue);
 	R_DestroyDevice(device);
 
+	J_ShutdownWorkers();
+
 	return 0;
 }
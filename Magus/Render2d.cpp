@@ -1,15 +1,20 @@
 #include "Render2d.h"
 #include "RobotoMedium.h"
+#include "KrTriangulate.h"
+
+#include "ResourceLoaders/Loaders.h"
+#include "ResourceLoaders/RectPack.h"
 
 #include "Kr/KrMemory.h"
 #include "Kr/KrLog.h"
 
-#include <malloc.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define R_TEXT_SSE2
+#include <emmintrin.h>
+#endif
 
 struct R_Memory_Mark {
 	ptrdiff_t command;
-	ptrdiff_t vertex;
-	ptrdiff_t index;
 	ptrdiff_t path;
 };
 
@@ -19,22 +24,281 @@ struct R_Command2d {
 	Mat4        transform;
 	R_Rect      rect;
 	R_Texture * texture;
+	R_Geometry *geometry; // offsets are into the geometry of a mesh when set
 	uint32_t    vertex_offset;
 	uint32_t    index_offset;
 	uint32_t    index_count;
+	uint32_t    instance_offset;
+	uint32_t    instance_count;
+	bool        shapes; // instances are R_Shape2d instead of R_Sprite2d
+	uint16_t    layer;
+};
+
+struct R_Mesh_Command2d {
+	R_Pipeline *pipeline;
+	R_Texture * texture;
+	bool        atlas; // the atlas texture is looked up when drawn, it is recreated when the atlas changes
+	Mat4        transform;
+	uint32_t    vertex_offset;
+	uint32_t    index_offset;
+	uint32_t    index_count;
+};
+
+struct R_Mesh2d {
+	R_Geometry *       geometry;
+	R_Mesh_Command2d * commands;
+	uint32_t           command_count;
+	size_t             allocated;
+};
+
+struct R_Record_Mark2d {
+	ptrdiff_t command;
+	ptrdiff_t vertex;
+	ptrdiff_t index;
+	ptrdiff_t sprite;
 };
 
 typedef void (*R_Font_Config_Free)(R_Font_Config *config, M_Allocator allocator);
 
+struct R_Atlas_Entry2d {
+	R_Rect uv;
+};
+
+struct R_Atlas2d {
+	uint32_t          width          = 0;
+	uint32_t          height         = 0;
+	uint8_t *         pixels         = nullptr;
+	stbrp_context     packer         = {};
+	stbrp_node *      nodes          = nullptr;
+	R_Atlas_Entry2d * entries        = nullptr;
+	uint32_t          entry_count    = 0;
+	uint32_t          entry_capacity = 0;
+	R_Texture *       texture        = nullptr;
+	bool              dirty          = false;
+};
+
 template <typename T>
 using R_Array = Array<T, void>;
 
+// Glyph quads of a string laid out relative to the pen position, with white color
+struct R_Text_Run2d {
+	R_Font *  font;
+	uint32_t  generation;   // of the font, the address alone may be reused by a font loaded after it is destroyed
+	float     factor;
+	uint64_t  hash;
+	uint32_t  text_offset;  // bytes of the string in R_Text_Cache2d::text
+	uint32_t  text_count;
+	uint32_t  first_vertex; // quads in R_Text_Cache2d::vertices
+	uint32_t  vertex_count;
+	Vec2      uv_offset;    // atlas mapping the tex coords were written with
+	Vec2      uv_scale;
+	R_Rect    bounds;
+	uint32_t  used_frame;
+};
+
+// Text drawn in recent frames, so that unchanged strings are not decoded and looked up glyph by glyph again
+// Runs that are not drawn for R_TEXT_RUN_FRAMES frames are evicted at the start of a frame
+struct R_Text_Cache2d {
+	R_Array<R_Text_Run2d> runs;
+	R_Array<uint32_t>     slots;    // open addressing by hash, run index + 1 and 0 for empty slots
+	R_Array<R_Vertex2d>   vertices;
+	R_Array<uint8_t>      text;
+	uint32_t              frame = 0;
+};
+
+// Address space for the budget is reserved up front and committed block by block as frames grow,
+// so the stream never moves and steady frames never allocate
+// Frames that exceed the budget continue in a heap allocated overflow chunk instead of dropping draws,
+// and the budget grows to fit them at the start of the next frame
+static constexpr size_t R_STREAM_COMMIT_BLOCK = 64 * 1024;
+
+template <typename T>
+struct R_Stream2d {
+	M_Arena *  arena          = nullptr;
+	T *        data           = nullptr;
+	ptrdiff_t  count          = 0;
+	ptrdiff_t  budget         = 0;
+	size_t     committed      = 0;
+
+	R_Array<T> overflow;
+	ptrdiff_t  overflow_count = 0; // elements recorded past the budget in this frame
+	bool       flattened      = false;
+
+	ptrdiff_t  mark           = 0;
+	ptrdiff_t  overflow_mark  = 0;
+};
+
+template <typename T>
+static bool R_StreamReserve(R_Stream2d<T> *stream, ptrdiff_t budget) {
+	// Some of the reservation may hold the arena's own header
+	size_t reserve = AlignPower2Up((size_t)budget * sizeof(T), R_STREAM_COMMIT_BLOCK) + R_STREAM_COMMIT_BLOCK;
+
+	M_Arena *arena = M_ArenaAllocate(reserve);
+	if (!arena) return false;
+
+	if (stream->arena)
+		M_ArenaFree(stream->arena);
+
+	stream->arena     = arena;
+	stream->data      = nullptr;
+	stream->budget    = budget;
+	stream->committed = 0;
+
+	return true;
+}
+
+template <typename T>
+static void R_StreamFree(R_Stream2d<T> *stream, M_Allocator allocator) {
+	if (stream->arena)
+		M_ArenaFree(stream->arena);
+	Free(&stream->overflow, allocator);
+	*stream = R_Stream2d<T>();
+}
+
+template <typename T>
+static T *R_StreamPush(R_Stream2d<T> *stream, M_Allocator allocator, ptrdiff_t count) {
+	ptrdiff_t offset = stream->count;
+
+	// Once the budget has overflowed, everything else in the frame goes to the overflow to keep the order
+	if (!stream->overflow_count && offset + count <= stream->budget) {
+		size_t required = (size_t)(offset + count) * sizeof(T);
+		while (stream->committed < required) {
+			uint8_t *block = (uint8_t *)M_PushSize(stream->arena, R_STREAM_COMMIT_BLOCK);
+			if (!block) break;
+			if (!stream->data)
+				stream->data = (T *)block;
+			Assert(block == (uint8_t *)stream->data + stream->committed);
+			stream->committed += R_STREAM_COMMIT_BLOCK;
+		}
+
+		if (stream->committed >= required) {
+			stream->count += count;
+			return stream->data + offset;
+		}
+	}
+
+	ptrdiff_t overflow_offset = stream->overflow.count;
+	if (!Resize(&stream->overflow, allocator, overflow_offset + count))
+		return nullptr;
+
+	stream->count          += count;
+	stream->overflow_count += count;
+
+	return &stream->overflow[overflow_offset];
+}
+
+// Gives back the unused tail of the last push
+template <typename T>
+static void R_StreamPop(R_Stream2d<T> *stream, ptrdiff_t count) {
+	stream->count -= count;
+	if (stream->overflow_count) {
+		stream->overflow_count -= count;
+		stream->overflow.count -= count;
+	}
+}
+
+// All the elements in one block, the overflow is moved behind the budget's elements in frames that overflowed
+template <typename T>
+static T *R_StreamData(R_Stream2d<T> *stream, M_Allocator allocator) {
+	if (!stream->overflow_count || stream->flattened)
+		return stream->overflow_count ? stream->overflow.data : stream->data;
+
+	ptrdiff_t in_budget = stream->count - stream->overflow_count;
+	if (!Resize(&stream->overflow, allocator, stream->count))
+		return nullptr;
+
+	memmove(stream->overflow.data + in_budget, stream->overflow.data, sizeof(T) * stream->overflow_count);
+	if (in_budget)
+		memcpy(stream->overflow.data, stream->data, sizeof(T) * in_budget);
+
+	stream->flattened = true;
+
+	return stream->overflow.data;
+}
+
+template <typename T>
+static void R_StreamReset(R_Stream2d<T> *stream, M_Allocator allocator, const char *name) {
+	stream->mark = Max(stream->mark, stream->count);
+
+	if (stream->overflow_count) {
+		stream->overflow_mark = Max(stream->overflow_mark, stream->overflow_count);
+
+		// Nothing is recorded at this point, so the stream can move
+		ptrdiff_t budget = Max(stream->budget, (ptrdiff_t)1);
+		while (budget < stream->count)
+			budget *= 2;
+
+		if (R_StreamReserve(stream, budget)) {
+			LogWarning("Renderer2d: % budget exceeded by % elements. Budget is grown to % elements.", name, stream->overflow_count, budget);
+			Free(&stream->overflow, allocator);
+		}
+	}
+
+	stream->count          = 0;
+	stream->overflow_count = 0;
+	stream->flattened      = false;
+	Reset(&stream->overflow);
+}
+
+// Drops everything recorded after the first count elements
+template <typename T>
+static void R_StreamTruncate(R_Stream2d<T> *stream, ptrdiff_t count) {
+	Assert(!stream->flattened && count <= stream->count);
+
+	ptrdiff_t in_budget = stream->count - stream->overflow_count;
+
+	stream->overflow_count = Max(count - in_budget, (ptrdiff_t)0);
+	stream->overflow.count = stream->overflow_count;
+	stream->count          = count;
+}
+
+// Elements [first, first + count) in one block, copied into split when they are split by the overflow
+template <typename T>
+static const T *R_StreamRange(R_Stream2d<T> *stream, M_Allocator allocator, R_Array<T> *split, ptrdiff_t first, ptrdiff_t count) {
+	ptrdiff_t in_budget = stream->count - stream->overflow_count;
+
+	if (stream->flattened)
+		return stream->overflow.data + first;
+	if (first + count <= in_budget)
+		return stream->data + first;
+	if (first >= in_budget)
+		return stream->overflow.data + (first - in_budget);
+
+	if (!Resize(split, allocator, count))
+		return nullptr;
+
+	T *dst = split->data;
+	memcpy(dst, stream->data + first, sizeof(T) * (in_budget - first));
+	memcpy(dst + (in_budget - first), stream->overflow.data, sizeof(T) * (first + count - in_budget));
+
+	return dst;
+}
+
+template <typename T>
+static bool R_StreamAppend(R_Stream2d<T> *stream, M_Allocator allocator, const T *src, ptrdiff_t count) {
+	if (!count) return true;
+	if (!src) return false;
+	T *dst = R_StreamPush(stream, allocator, count);
+	if (!dst) return false;
+	memcpy(dst, src, sizeof(T) * count);
+	return true;
+}
+
+template <typename T>
+static size_t R_StreamAllocated(const R_Stream2d<T> &stream) {
+	return stream.committed + stream.overflow.allocated * sizeof(T);
+}
+
+static constexpr R_Index2d R_INVALID_INDEX2D          = (R_Index2d)-1;
+static constexpr uint64_t  R_MAX_VERTICES_PER_COMMAND = R_INVALID_INDEX2D;
+
 struct R_Renderer2d {
 	M_Allocator            allocator = ThreadContext.allocator;
 
 	R_Array<R_Command2d>   command;
-	R_Array<R_Vertex2d>    vertex;
-	R_Array<R_Index2d>     index;
+	R_Stream2d<R_Vertex2d> vertex;
+	R_Stream2d<R_Index2d>  index;
+	R_Stream2d<R_Sprite2d> sprite;
 	R_Array<Mat4>          transform;
 
 	R_Command2d *          write_command        = nullptr;
@@ -43,16 +307,43 @@ struct R_Renderer2d {
 
 	R_Index2d              next_index           = 0;
 
+	bool                   recording            = false;
+	R_Record_Mark2d        record               = {};
+
+	R_Sort_Mode2d          sort_mode            = R_SORT_MODE_NONE;
+	uint16_t               layer                = 0;
+	R_Array<R_Command2d>   sorted_command;
+	R_Array<R_Index2d>     sorted_index;
+	R_Array<R_Sprite2d>    sorted_sprite;
+
 	R_Array<R_Pipeline *>  pipeline;
 	R_Array<R_Texture *>   texture;
 	R_Array<R_Rect>        rect;
 	R_Array<Vec2>          path;
+	Polygon_Triangulator   triangulator;
+	R_Text_Cache2d         text_cache;
 
 	R_Camera2d             camera;
 	float                  thickness                = 0.0f;
+	float                  tolerance                = 0.0f;
+	R_Line_Join2d          join                     = R_LINE_JOIN_MITER;
+	R_Line_Cap2d           cap                      = R_LINE_CAP_BUTT;
+	float                  miter_limit              = 4.0f;
+
+	// Visible part of the camera in camera units, see R_SetCulling
+	bool                   cull                     = false;
+	Vec2                   cull_min                 = Vec2(0.0f);
+	Vec2                   cull_max                 = Vec2(0.0f);
+
+	R_Atlas2d              atlas;
+	Vec2                   uv_offset                = Vec2(0.0f);
+	Vec2                   uv_scale                 = Vec2(1.0f);
 
 	R_Backend2d *          backend                  = nullptr;
 
+	// Set for recording contexts, the parent owns the backend resources and the atlas
+	R_Renderer2d *         parent                   = nullptr;
+
 	R_Texture *            white_texture            = nullptr;
 	R_Font *               default_font             = nullptr;
 
@@ -60,9 +351,8 @@ struct R_Renderer2d {
 	R_Font_Config *        default_font_config      = nullptr;
 	R_Font_Config_Free     default_font_config_free = nullptr;
 
-#if defined(KR_RENDER2D_ENABLE_DEBUG_INFO)
 	R_Memory_Mark          mark                     = {};
-#endif
+	uint32_t               overflow_frames          = 0;
 };
 
 //
@@ -85,26 +375,284 @@ static const R_Backend2d          FallbackBackend = {
 	[](R_Backend2d *, R_Texture *texture) {},
 	[](R_Backend2d *, const R_Font_Config &config, float height_in_pixels) -> R_Font *{ return nullptr; },
 	[](R_Backend2d *, R_Font *font) {},
+	[](R_Backend2d *, const R_Vertex2d *vertices, uint32_t vertex_count, const R_Index2d *indices, uint32_t index_count) -> R_Geometry *{ return nullptr; },
+	[](R_Backend2d *, R_Geometry *geometry) {},
+	[](R_Backend2d *, void *context, void *ptr, uint32_t size) -> bool { return false; },
 	[](R_Backend2d *, void *context, void *ptr, uint32_t size) -> bool { return false; },
 	[](R_Backend2d *, void *context, void *ptr, uint32_t size) -> bool { return false; },
 	[](R_Backend2d *, void *context, const R_Backend2d_Draw_Data &draw_data) {},
 	[](R_Backend2d *, void *context, R_Pipeline *pipeline) {},
 	[](R_Backend2d *, void *context, R_Rect rect) {},
 	[](R_Backend2d *, void *context, R_Texture *texture) {},
+	[](R_Backend2d *, void *context, R_Geometry *geometry) {},
 	[](R_Backend2d *, void *context, uint32_t index_count, uint32_t index_offset, int32_t vertex_offset) {},
+	[](R_Backend2d *, void *context, uint32_t instance_count, uint32_t instance_offset) {},
+	[](R_Backend2d *, void *context, uint32_t instance_count, uint32_t instance_offset) {},
 	[](R_Backend2d *) {}
 };
 
+//
+//
+//
+
+static inline R_Atlas2d *R_SharedAtlas(R_Renderer2d *r2) {
+	return r2->parent ? &r2->parent->atlas : &r2->atlas;
+}
+
+static bool R_IsAtlasTexture(R_Renderer2d *r2, R_Texture *texture) {
+	R_Atlas2d *atlas       = R_SharedAtlas(r2);
+	R_Atlas_Entry2d *entry = (R_Atlas_Entry2d *)texture;
+	return entry >= atlas->entries && entry < atlas->entries + atlas->entry_count;
+}
+
+static R_Texture *R_BackendTexture(R_Renderer2d *r2, R_Texture *texture) {
+	return R_IsAtlasTexture(r2, texture) ? R_SharedAtlas(r2)->texture : texture;
+}
+
+static void R_UpdateTextureTransform(R_Renderer2d *r2, R_Texture *texture) {
+	if (R_IsAtlasTexture(r2, texture)) {
+		R_Atlas_Entry2d *entry = (R_Atlas_Entry2d *)texture;
+		r2->uv_offset = entry->uv.min;
+		r2->uv_scale  = entry->uv.max - entry->uv.min;
+	} else {
+		r2->uv_offset = Vec2(0.0f);
+		r2->uv_scale  = Vec2(1.0f);
+	}
+}
+
+static inline Vec2 R_MapTexCoord(R_Renderer2d *r2, Vec2 uv) {
+	return r2->uv_offset + uv * r2->uv_scale;
+}
+
+static void R_ResetAtlas(R_Atlas2d *atlas) {
+	stbrp_init_target(&atlas->packer, (int)atlas->width, (int)atlas->height, atlas->nodes, (int)atlas->width);
+	memset(atlas->pixels, 0, (size_t)atlas->width * atlas->height * 4);
+	atlas->entry_count = 0;
+	atlas->dirty       = true;
+}
+
+static void R_FreeAtlas(R_Atlas2d *atlas, M_Allocator allocator) {
+	if (atlas->pixels)
+		M_Free(atlas->pixels, (size_t)atlas->width * atlas->height * 4, allocator);
+	if (atlas->nodes)
+		M_Free(atlas->nodes, sizeof(stbrp_node) * atlas->width, allocator);
+	if (atlas->entries)
+		M_Free(atlas->entries, sizeof(R_Atlas_Entry2d) * atlas->entry_capacity, allocator);
+	*atlas = R_Atlas2d();
+}
+
+static bool R_InitAtlas(R_Atlas2d *atlas, const R_Atlas_Specification2d &spec, M_Allocator allocator) {
+	if (!spec.width || !spec.height || !spec.textures)
+		return false;
+
+	atlas->width          = spec.width;
+	atlas->height         = spec.height;
+	atlas->entry_capacity = spec.textures;
+	atlas->pixels         = (uint8_t *)M_Alloc((size_t)spec.width * spec.height * 4, allocator);
+	atlas->nodes          = (stbrp_node *)M_Alloc(sizeof(stbrp_node) * spec.width, allocator);
+	atlas->entries        = (R_Atlas_Entry2d *)M_Alloc(sizeof(R_Atlas_Entry2d) * spec.textures, allocator);
+
+	if (!atlas->pixels || !atlas->nodes || !atlas->entries) {
+		LogWarning("Renderer2d: Failed to allocate memory for texture atlas. Atlas is disabled.");
+		R_FreeAtlas(atlas, allocator);
+		return false;
+	}
+
+	R_ResetAtlas(atlas);
+
+	return true;
+}
+
+static R_Atlas_Entry2d *R_AtlasInsert(R_Atlas2d *atlas, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels) {
+	if (!atlas->pixels || atlas->entry_count == atlas->entry_capacity || (n != 1 && n != 2 && n != 4) || !w || !h)
+		return nullptr;
+
+	stbrp_rect rect = {};
+	rect.w = (stbrp_coord)(w + 2);
+	rect.h = (stbrp_coord)(h + 2);
+
+	if (w + 2 > atlas->width || h + 2 > atlas->height || !stbrp_pack_rects(&atlas->packer, &rect, 1))
+		return nullptr;
+
+	// One texel border replicating the edges, so that filtering never reads the neighbouring textures
+	// Channels are expanded the way they are sampled from R8 and RG8 textures
+	for (int32_t y = -1; y <= (int32_t)h; ++y) {
+		int32_t src_y = Clamp(0, (int32_t)h - 1, y);
+		uint8_t *dst  = atlas->pixels + ((size_t)(rect.y + 1 + y) * atlas->width + rect.x) * 4;
+
+		for (int32_t x = -1; x <= (int32_t)w; ++x, dst += 4) {
+			int32_t src_x      = Clamp(0, (int32_t)w - 1, x);
+			const uint8_t *src = pixels + ((size_t)src_y * w + src_x) * n;
+
+			dst[0] = src[0];
+			dst[1] = n >= 2 ? src[1] : 0;
+			dst[2] = n == 4 ? src[2] : 0;
+			dst[3] = n == 4 ? src[3] : 0xff;
+		}
+	}
+
+	R_Atlas_Entry2d *entry = &atlas->entries[atlas->entry_count++];
+	entry->uv.min = Vec2((float)(rect.x + 1) / (float)atlas->width, (float)(rect.y + 1) / (float)atlas->height);
+	entry->uv.max = Vec2((float)(rect.x + 1 + w) / (float)atlas->width, (float)(rect.y + 1 + h) / (float)atlas->height);
+
+	atlas->dirty = true;
+
+	return entry;
+}
+
+static void R_UploadAtlas(R_Renderer2d *r2) {
+	R_Atlas2d *atlas = &r2->atlas;
+
+	if (atlas->texture)
+		r2->backend->DestroyTexture(r2->backend, atlas->texture);
+
+	atlas->texture = r2->backend->CreateTexture(r2->backend, atlas->width, atlas->height, 4, atlas->pixels);
+	atlas->dirty   = false;
+
+	if (!atlas->texture)
+		LogWarning("Renderer2d: Failed to create texture atlas.");
+}
+
+static R_Texture *R_AtlasCreateFontTexture(void *context, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels) {
+	R_Renderer2d *r2 = (R_Renderer2d *)context;
+	return (R_Texture *)R_AtlasInsert(R_SharedAtlas(r2), w, h, n, pixels);
+}
+
+// Packed rects are never freed one by one, the space of released textures is reclaimed when the atlas is reset
+static void R_AtlasReleaseTexture(R_Texture *texture) {}
+
+static inline bool R_CommandHasDraws(const R_Command2d *command) {
+	return command->index_count || command->instance_count;
+}
+
+static Vec2 R_CameraUnitsPerPixel(R_Renderer2d *r2) {
+	const R_Camera2d &camera = r2->camera;
+	const R_Rect &region     = r2->rect[0];
+
+	float units_x = Abs(camera.right - camera.left) / Max(region.max.x - region.min.x, 1.0f);
+	float units_y = Abs(camera.top - camera.bottom) / Max(region.max.y - region.min.y, 1.0f);
+
+	return Vec2(units_x, units_y);
+}
+
+static Vec2 R_TransformScale(R_Renderer2d *r2) {
+	const Mat4 &transform = Last(r2->transform);
+	float scale_x = Length(Vec2(transform.rows[0].x, transform.rows[1].x));
+	float scale_y = Length(Vec2(transform.rows[0].y, transform.rows[1].y));
+	return Vec2(scale_x, scale_y);
+}
+
+// Largest number of pixels a local unit covers on screen, the tessellation error is measured with it
+static float R_PixelsPerUnit(R_Renderer2d *r2) {
+	Vec2 units = R_CameraUnitsPerPixel(r2);
+	Vec2 scale = R_TransformScale(r2);
+
+	float min_units = Min(units.x, units.y);
+	return min_units > 0.0f ? Max(scale.x, scale.y) / min_units : 0.0f;
+}
+
+// The camera fills the frame region, the current rect is the scissor in pixels of that region
+static void R_UpdateCullBounds(R_Renderer2d *r2) {
+	const R_Camera2d &camera  = r2->camera;
+	const R_Rect &    region  = r2->rect[0];
+	const R_Rect &    scissor = Last(r2->rect);
+
+	float units_x = (camera.right - camera.left) / Max(region.max.x - region.min.x, 1.0f);
+	float units_y = (camera.top - camera.bottom) / Max(region.max.y - region.min.y, 1.0f);
+
+	float x0 = camera.left + (scissor.min.x - region.min.x) * units_x;
+	float x1 = camera.left + (scissor.max.x - region.min.x) * units_x;
+	float y0 = camera.bottom + (scissor.min.y - region.min.y) * units_y;
+	float y1 = camera.bottom + (scissor.max.y - region.min.y) * units_y;
+
+	r2->cull_min.x = Max(Min(x0, x1), Min(camera.left, camera.right));
+	r2->cull_min.y = Max(Min(y0, y1), Min(camera.bottom, camera.top));
+	r2->cull_max.x = Min(Max(x0, x1), Max(camera.left, camera.right));
+	r2->cull_max.y = Min(Max(y0, y1), Max(camera.bottom, camera.top));
+}
+
+// True when the bounds, given before the current transform, are entirely outside the visible part of the camera
+// Only called for draws that are about to write vertices, so off-screen draws cost this test instead
+static bool R_Culled(R_Renderer2d *r2, Vec2 min, Vec2 max) {
+	if (!r2->cull || r2->recording)
+		return false;
+
+	const Mat4 &t = Last(r2->transform);
+
+	Vec2 center = 0.5f * (min + max);
+	Vec2 half   = 0.5f * (max - min);
+
+	float center_x = t.rows[0].x * center.x + t.rows[0].y * center.y + t.rows[0].w;
+	float center_y = t.rows[1].x * center.x + t.rows[1].y * center.y + t.rows[1].w;
+	float extent_x = Abs(t.rows[0].x) * half.x + Abs(t.rows[0].y) * half.y;
+	float extent_y = Abs(t.rows[1].x) * half.x + Abs(t.rows[1].y) * half.y;
+
+	return center_x + extent_x < r2->cull_min.x || center_x - extent_x > r2->cull_max.x ||
+		center_y + extent_y < r2->cull_min.y || center_y - extent_y > r2->cull_max.y;
+}
+
+static bool R_CulledPoints(R_Renderer2d *r2, const Vec2 *points, uint32_t count, float margin) {
+	if (!r2->cull || r2->recording || !count)
+		return false;
+
+	Vec2 min = points[0];
+	Vec2 max = points[0];
+	for (uint32_t index = 1; index < count; ++index) {
+		min.x = Min(min.x, points[index].x);
+		min.y = Min(min.y, points[index].y);
+		max.x = Max(max.x, points[index].x);
+		max.y = Max(max.y, points[index].y);
+	}
+
+	return R_Culled(r2, min - Vec2(margin), max + Vec2(margin));
+}
+
+static inline bool R_CulledCircle(R_Renderer2d *r2, Vec2 center, float radius) {
+	return R_Culled(r2, center - Vec2(radius), center + Vec2(radius));
+}
+
+// Segments for an arc of theta radians such that the chords stay within the tolerance of the arc
+static int R_ArcSegments(R_Renderer2d *r2, float radius, float theta, int segments, int min_segments) {
+	if (r2->tolerance <= 0.0f || segments <= min_segments)
+		return segments;
+
+	float pixels = Abs(radius) * R_PixelsPerUnit(r2);
+	if (pixels <= r2->tolerance)
+		return min_segments;
+
+	float step   = 2.0f * ArcCos(1.0f - r2->tolerance / pixels);
+	int   needed = (int)Ceil(theta / step);
+
+	return Clamp(min_segments, segments, needed);
+}
+
+// Uniformly split beziers deviate from the curve by at most factor * deviation / segments^2,
+// where deviation is the largest second difference of the control points
+static int R_BezierSegments(R_Renderer2d *r2, float deviation, float factor, int segments) {
+	if (r2->tolerance <= 0.0f || segments <= 1)
+		return segments;
+
+	float pixels = factor * deviation * R_PixelsPerUnit(r2);
+	int   needed = (int)Ceil(SquareRoot(pixels / r2->tolerance));
+
+	return Clamp(1, segments, needed);
+}
+
 static void R_InitNextDrawCommand(R_Renderer2d *r2) {
-	R_Command2d *command   = r2->write_command;
-	command->camera        = r2->camera;
-	command->pipeline      = Last(r2->pipeline);
-	command->texture       = Last(r2->texture);
-	command->rect          = Last(r2->rect);
-	command->transform     = Last(r2->transform);
-	command->vertex_offset = (uint32_t)r2->vertex.count;
-	command->index_offset  = (uint32_t)r2->index.count;
-	command->index_count   = 0;
+	R_Command2d *command     = r2->write_command;
+	command->camera          = r2->camera;
+	command->pipeline        = Last(r2->pipeline);
+	command->texture         = R_BackendTexture(r2, Last(r2->texture));
+	command->geometry        = nullptr;
+	command->rect            = Last(r2->rect);
+	command->transform       = Last(r2->transform);
+	command->vertex_offset   = (uint32_t)r2->vertex.count;
+	command->index_offset    = (uint32_t)r2->index.count;
+	command->index_count     = 0;
+	command->instance_offset = (uint32_t)r2->sprite.count;
+	command->instance_count  = 0;
+	command->shapes          = false;
+	command->layer           = r2->layer;
 
 	r2->next_index = 0;
 }
@@ -113,9 +661,7 @@ static void R_PushDrawCommand(R_Renderer2d *r2) {
 	if (r2->write_command != &FallbackDrawCmd) {
 		r2->write_command = Append(&r2->command, r2->allocator);
 		if (r2->write_command) {
-#if defined(KR_RENDER2D_ENABLE_DEBUG_INFO)
 			r2->mark.command = Max(r2->mark.command, r2->command.count);
-#endif
 		} else {
 			r2->write_command = &FallbackDrawCmd;
 			LogWarning("Renderer2d: Command buffer overflow. Next render commands will not be recorded.");
@@ -125,28 +671,32 @@ static void R_PushDrawCommand(R_Renderer2d *r2) {
 }
 
 static R_Index2d R_EnsurePrimitive(R_Renderer2d *r2, uint32_t vertex, uint32_t index) {
-	ptrdiff_t vertex_count = r2->vertex.count;
-	ptrdiff_t index_count = r2->index.count;
+	// Triangles and sprites are drawn differently, so they never share a command
+	if (r2->write_command->instance_count)
+		R_PushDrawCommand(r2);
 
-	if (Resize(&r2->vertex, r2->allocator, vertex_count + vertex) &&
-		Resize(&r2->index, r2->allocator, index_count + index)) {
-		r2->write_vertex = &r2->vertex[vertex_count];
-		r2->write_index  = &r2->index[index_count];
+	// Indices are relative to the command's vertex offset, so a new command restarts them from zero
+	if ((uint64_t)r2->next_index + vertex > R_MAX_VERTICES_PER_COMMAND) {
+		if (vertex > R_MAX_VERTICES_PER_COMMAND) {
+			LogWarning("Renderer2d: Primitive with % vertices exceeds the index range. Skipping.", vertex);
+			return R_INVALID_INDEX2D;
+		}
+		R_PushDrawCommand(r2);
+	}
 
+	r2->write_vertex = R_StreamPush(&r2->vertex, r2->allocator, vertex);
+	r2->write_index  = r2->write_vertex ? R_StreamPush(&r2->index, r2->allocator, index) : nullptr;
+
+	if (r2->write_index) {
 		r2->write_command->index_count += index;
 
 		R_Index2d next_index = r2->next_index;
 		r2->next_index += vertex;
 
-#if defined(KR_RENDER2D_ENABLE_DEBUG_INFO)
-		r2->mark.vertex = Max(r2->mark.vertex, r2->vertex.count);
-		r2->mark.index  = Max(r2->mark.index, r2->index.count);
-#endif
-
 		return next_index;
 	}
 
-	LogWarning("Renderer2d: Primitive buffer overflow. Next render commands will not be recorded.");
+	LogWarning("Renderer2d: Failed to allocate overflow memory for primitives. Next render commands will not be recorded.");
 
 	R_PushDrawCommand(r2);
 
@@ -154,7 +704,223 @@ static R_Index2d R_EnsurePrimitive(R_Renderer2d *r2, uint32_t vertex, uint32_t i
 	r2->write_vertex  = nullptr;
 	r2->write_index   = nullptr;
 
-	return -1;
+	return R_INVALID_INDEX2D;
+}
+
+// Returns the part of the last R_EnsurePrimitive reservation that was not written
+static void R_TrimPrimitive(R_Renderer2d *r2, uint32_t vertex, uint32_t index) {
+	R_StreamPop(&r2->vertex, vertex);
+	R_StreamPop(&r2->index, index);
+	r2->write_command->index_count -= index;
+	r2->next_index                 -= vertex;
+}
+
+static R_Sprite2d *R_EnsureInstances(R_Renderer2d *r2, uint32_t count, bool shapes) {
+	R_Command2d *command = r2->write_command;
+	if (command->index_count || (command->instance_count && command->shapes != shapes))
+		R_PushDrawCommand(r2);
+
+	R_Sprite2d *sprite = R_StreamPush(&r2->sprite, r2->allocator, count);
+
+	if (sprite) {
+		r2->write_command->instance_count += count;
+		r2->write_command->shapes          = shapes;
+		return sprite;
+	}
+
+	LogWarning("Renderer2d: Failed to allocate overflow memory for instances. Next render commands will not be recorded.");
+
+	R_PushDrawCommand(r2);
+
+	r2->write_command = &FallbackDrawCmd;
+	r2->write_vertex  = nullptr;
+	r2->write_index   = nullptr;
+
+	return nullptr;
+}
+
+static R_Sprite2d *R_EnsureSprite(R_Renderer2d *r2, uint32_t count) {
+	return R_EnsureInstances(r2, count, false);
+}
+
+// Shapes are stored in the sprite stream, both are 32 bytes per instance
+static R_Shape2d *R_EnsureShape(R_Renderer2d *r2, uint32_t count) {
+	return (R_Shape2d *)R_EnsureInstances(r2, count, true);
+}
+
+static constexpr uint32_t R_TEXT_RUN_FRAMES         = 8;
+static constexpr ptrdiff_t R_TEXT_CACHE_MAX_VERTICES = 128 * 1024;
+
+// FNV-1a of the bytes, then the font, its generation and the factor
+static uint64_t R_HashTextRun(String text, R_Font *font, float factor) {
+	uint64_t hash = 14695981039346656037ull;
+	for (int64_t index = 0; index < text.count; ++index) {
+		hash ^= text.data[index];
+		hash *= 1099511628211ull;
+	}
+
+	uint32_t factor_bits;
+	memcpy(&factor_bits, &factor, sizeof(factor_bits));
+
+	hash ^= (uint64_t)(uintptr_t)font ^ ((uint64_t)factor_bits << 32);
+	hash *= 1099511628211ull;
+	hash ^= font->generation;
+	hash *= 1099511628211ull;
+
+	return hash ^ (hash >> 32);
+}
+
+static void R_InsertTextSlot(R_Text_Cache2d *cache, uint32_t run) {
+	uint32_t mask = (uint32_t)cache->slots.count - 1;
+	uint32_t slot = (uint32_t)cache->runs[run].hash & mask;
+	while (cache->slots[slot])
+		slot = (slot + 1) & mask;
+	cache->slots[slot] = run + 1;
+}
+
+// Slots are kept at most half full, so probes stay short
+static bool R_RebuildTextSlots(R_Text_Cache2d *cache, M_Allocator allocator) {
+	ptrdiff_t count = 64;
+	while (count < 2 * cache->runs.count)
+		count *= 2;
+
+	if (!Resize(&cache->slots, allocator, count))
+		return false;
+
+	memset(cache->slots.data, 0, sizeof(uint32_t) * count);
+	for (uint32_t run = 0; run < (uint32_t)cache->runs.count; ++run)
+		R_InsertTextSlot(cache, run);
+
+	return true;
+}
+
+static R_Text_Run2d *R_FindTextRun(R_Text_Cache2d *cache, String text, R_Font *font, float factor, uint64_t hash) {
+	if (!cache->slots.count)
+		return nullptr;
+
+	uint32_t mask = (uint32_t)cache->slots.count - 1;
+
+	for (uint32_t slot = (uint32_t)hash & mask; cache->slots[slot]; slot = (slot + 1) & mask) {
+		R_Text_Run2d *run = &cache->runs[cache->slots[slot] - 1];
+		if (run->hash == hash && run->font == font && run->generation == font->generation && run->factor == factor && run->text_count == text.count &&
+			memcmp(cache->text.data + run->text_offset, text.data, text.count) == 0)
+			return run;
+	}
+
+	return nullptr;
+}
+
+// Drops the runs that were not drawn in the last R_TEXT_RUN_FRAMES frames
+static void R_EvictTextRuns(R_Text_Cache2d *cache, M_Allocator allocator) {
+	cache->frame += 1;
+
+	bool stale = false;
+	for (const R_Text_Run2d &run : cache->runs)
+		stale |= cache->frame - run.used_frame > R_TEXT_RUN_FRAMES;
+
+	if (!stale)
+		return;
+
+	ptrdiff_t kept     = 0;
+	uint32_t  vertices = 0;
+	uint32_t  text     = 0;
+
+	for (ptrdiff_t index = 0; index < cache->runs.count; ++index) {
+		R_Text_Run2d run = cache->runs[index];
+		if (cache->frame - run.used_frame > R_TEXT_RUN_FRAMES)
+			continue;
+
+		memmove(cache->vertices.data + vertices, cache->vertices.data + run.first_vertex, sizeof(R_Vertex2d) * run.vertex_count);
+		memmove(cache->text.data + text, cache->text.data + run.text_offset, run.text_count);
+
+		run.first_vertex = vertices;
+		run.text_offset  = text;
+		vertices        += run.vertex_count;
+		text            += run.text_count;
+
+		cache->runs[kept++] = run;
+	}
+
+	cache->runs.count     = kept;
+	cache->vertices.count = vertices;
+	cache->text.count     = text;
+
+	// Never grows, the slots are at least as many as before
+	R_RebuildTextSlots(cache, allocator);
+}
+
+static void R_ClearTextCache(R_Text_Cache2d *cache) {
+	Reset(&cache->runs);
+	Reset(&cache->vertices);
+	Reset(&cache->text);
+	if (cache->slots.count)
+		memset(cache->slots.data, 0, sizeof(uint32_t) * cache->slots.count);
+}
+
+// Runs of a destroyed font are evicted at the start of the next frame, the generation already keeps them from matching
+// Contexts recording with the font evict theirs once they stop drawing them
+static void R_ExpireTextRuns(R_Text_Cache2d *cache, R_Font *font) {
+	for (R_Text_Run2d &run : cache->runs) {
+		if (run.font == font)
+			run.used_frame = cache->frame - R_TEXT_RUN_FRAMES - 1;
+	}
+}
+
+static void R_FreeTextCache(R_Text_Cache2d *cache, M_Allocator allocator) {
+	Free(&cache->runs, allocator);
+	Free(&cache->slots, allocator);
+	Free(&cache->vertices, allocator);
+	Free(&cache->text, allocator);
+	*cache = R_Text_Cache2d();
+}
+
+static bool R_InitRecordingState(R_Renderer2d *r2, const R_Specification2d &spec) {
+	if (!R_StreamReserve(&r2->vertex, spec.vertex) ||
+		!R_StreamReserve(&r2->index, spec.index) ||
+		!R_StreamReserve(&r2->sprite, spec.sprite))
+		return false;
+
+	Reserve(&r2->command, r2->allocator, spec.command);
+
+	Reserve(&r2->pipeline, r2->allocator, spec.pipeline);
+	Reserve(&r2->texture, r2->allocator, spec.texture);
+	Reserve(&r2->rect, r2->allocator, spec.rect);
+	Reserve(&r2->transform, r2->allocator, spec.transform);
+	Reserve(&r2->path, r2->allocator, spec.path);
+
+	r2->thickness = spec.thickness;
+	r2->tolerance = spec.tolerance;
+
+	Append(&r2->pipeline, r2->allocator, (R_Pipeline *)nullptr);
+	Append(&r2->texture, r2->allocator, r2->white_texture);
+	Append(&r2->rect, r2->allocator, R_Rect(0.0f, 0.0f, 0.0f, 0.0f));
+	Append(&r2->transform, r2->allocator, Identity());
+
+	if (!r2->pipeline.count || !r2->texture.count || !r2->rect.count || !r2->transform.count)
+		return false;
+
+	r2->camera = { -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f };
+
+	R_PushDrawCommand(r2);
+
+	return true;
+}
+
+static void R_FreeRecordingState(R_Renderer2d *r2) {
+	Free(&r2->command, r2->allocator);
+	R_StreamFree(&r2->vertex, r2->allocator);
+	R_StreamFree(&r2->index, r2->allocator);
+	R_StreamFree(&r2->sprite, r2->allocator);
+	Free(&r2->sorted_command, r2->allocator);
+	Free(&r2->sorted_index, r2->allocator);
+	Free(&r2->sorted_sprite, r2->allocator);
+	Free(&r2->pipeline, r2->allocator);
+	Free(&r2->texture, r2->allocator);
+	Free(&r2->rect, r2->allocator);
+	Free(&r2->transform, r2->allocator);
+	Free(&r2->path, r2->allocator);
+	FreePolygonTriangulator(&r2->triangulator);
+	R_FreeTextCache(&r2->text_cache, r2->allocator);
 }
 
 static void R_FreeFontConfig(R_Font_Config *config, M_Allocator allocator) {
@@ -227,11 +993,17 @@ static void R_LoadRendererResources(R_Renderer2d *r2) {
 
 	r2->default_font  = R_Backend_CreateFont(r2, *r2->default_font_config, r2->default_font_height);
 
+	// Runs are keyed by the font, which may reuse the address of the released one
+	R_ClearTextCache(&r2->text_cache);
+
 	if (!r2->default_font) {
 		LogWarning("Renderer2d: Failed to create default font. Using fallback font.");
 		r2->default_font = (R_Font *) &FallbackFont;
 	}
 
+	if (r2->atlas.pixels)
+		R_UploadAtlas(r2);
+
 	ThreadContext.allocator = backup;
 }
 
@@ -246,6 +1018,15 @@ static void R_ReleaseRendererResources(R_Renderer2d *r2) {
 	if (r2->default_font != &FallbackFont)
 		R_Backend_DestroyFont(r2, r2->default_font);
 
+	if (r2->atlas.texture) {
+		r2->backend->DestroyTexture(r2->backend, r2->atlas.texture);
+		r2->atlas.texture = nullptr;
+	}
+
+	// Every atlas texture has been released at this point, so the space can be reused
+	if (r2->atlas.pixels)
+		R_ResetAtlas(&r2->atlas);
+
 	ThreadContext.allocator = backup;
 }
 
@@ -292,59 +1073,72 @@ R_Renderer2d *R_CreateRenderer2d(R_Backend2d *backend, const R_Specification2d &
 
 	r2->default_font_height = spec.font.height;
 
-	R_LoadRendererResources(r2);
-
-	Reserve(&r2->command, r2->allocator, spec.command);
-	Reserve(&r2->vertex, r2->allocator, spec.vertex);
-	Reserve(&r2->index, r2->allocator, spec.index);
-
-	Reserve(&r2->pipeline, r2->allocator, spec.pipeline);
-	Reserve(&r2->texture, r2->allocator, spec.texture);
-	Reserve(&r2->rect, r2->allocator, spec.rect);
-	Reserve(&r2->transform, r2->allocator, spec.transform);
-	Reserve(&r2->path, r2->allocator, spec.path);
-
-	r2->thickness = spec.thickness;
+	R_InitAtlas(&r2->atlas, spec.atlas, r2->allocator);
 
-	Append(&r2->pipeline, r2->allocator, (R_Pipeline *)nullptr);
-	Append(&r2->texture, r2->allocator, r2->white_texture);
-	Append(&r2->rect, r2->allocator, R_Rect(0.0f, 0.0f, 0.0f, 0.0f));
-	Append(&r2->transform, r2->allocator, Identity());
+	R_LoadRendererResources(r2);
 
-	if (!r2->pipeline.count || !r2->texture.count || !r2->rect.count || !r2->transform.count) {
+	if (!R_InitRecordingState(r2, spec)) {
 		LogError("Renderer2d: Failed to allocate memory for Renderer2d.");
 		R_DestroyRenderer2d(r2);
 		return nullptr;
 	}
 
-	r2->camera = { -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f };
-
-	R_PushDrawCommand(r2);
-
 	return r2;
 }
 
 void R_DestroyRenderer2d(R_Renderer2d *r2) {
+	Assert(!r2->parent);
+
 	R_ReleaseRendererResources(r2);
 
 	if (r2->default_font_config_free)
 		r2->default_font_config_free(r2->default_font_config, r2->allocator);
+
+	R_FreeAtlas(&r2->atlas, r2->allocator);
 	
 	r2->backend->Release(r2->backend);
 
-	Free(&r2->command, r2->allocator);
-	Free(&r2->vertex, r2->allocator);
-	Free(&r2->index, r2->allocator);
-	Free(&r2->pipeline, r2->allocator);
-	Free(&r2->texture, r2->allocator);
-	Free(&r2->rect, r2->allocator);
-	Free(&r2->path, r2->allocator);
-
+	R_FreeRecordingState(r2);
 
 	M_Free(r2, sizeof(*r2), r2->allocator);
 }
 
+R_Renderer2d *R_CreateRecordingContext(R_Renderer2d *parent, const R_Specification2d &spec) {
+	// Contexts of contexts record for the same parent
+	if (parent->parent)
+		parent = parent->parent;
+
+	R_Renderer2d *r2 = new R_Renderer2d;
+
+	if (!r2) {
+		LogError("Renderer2d: Failed to allocate memory for recording context.");
+		return nullptr;
+	}
+
+	r2->parent        = parent;
+	r2->backend       = parent->backend;
+	r2->white_texture = parent->white_texture;
+	r2->default_font  = parent->default_font;
+	r2->sort_mode     = parent->sort_mode;
+
+	if (!R_InitRecordingState(r2, spec)) {
+		LogError("Renderer2d: Failed to allocate memory for recording context.");
+		R_DestroyRecordingContext(r2);
+		return nullptr;
+	}
+
+	return r2;
+}
+
+void R_DestroyRecordingContext(R_Renderer2d *context) {
+	Assert(context->parent);
+	R_FreeRecordingState(context);
+	M_Free(context, sizeof(*context), context->allocator);
+}
+
 R_Texture *R_Backend_CreateTexture(R_Renderer2d *r2, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels) {
+	R_Atlas_Entry2d *entry = R_AtlasInsert(R_SharedAtlas(r2), w, h, n, pixels);
+	if (entry) return (R_Texture *)entry;
 	return r2->backend->CreateTexture(r2->backend, w, h, n, pixels);
 }
 
@@ -353,10 +1147,27 @@ R_Texture *R_Backend_CreateTextureSRGBA(R_Renderer2d *r2, uint32_t w, uint32_t h
 }
 
 void R_Backend_DestroyTexture(R_Renderer2d *r2, R_Texture *texture) {
+	if (R_IsAtlasTexture(r2, texture)) {
+		R_AtlasReleaseTexture(texture);
+		return;
+	}
 	r2->backend->DestroyTexture(r2->backend, texture);
 }
 
 R_Font *R_Backend_CreateFont(R_Renderer2d *r2, const R_Font_Config &config, float height_in_pixels) {
+	if (R_SharedAtlas(r2)->pixels) {
+		M_Arena *arena   = ThreadScratchpad();
+		M_Temporary temp = M_BeginTemporaryMemory(arena);
+		Defer{ M_EndTemporaryMemory(&temp); };
+
+		R_Font *font = LoadFont(arena, config, height_in_pixels);
+		if (font) {
+			if (UploadFontTexture(font, R_AtlasCreateFontTexture, R_AtlasReleaseTexture, r2))
+				return font;
+			ReleaseFont(font);
+		}
+	}
+
 	return r2->backend->CreateFont(r2->backend, config, height_in_pixels);
 }
 
@@ -372,6 +1183,11 @@ R_Font *R_Backend_CreateFont(R_Renderer2d *r2, String font_data, float height, A
 
 void R_Backend_DestroyFont(R_Renderer2d *r2, R_Font *font) {
 	if (font == &FallbackFont) return;
+	R_ExpireTextRuns(&r2->text_cache, font);
+	if (R_IsAtlasTexture(r2, font->texture)) {
+		ReleaseFont(font);
+		return;
+	}
 	r2->backend->DestroyFont(r2->backend, font);
 }
 
@@ -385,6 +1201,19 @@ R_Font_Glyph *R_FontFindGlyph(R_Font *font, uint32_t codepoint) {
 	return font->replacement;
 }
 
+void R_FontFindGlyphs(R_Font *font, const uint32_t *codepoints, uint32_t count, R_Font_Glyph **glyphs) {
+	const uint16_t *index       = font->index.data;
+	uint64_t        index_count = (uint64_t)font->index.count;
+	R_Font_Glyph *  first       = font->glyphs.data;
+	R_Font_Glyph *  replacement = font->replacement;
+
+	for (uint32_t position = 0; position < count; ++position) {
+		uint32_t codepoint = codepoints[position];
+		uint16_t slot      = codepoint < index_count ? index[codepoint] : UINT16_MAX;
+		glyphs[position]   = slot != UINT16_MAX ? first + slot : replacement;
+	}
+}
+
 R_Texture *R_DefaultTexture(R_Renderer2d *r2) {
 	return r2->white_texture;
 }
@@ -401,6 +1230,7 @@ R_Backend2d *R_SwapBackend(R_Renderer2d *r2, R_Backend2d *new_backend) {
 	// Textures and Pipeline must be release before swapping the backend
 	// This procedure MUST not be called in between R_NextFrame and R_FinishFrame
 	Assert(r2->texture.count == 1 && r2->pipeline.count == 1);
+	Assert(!r2->parent);
 
 	R_ReleaseRendererResources(r2);
 
@@ -423,9 +1253,10 @@ void R_SetBackend(R_Renderer2d *r2, R_Backend2d *backend) {
 R_Memory2d R_GetMemoryInformation(R_Renderer2d *r2) {
 	R_Memory2d info;
 
-	info.allocated.command = r2->command.allocated * sizeof(R_Command2d);
-	info.allocated.vertex  = r2->vertex.allocated * sizeof(R_Vertex2d);
-	info.allocated.index   = r2->index.allocated * sizeof(R_Index2d);
+	info.allocated.command = (r2->command.allocated + r2->sorted_command.allocated) * sizeof(R_Command2d);
+	info.allocated.vertex  = R_StreamAllocated(r2->vertex);
+	info.allocated.index   = R_StreamAllocated(r2->index) + r2->sorted_index.allocated * sizeof(R_Index2d);
+	info.allocated.sprite  = R_StreamAllocated(r2->sprite) + r2->sorted_sprite.allocated * sizeof(R_Sprite2d);
 
 	info.allocated.path = 0;
 	info.allocated.path += r2->path.allocated * sizeof(Vec2);
@@ -434,20 +1265,35 @@ R_Memory2d R_GetMemoryInformation(R_Renderer2d *r2) {
 	info.allocated.total += info.allocated.command;
 	info.allocated.total += info.allocated.vertex;
 	info.allocated.total += info.allocated.index;
+	info.allocated.total += info.allocated.sprite;
 	info.allocated.total += info.allocated.path;
 
-#if defined(KR_RENDER2D_ENABLE_DEBUG_INFO)
+	info.budget = {};
+	info.budget.vertex = r2->vertex.budget * sizeof(R_Vertex2d);
+	info.budget.index  = r2->index.budget * sizeof(R_Index2d);
+	info.budget.sprite = r2->sprite.budget * sizeof(R_Sprite2d);
+	info.budget.total  = info.budget.vertex + info.budget.index + info.budget.sprite;
+
 	info.used_mark.command = r2->mark.command * sizeof(R_Command2d);
-	info.used_mark.vertex  = r2->mark.vertex * sizeof(R_Vertex2d);
-	info.used_mark.index   = r2->mark.index * sizeof(R_Index2d);
+	info.used_mark.vertex  = Max(r2->vertex.mark, r2->vertex.count) * sizeof(R_Vertex2d);
+	info.used_mark.index   = Max(r2->index.mark, r2->index.count) * sizeof(R_Index2d);
+	info.used_mark.sprite  = Max(r2->sprite.mark, r2->sprite.count) * sizeof(R_Sprite2d);
 	info.used_mark.path    = r2->mark.path * sizeof(Vec2) * 3;
 
 	info.used_mark.total = 0;
 	info.used_mark.total += info.used_mark.command;
 	info.used_mark.total += info.used_mark.vertex;
 	info.used_mark.total += info.used_mark.index;
+	info.used_mark.total += info.used_mark.sprite;
 	info.used_mark.total += info.used_mark.path;
-#endif
+
+	info.overflow_mark = {};
+	info.overflow_mark.vertex = Max(r2->vertex.overflow_mark, r2->vertex.overflow_count) * sizeof(R_Vertex2d);
+	info.overflow_mark.index  = Max(r2->index.overflow_mark, r2->index.overflow_count) * sizeof(R_Index2d);
+	info.overflow_mark.sprite = Max(r2->sprite.overflow_mark, r2->sprite.overflow_count) * sizeof(R_Sprite2d);
+	info.overflow_mark.total  = info.overflow_mark.vertex + info.overflow_mark.index + info.overflow_mark.sprite;
+
+	info.overflow_frames = r2->overflow_frames;
 
 	return info;
 }
@@ -456,20 +1302,270 @@ R_Memory2d R_GetMemoryInformation(R_Renderer2d *r2) {
 //
 //
 
+struct R_Sort_Slot {
+	uint32_t command;
+	uint32_t id;
+};
+
+struct R_Sort_Table {
+	R_Sort_Slot *slots;
+	uint32_t     mask;
+	uint32_t     count;
+};
+
+typedef uint32_t(*R_Sort_Hash)(const R_Command2d &cmd);
+typedef bool(*R_Sort_Equals)(const R_Command2d &a, const R_Command2d &b);
+
+static uint32_t R_HashBytes(uint32_t hash, const void *ptr, size_t size) {
+	const uint8_t *bytes = (const uint8_t *)ptr;
+	for (size_t index = 0; index < size; ++index) {
+		hash = (hash ^ bytes[index]) * 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t R_HashPipeline(const R_Command2d &cmd) { return R_HashBytes(2166136261u, &cmd.pipeline, sizeof(cmd.pipeline)); }
+static uint32_t R_HashTexture(const R_Command2d &cmd) { return R_HashBytes(2166136261u, &cmd.texture, sizeof(cmd.texture)); }
+
+static uint32_t R_HashDrawState(const R_Command2d &cmd) {
+	uint32_t hash = 2166136261u;
+	hash = R_HashBytes(hash, &cmd.camera, sizeof(cmd.camera));
+	hash = R_HashBytes(hash, &cmd.transform, sizeof(cmd.transform));
+	hash = R_HashBytes(hash, &cmd.rect, sizeof(cmd.rect));
+	return hash;
+}
+
+static bool R_EqualsPipeline(const R_Command2d &a, const R_Command2d &b) { return a.pipeline == b.pipeline; }
+static bool R_EqualsTexture(const R_Command2d &a, const R_Command2d &b) { return a.texture == b.texture; }
+
+static bool R_EqualsDrawState(const R_Command2d &a, const R_Command2d &b) {
+	return memcmp(&a.camera, &b.camera, sizeof(a.camera)) == 0 &&
+		memcmp(&a.transform, &b.transform, sizeof(a.transform)) == 0 &&
+		memcmp(&a.rect, &b.rect, sizeof(a.rect)) == 0;
+}
+
+// Ids are given in order of first use, so the sorted order follows the recorded order when nothing can be merged
+static uint32_t R_SortTableFind(R_Sort_Table *table, const R_Command2d *commands, uint32_t command, R_Sort_Hash hash, R_Sort_Equals equals) {
+	uint32_t slot = hash(commands[command]) & table->mask;
+	for (;;) {
+		R_Sort_Slot *entry = &table->slots[slot];
+		if (entry->command == UINT32_MAX) {
+			entry->command = command;
+			entry->id      = table->count++;
+			return entry->id;
+		}
+		if (equals(commands[entry->command], commands[command]))
+			return entry->id;
+		slot = (slot + 1) & table->mask;
+	}
+}
+
+static void R_SortTableInit(R_Sort_Table *table, M_Arena *arena, uint32_t count) {
+	uint32_t size = 16;
+	while (size < 2 * count)
+		size <<= 1;
+
+	table->slots = M_PushArray(arena, R_Sort_Slot, size);
+	table->mask  = size - 1;
+	table->count = 0;
+
+	memset(table->slots, 0xff, sizeof(R_Sort_Slot) * size);
+}
+
+// Stable LSD radix sort, 8 bits per pass, passes where every key has the same digit are skipped
+static void R_RadixSort(uint64_t *keys, uint32_t *values, uint64_t *temp_keys, uint32_t *temp_values, uint32_t count) {
+	uint64_t *src_keys   = keys;
+	uint32_t *src_values = values;
+	uint64_t *dst_keys   = temp_keys;
+	uint32_t *dst_values = temp_values;
+
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t offsets[256] = {};
+		for (uint32_t index = 0; index < count; ++index) {
+			offsets[(src_keys[index] >> shift) & 0xff] += 1;
+		}
+
+		if (offsets[(src_keys[0] >> shift) & 0xff] == count)
+			continue;
+
+		uint32_t sum = 0;
+		for (uint32_t &offset : offsets) {
+			uint32_t digit_count = offset;
+			offset = sum;
+			sum += digit_count;
+		}
+
+		for (uint32_t index = 0; index < count; ++index) {
+			uint32_t dst     = offsets[(src_keys[index] >> shift) & 0xff]++;
+			dst_keys[dst]    = src_keys[index];
+			dst_values[dst]  = src_values[index];
+		}
+
+		Swap(&src_keys, &dst_keys);
+		Swap(&src_values, &dst_values);
+	}
+
+	if (src_keys != keys) {
+		memcpy(keys, src_keys, sizeof(uint64_t) * count);
+		memcpy(values, src_values, sizeof(uint32_t) * count);
+	}
+}
+
+// Sorted indices and sprites are written to sorted_index and sorted_sprite, returns false when nothing was sorted
+static bool R_SortCommands(R_Renderer2d *r2, const R_Index2d *indices, const R_Sprite2d *sprites) {
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	const R_Command2d *commands = r2->command.data;
+
+	uint32_t count = 0;
+	uint32_t *order = M_PushArray(arena, uint32_t, r2->command.count);
+	for (uint32_t index = 0; index < (uint32_t)r2->command.count; ++index) {
+		if (R_CommandHasDraws(&commands[index]))
+			order[count++] = index;
+	}
+
+	if (count == 0)
+		return false;
+
+	uint64_t *keys        = M_PushArray(arena, uint64_t, count);
+	uint64_t *temp_keys   = M_PushArray(arena, uint64_t, count);
+	uint32_t *temp_values = M_PushArray(arena, uint32_t, count);
+
+	R_Sort_Table pipelines, textures, states;
+	R_SortTableInit(&pipelines, arena, count);
+	R_SortTableInit(&textures, arena, count);
+	R_SortTableInit(&states, arena, count);
+
+	// layer:16 | pipeline:16 | texture:16 | draw state:16
+	// Ids that overflow their bits only make the grouping worse, merging still compares the actual state
+	for (uint32_t index = 0; index < count; ++index) {
+		uint32_t command = order[index];
+		uint64_t pipeline = R_SortTableFind(&pipelines, commands, command, R_HashPipeline, R_EqualsPipeline) & 0xffff;
+		uint64_t texture  = R_SortTableFind(&textures, commands, command, R_HashTexture, R_EqualsTexture) & 0xffff;
+		uint64_t state    = R_SortTableFind(&states, commands, command, R_HashDrawState, R_EqualsDrawState) & 0xffff;
+
+		keys[index] = ((uint64_t)commands[command].layer << 48) | (pipeline << 32) | (texture << 16) | state;
+	}
+
+	R_RadixSort(keys, order, temp_keys, temp_values, count);
+
+	if (!Resize(&r2->sorted_index, r2->allocator, r2->index.count) ||
+		!Resize(&r2->sorted_sprite, r2->allocator, r2->sprite.count) ||
+		!Reserve(&r2->sorted_command, r2->allocator, count)) {
+		LogWarning("Renderer2d: Failed to allocate memory for sorting. Submitting commands unsorted.");
+		return false;
+	}
+
+	Reset(&r2->sorted_command);
+
+	R_Index2d *dst_index   = r2->sorted_index.data;
+	R_Sprite2d *dst_sprite = r2->sorted_sprite.data;
+	uint32_t index_offset    = 0;
+	uint32_t instance_offset = 0;
+
+	for (uint32_t index = 0; index < count; ++index) {
+		const R_Command2d &src = commands[order[index]];
+
+		// Mesh commands draw from their own geometry, so they are never merged
+		if (src.geometry) {
+			Append(&r2->sorted_command, r2->allocator, src);
+			continue;
+		}
+
+		R_Command2d *dst = r2->sorted_command.count ? &Last(r2->sorted_command) : nullptr;
+
+		const R_Index2d *src_index = indices + src.index_offset;
+
+		bool merge = dst && !dst->geometry && keys[index] == keys[index - 1] &&
+			(dst->instance_count != 0) == (src.instance_count != 0) && dst->shapes == src.shapes &&
+			dst->pipeline == src.pipeline && dst->texture == src.texture && R_EqualsDrawState(*dst, src);
+
+		// Merged indices are rebased on the first command's vertex offset, with 16-bit indices they can overflow
+		if (merge && sizeof(R_Index2d) < sizeof(uint32_t)) {
+			uint64_t max_index = 0;
+			for (uint32_t i = 0; i < src.index_count; ++i)
+				max_index = Max(max_index, (uint64_t)src_index[i]);
+			merge = src.vertex_offset >= dst->vertex_offset &&
+				src.vertex_offset - dst->vertex_offset + max_index < R_MAX_VERTICES_PER_COMMAND;
+		}
+
+		if (!merge) {
+			dst = Append(&r2->sorted_command, r2->allocator, src);
+			dst->index_offset    = index_offset;
+			dst->index_count     = 0;
+			dst->instance_offset = instance_offset;
+			dst->instance_count  = 0;
+		}
+
+		if (src.instance_count) {
+			memcpy(dst_sprite + instance_offset, sprites + src.instance_offset, sizeof(R_Sprite2d) * src.instance_count);
+			dst->instance_count += src.instance_count;
+			instance_offset     += src.instance_count;
+			continue;
+		}
+
+		// Indices are rebased so that merged commands share the first command's vertex offset
+		R_Index2d base = (R_Index2d)(src.vertex_offset - dst->vertex_offset);
+		for (uint32_t i = 0; i < src.index_count; ++i) {
+			dst_index[index_offset + i] = src_index[i] + base;
+		}
+
+		dst->index_count += src.index_count;
+		index_offset     += src.index_count;
+	}
+
+	Swap(&r2->command, &r2->sorted_command);
+
+	r2->sorted_index.count  = index_offset;
+	r2->sorted_sprite.count = instance_offset;
+	r2->write_command       = &FallbackDrawCmd;
+
+	return true;
+}
+
+//
+//
+//
+
 void R_NextFrame(R_Renderer2d *r2, R_Rect region) {
 	Assert(r2->texture.count >= 1);
 	Assert(r2->rect.count >= 1);
+	Assert(!r2->recording);
 
 	r2->texture.count   = 1;
 	r2->rect.count      = 1;
 	r2->transform.count = 1;
 
+	if (r2->atlas.dirty)
+		R_UploadAtlas(r2);
+
+	// The parent's resources may have been recreated since the last frame of the context
+	if (r2->parent) {
+		if (r2->default_font != r2->parent->default_font)
+			R_ClearTextCache(&r2->text_cache);
+
+		r2->white_texture = r2->parent->white_texture;
+		r2->default_font  = r2->parent->default_font;
+		r2->sort_mode     = r2->parent->sort_mode;
+		r2->texture[0]    = r2->white_texture;
+	}
+
+	R_UpdateTextureTransform(r2, r2->texture[0]);
+
+	if (r2->vertex.overflow_count || r2->index.overflow_count || r2->sprite.overflow_count)
+		r2->overflow_frames += 1;
+
 	Reset(&r2->command);
-	Reset(&r2->vertex);
-	Reset(&r2->index);
+	R_StreamReset(&r2->vertex, r2->allocator, "Vertex");
+	R_StreamReset(&r2->index, r2->allocator, "Index");
+	R_StreamReset(&r2->sprite, r2->allocator, "Sprite");
 	Reset(&r2->path);
+	R_EvictTextRuns(&r2->text_cache, r2->allocator);
 
 	r2->next_index = 0;
+	r2->layer      = 0;
 	r2->rect[0]    = region;
 
 	r2->write_command = nullptr;
@@ -478,6 +1574,7 @@ void R_NextFrame(R_Renderer2d *r2, R_Rect region) {
 
 	r2->camera = { -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f };
 
+	R_UpdateCullBounds(r2);
 	R_PushDrawCommand(r2);
 }
 
@@ -485,33 +1582,130 @@ void R_FinishFrame(R_Renderer2d *r2, void *context) {
 	if (r2->command.count == 0)
 		return;
 
+	R_Vertex2d *vertices = R_StreamData(&r2->vertex, r2->allocator);
+	R_Index2d *indices   = R_StreamData(&r2->index, r2->allocator);
+	R_Sprite2d *sprites  = R_StreamData(&r2->sprite, r2->allocator);
+
+	if ((r2->vertex.count && !vertices) || (r2->index.count && !indices) || (r2->sprite.count && !sprites)) {
+		LogWarning("Renderer2d: Failed to allocate memory for overflowed primitives. Frame is not submitted.");
+		return;
+	}
+
+	uint32_t index_count  = (uint32_t)r2->index.count;
+	uint32_t sprite_count = (uint32_t)r2->sprite.count;
+
+	if (r2->sort_mode == R_SORT_MODE_STATE && R_SortCommands(r2, indices, sprites)) {
+		indices      = r2->sorted_index.data;
+		sprites      = r2->sorted_sprite.data;
+		index_count  = (uint32_t)r2->sorted_index.count;
+		sprite_count = (uint32_t)r2->sorted_sprite.count;
+	}
+
 	R_Backend2d *backend = r2->backend;
 
-	if (!backend->UploadVertexData(r2->backend, context, r2->vertex.data, (uint32_t)ArrSizeInBytes(r2->vertex)))
+	if (!backend->UploadVertexData(r2->backend, context, vertices, (uint32_t)(r2->vertex.count * sizeof(R_Vertex2d))))
 		return;
 
-	if (!backend->UploadIndexData(r2->backend, context, r2->index.data, (uint32_t)ArrSizeInBytes(r2->index)))
+	if (!backend->UploadIndexData(r2->backend, context, indices, index_count * sizeof(R_Index2d)))
 		return;
 
+	if (sprite_count && !backend->UploadInstanceData(r2->backend, context, sprites, sprite_count * sizeof(R_Sprite2d)))
+		return;
+
+	// The backend may still have the mesh of the last frame bound
+	R_Geometry *geometry = nullptr;
+	backend->SetGeometry(r2->backend, context, nullptr);
+
 	for (const R_Command2d &cmd : r2->command) {
-		if (cmd.index_count == 0)
+		if (!R_CommandHasDraws(&cmd))
 			continue;
 
+		if (cmd.geometry != geometry) {
+			backend->SetGeometry(r2->backend, context, cmd.geometry);
+			geometry = cmd.geometry;
+		}
+
 		R_Backend2d_Draw_Data draw_data;
 		draw_data.camera = cmd.camera;
 		draw_data.transform = cmd.transform;
 
-		backend->UploadDrawData(r2->backend, context, draw_data);
-		backend->SetPipeline(r2->backend, context, cmd.pipeline);
-		backend->SetScissor(r2->backend, context, cmd.rect);
-		backend->SetTexture(r2->backend, context, cmd.texture);
-		backend->DrawTriangleList(r2->backend, context, cmd.index_count, cmd.index_offset, cmd.vertex_offset);
+		backend->UploadDrawData(r2->backend, context, draw_data);
+		backend->SetPipeline(r2->backend, context, cmd.pipeline);
+		backend->SetScissor(r2->backend, context, cmd.rect);
+		backend->SetTexture(r2->backend, context, cmd.texture);
+
+		if (cmd.instance_count && cmd.shapes)
+			backend->DrawInstancedShapes(r2->backend, context, cmd.instance_count, cmd.instance_offset);
+		else if (cmd.instance_count)
+			backend->DrawInstancedQuads(r2->backend, context, cmd.instance_count, cmd.instance_offset);
+		else
+			backend->DrawTriangleList(r2->backend, context, cmd.index_count, cmd.index_offset, cmd.vertex_offset);
+	}
+}
+
+void R_AppendContext(R_Renderer2d *r2, R_Renderer2d *context) {
+	Assert(context != r2 && context->parent == (r2->parent ? r2->parent : r2));
+
+	if (r2->write_command == &FallbackDrawCmd)
+		return;
+
+	// The current command is replaced when it has not recorded anything yet
+	ptrdiff_t command_count = r2->command.count;
+	if (!R_CommandHasDraws(r2->write_command))
+		command_count -= 1;
+
+	const R_Vertex2d *vertices = R_StreamData(&context->vertex, context->allocator);
+	const R_Index2d *indices   = R_StreamData(&context->index, context->allocator);
+	const R_Sprite2d *sprites  = R_StreamData(&context->sprite, context->allocator);
+
+	ptrdiff_t vertex_count = r2->vertex.count;
+	ptrdiff_t index_count  = r2->index.count;
+	ptrdiff_t sprite_count = r2->sprite.count;
+
+	if (!Reserve(&r2->command, r2->allocator, command_count + context->command.count + 1) ||
+		!R_StreamAppend(&r2->vertex, r2->allocator, vertices, context->vertex.count) ||
+		!R_StreamAppend(&r2->index, r2->allocator, indices, context->index.count) ||
+		!R_StreamAppend(&r2->sprite, r2->allocator, sprites, context->sprite.count)) {
+		// Streams that were appended before the failure would shift the offsets of the draws after this
+		R_StreamTruncate(&r2->vertex, vertex_count);
+		R_StreamTruncate(&r2->index, index_count);
+		R_StreamTruncate(&r2->sprite, sprite_count);
+		LogWarning("Renderer2d: Failed to allocate memory for recording context. Recording context is not appended.");
+		return;
+	}
+
+	// Indices are relative to the command's vertex offset, so only the offsets of the commands are moved
+	r2->command.count = command_count;
+	for (const R_Command2d &src : context->command) {
+		if (!R_CommandHasDraws(&src))
+			continue;
+		R_Command2d *dst      = Append(&r2->command, r2->allocator, src);
+		if (dst->geometry)
+			continue;
+		dst->vertex_offset   += (uint32_t)vertex_count;
+		dst->index_offset    += (uint32_t)index_count;
+		dst->instance_offset += (uint32_t)sprite_count;
 	}
+
+	// Draws recorded after this continue in a new command with the current state of r2
+	R_PushDrawCommand(r2);
 }
 
 void R_NextDrawCommand(R_Renderer2d *r2) {
-	if (r2->write_command->index_count)
+	if (R_CommandHasDraws(r2->write_command))
+		R_PushDrawCommand(r2);
+}
+
+void R_SetSortMode(R_Renderer2d *r2, R_Sort_Mode2d mode) {
+	r2->sort_mode = mode;
+}
+
+void R_SetLayer(R_Renderer2d *r2, uint16_t layer) {
+	// Layers only affect the submission order when the commands are sorted
+	if (r2->sort_mode == R_SORT_MODE_STATE && r2->layer != layer && R_CommandHasDraws(r2->write_command))
 		R_PushDrawCommand(r2);
+	r2->layer                = layer;
+	r2->write_command->layer = layer;
 }
 
 //
@@ -519,7 +1713,7 @@ void R_NextDrawCommand(R_Renderer2d *r2) {
 //
 
 void R_CameraView(R_Renderer2d *r2, float left, float right, float bottom, float top, float z_near, float z_far) {
-	if (r2->write_command->index_count)
+	if (R_CommandHasDraws(r2->write_command))
 		R_PushDrawCommand(r2);
 
 	r2->camera.left   = left;
@@ -530,6 +1724,8 @@ void R_CameraView(R_Renderer2d *r2, float left, float right, float bottom, float
 	r2->camera.far    = z_far;
 
 	r2->write_command->camera = r2->camera;
+
+	R_UpdateCullBounds(r2);
 }
 
 void R_CameraView(R_Renderer2d *r2, float aspect_ratio, float height) {
@@ -558,9 +1754,27 @@ void R_SetLineThickness(R_Renderer2d *r2, float thickness) {
 	r2->thickness = thickness;
 }
 
+void R_SetLineJoin(R_Renderer2d *r2, R_Line_Join2d join, float miter_limit) {
+	r2->join        = join;
+	r2->miter_limit = Max(miter_limit, 1.0f);
+}
+
+void R_SetLineCap(R_Renderer2d *r2, R_Line_Cap2d cap) {
+	r2->cap = cap;
+}
+
+void R_SetTessellationTolerance(R_Renderer2d *r2, float tolerance) {
+	r2->tolerance = Max(tolerance, 0.0f);
+}
+
+void R_SetCulling(R_Renderer2d *r2, bool cull) {
+	r2->cull = cull;
+	R_UpdateCullBounds(r2);
+}
+
 void R_SetPipeline(R_Renderer2d *r2, R_Pipeline *pipeline) {
 	R_Pipeline *prev_pipeline = r2->pipeline[r2->pipeline.count - 1];
-	if (prev_pipeline != pipeline && r2->write_command->index_count)
+	if (prev_pipeline != pipeline && R_CommandHasDraws(r2->write_command))
 		R_PushDrawCommand(r2);
 	r2->pipeline[r2->pipeline.count - 1] = pipeline;
 	r2->write_command->pipeline          = pipeline;
@@ -578,11 +1792,12 @@ void R_PopPipeline(R_Renderer2d *r2) {
 }
 
 void R_SetTexture(R_Renderer2d *r2, R_Texture *texture) {
-	R_Texture *prev_texture = r2->texture[r2->texture.count - 1];
-	if (prev_texture != texture && r2->write_command->index_count)
+	R_Texture *backend_texture = R_BackendTexture(r2, texture);
+	if (r2->write_command->texture != backend_texture && R_CommandHasDraws(r2->write_command))
 		R_PushDrawCommand(r2);
 	r2->texture[r2->texture.count - 1] = texture;
-	r2->write_command->texture         = texture;
+	r2->write_command->texture         = backend_texture;
+	R_UpdateTextureTransform(r2, texture);
 }
 
 void R_PushTexture(R_Renderer2d *r2, R_Texture *texture) {
@@ -598,10 +1813,12 @@ void R_PopTexture(R_Renderer2d *r2) {
 
 void R_SetRect(R_Renderer2d *r2, R_Rect rect) {
 	R_Rect prev_rect = r2->rect[r2->rect.count - 1];
-	if (memcmp(&prev_rect, &rect, sizeof(rect)) != 0 && r2->write_command->index_count)
+	if (memcmp(&prev_rect, &rect, sizeof(rect)) != 0 && R_CommandHasDraws(r2->write_command))
 		R_PushDrawCommand(r2);
 	r2->rect[r2->rect.count - 1] = rect;
 	r2->write_command->rect      = rect;
+
+	R_UpdateCullBounds(r2);
 }
 
 void R_PushRect(R_Renderer2d *r2, R_Rect rect) {
@@ -617,7 +1834,7 @@ void R_PopRect(R_Renderer2d *r2) {
 
 void R_SetTransform(R_Renderer2d *r2, const Mat4 &transform) {
 	const Mat4 *prev = &r2->transform[r2->transform.count - 1];
-	if (memcmp(prev, &transform, sizeof(transform)) != 0 && r2->write_command->index_count)
+	if (memcmp(prev, &transform, sizeof(transform)) != 0 && R_CommandHasDraws(r2->write_command))
 		R_PushDrawCommand(r2);
 	r2->transform[r2->transform.count - 1] = transform;
 	r2->write_command->transform           = transform;
@@ -675,15 +1892,19 @@ Mat4 R_CurrentTransform(R_Renderer2d *r2) {
 }
 
 void R_DrawTriangle(R_Renderer2d *r2, Vec3 va, Vec3 vb, Vec3 vc, Vec2 ta, Vec2 tb, Vec2 tc, Vec4 ca, Vec4 cb, Vec4 cc) {
+	Vec2 corners[] = { va._0.xy, vb._0.xy, vc._0.xy };
+	if (R_CulledPoints(r2, corners, 3, 0.0f))
+		return;
+
 	R_Index2d index = R_EnsurePrimitive(r2, 3, 3);
 
-	if (index != -1) {
+	if (index != R_INVALID_INDEX2D) {
 		R_Vertex2d *vtx = r2->write_vertex;
 		R_Index2d * idx = r2->write_index;
 
-		vtx[0].position = va; vtx[0].tex_coord = ta; vtx[0].color = ca;
-		vtx[1].position = vb; vtx[1].tex_coord = tb; vtx[1].color = cb;
-		vtx[2].position = vc; vtx[2].tex_coord = tc; vtx[2].color = cc;
+		R_SetVertex2d(&vtx[0], va, R_MapTexCoord(r2, ta), ca);
+		R_SetVertex2d(&vtx[1], vb, R_MapTexCoord(r2, tb), cb);
+		R_SetVertex2d(&vtx[2], vc, R_MapTexCoord(r2, tc), cc);
 
 		idx[0] = index + 0;
 		idx[1] = index + 1;
@@ -708,16 +1929,20 @@ void R_DrawTriangle(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec2 c, Vec4 color) {
 }
 
 void R_DrawQuad(R_Renderer2d *r2, Vec3 va, Vec3 vb, Vec3 vc, Vec3 vd, Vec2 ta, Vec2 tb, Vec2 tc, Vec2 td, Vec4 color) {
+	Vec2 corners[] = { va._0.xy, vb._0.xy, vc._0.xy, vd._0.xy };
+	if (R_CulledPoints(r2, corners, 4, 0.0f))
+		return;
+
 	R_Index2d index = R_EnsurePrimitive(r2, 4, 6);
 
-	if (index != -1) {
+	if (index != R_INVALID_INDEX2D) {
 		R_Vertex2d *vtx = r2->write_vertex;
 		R_Index2d * idx = r2->write_index;
 
-		vtx[0].position = va; vtx[0].tex_coord = ta; vtx[0].color = color;
-		vtx[1].position = vb; vtx[1].tex_coord = tb; vtx[1].color = color;
-		vtx[2].position = vc; vtx[2].tex_coord = tc; vtx[2].color = color;
-		vtx[3].position = vd; vtx[3].tex_coord = td; vtx[3].color = color;
+		R_SetVertex2d(&vtx[0], va, R_MapTexCoord(r2, ta), color);
+		R_SetVertex2d(&vtx[1], vb, R_MapTexCoord(r2, tb), color);
+		R_SetVertex2d(&vtx[2], vc, R_MapTexCoord(r2, tc), color);
+		R_SetVertex2d(&vtx[3], vd, R_MapTexCoord(r2, td), color);
 
 		idx[0] = index + 0;
 		idx[1] = index + 1;
@@ -784,6 +2009,78 @@ void R_DrawRect(R_Renderer2d *r2, Vec2 pos, Vec2 dim, R_Rect rect, Vec4 color) {
 	R_DrawRect(r2, Vec3(pos, 0), dim, rect, color);
 }
 
+// The color step is 0 when every rect has the first color
+static void R_DrawRects(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const Vec4 *colors, uint32_t color_step, uint32_t count) {
+	if (!count) return;
+
+	// Corners of R_DrawRect, only their positions and colors change from rect to rect
+	R_Vertex2d corners[4];
+	R_SetVertex2d(&corners[0], Vec3(0), R_MapTexCoord(r2, Vec2(0, 0)), colors[0]);
+	R_SetVertex2d(&corners[1], Vec3(0), R_MapTexCoord(r2, Vec2(0, 1)), colors[0]);
+	R_SetVertex2d(&corners[2], Vec3(0), R_MapTexCoord(r2, Vec2(1, 1)), colors[0]);
+	R_SetVertex2d(&corners[3], Vec3(0), R_MapTexCoord(r2, Vec2(1, 0)), colors[0]);
+
+	uint32_t chunk_rects = (uint32_t)Min((uint64_t)count, (uint64_t)R_MAX_VERTICES_PER_COMMAND / 4);
+
+	for (uint32_t first = 0; first < count; first += chunk_rects) {
+		uint32_t chunk = Min(chunk_rects, count - first);
+
+		R_Index2d index = R_EnsurePrimitive(r2, 4 * chunk, 6 * chunk);
+		if (index == R_INVALID_INDEX2D)
+			return;
+
+		R_Vertex2d *vtx = r2->write_vertex;
+		R_Index2d * idx = r2->write_index;
+
+		for (uint32_t rect = first; rect < first + chunk; ++rect) {
+			if (R_Culled(r2, positions[rect], positions[rect] + dims[rect]))
+				continue;
+
+			if (color_step) {
+				R_SetVertexColor2d(&corners[0], colors[rect]);
+				corners[1].color = corners[0].color;
+				corners[2].color = corners[0].color;
+				corners[3].color = corners[0].color;
+			}
+
+			Vec2 a = positions[rect];
+			Vec2 c = a + dims[rect];
+
+			vtx[0] = corners[0];
+			vtx[1] = corners[1];
+			vtx[2] = corners[2];
+			vtx[3] = corners[3];
+
+			R_SetVertexPosition2d(&vtx[0], Vec3(a.x, a.y, 0));
+			R_SetVertexPosition2d(&vtx[1], Vec3(a.x, c.y, 0));
+			R_SetVertexPosition2d(&vtx[2], Vec3(c.x, c.y, 0));
+			R_SetVertexPosition2d(&vtx[3], Vec3(c.x, a.y, 0));
+
+			idx[0] = index + 0;
+			idx[1] = index + 1;
+			idx[2] = index + 2;
+			idx[3] = index + 0;
+			idx[4] = index + 2;
+			idx[5] = index + 3;
+
+			vtx   += 4;
+			idx   += 6;
+			index += 4;
+		}
+
+		uint32_t written = (uint32_t)(vtx - r2->write_vertex) / 4;
+		R_TrimPrimitive(r2, 4 * (chunk - written), 6 * (chunk - written));
+	}
+}
+
+void R_DrawRects(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const Vec4 *colors, uint32_t count) {
+	R_DrawRects(r2, positions, dims, colors, 1, count);
+}
+
+void R_DrawRects(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, Vec4 color, uint32_t count) {
+	R_DrawRects(r2, positions, dims, &color, 0, count);
+}
+
 void R_DrawRectRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, Vec2 uv_a, Vec2 uv_b, Vec2 uv_c, Vec2 uv_d, Vec4 color) {
 	Vec2  center = 0.5f * (2.0f * pos._0.xy + dim);
 
@@ -909,68 +2206,559 @@ void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle
 	d.x = t3.x * cv - t3.y * sv;
 	d.y = t3.x * sv + t3.y * cv;
 
-	a += center;
-	b += center;
-	c += center;
-	d += center;
+	a += center;
+	b += center;
+	c += center;
+	d += center;
+
+	R_DrawQuad(r2, Vec3(a, pos.z), Vec3(b, pos.z), Vec3(c, pos.z), Vec3(d, pos.z), uv_a, uv_b, uv_c, uv_d, color);
+}
+
+void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, Vec2 uv_a, Vec2 uv_b, Vec2 uv_c, Vec2 uv_d, Vec4 color) {
+	R_DrawRectCenteredRotated(r2, Vec3(pos, 0), dim, angle, uv_a, uv_b, uv_c, uv_d, color);
+}
+
+void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, Vec4 color) {
+	R_DrawRectCenteredRotated(r2, pos, dim, angle, Vec2(0, 0), Vec2(0, 1), Vec2(1, 1), Vec2(1, 0), color);
+}
+
+void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, Vec4 color) {
+	R_DrawRectCenteredRotated(r2, Vec3(pos, 0), dim, angle, Vec2(0, 0), Vec2(0, 1), Vec2(1, 1), Vec2(1, 0), color);
+}
+
+void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color) {
+	auto uv_a = rect.min;
+	auto uv_b = Vec2(rect.min.x, rect.max.y);
+	auto uv_c = rect.max;
+	auto uv_d = Vec2(rect.max.x, rect.min.y);
+	R_DrawRectCenteredRotated(r2, pos, dim, angle, uv_a, uv_b, uv_c, uv_d, color);
+}
+
+void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color) {
+	R_DrawRectCenteredRotated(r2, Vec3(pos, 0), dim, angle, rect, color);
+}
+
+static inline uint16_t R_PackUnorm16(float value) {
+	return (uint16_t)(Clamp(0.0f, 1.0f, value) * 65535.0f + 0.5f);
+}
+
+void R_DrawSprite(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color) {
+	if (R_CulledCircle(r2, pos, 0.5f * Length(dim)))
+		return;
+
+	R_Sprite2d *sprite = R_EnsureSprite(r2, 1);
+
+	if (sprite) {
+		Vec2 uv_min = R_MapTexCoord(r2, rect.min);
+		Vec2 uv_max = R_MapTexCoord(r2, rect.max);
+
+		sprite->position  = pos;
+		sprite->dimension = dim;
+		sprite->angle     = angle;
+		sprite->uv[0]     = R_PackUnorm16(uv_min.x);
+		sprite->uv[1]     = R_PackUnorm16(uv_min.y);
+		sprite->uv[2]     = R_PackUnorm16(uv_max.x);
+		sprite->uv[3]     = R_PackUnorm16(uv_max.y);
+		sprite->color     = R_PackColor(color);
+	}
+}
+
+void R_DrawSprite(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, Vec4 color) {
+	R_DrawSprite(r2, pos, dim, angle, R_Rect(0.0f, 0.0f, 1.0f, 1.0f), color);
+}
+
+void R_DrawSprite(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color) {
+	R_DrawSprite(r2, pos, dim, 0.0f, R_Rect(0.0f, 0.0f, 1.0f, 1.0f), color);
+}
+
+static void R_DrawSprites(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const float *angles, const Vec4 *colors, uint32_t color_step, uint32_t count) {
+	if (!count) return;
+
+	R_Sprite2d *sprites = R_EnsureSprite(r2, count);
+	if (!sprites) return;
+
+	Vec2 uv_min = R_MapTexCoord(r2, Vec2(0.0f));
+	Vec2 uv_max = R_MapTexCoord(r2, Vec2(1.0f));
+
+	R_Sprite2d base;
+	base.angle = 0.0f;
+	base.uv[0] = R_PackUnorm16(uv_min.x);
+	base.uv[1] = R_PackUnorm16(uv_min.y);
+	base.uv[2] = R_PackUnorm16(uv_max.x);
+	base.uv[3] = R_PackUnorm16(uv_max.y);
+	base.color = R_PackColor(colors[0]);
+
+	R_Sprite2d *sprite = sprites;
+
+	for (uint32_t index = 0; index < count; ++index) {
+		if (R_CulledCircle(r2, positions[index], 0.5f * Length(dims[index])))
+			continue;
+
+		*sprite = base;
+		sprite->position  = positions[index];
+		sprite->dimension = dims[index];
+		if (angles)     sprite->angle = angles[index];
+		if (color_step) sprite->color = R_PackColor(colors[index]);
+		sprite += 1;
+	}
+
+	// Culled sprites are given back
+	uint32_t skipped = count - (uint32_t)(sprite - sprites);
+	R_StreamPop(&r2->sprite, skipped);
+	r2->write_command->instance_count -= skipped;
+}
+
+void R_DrawSprites(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const float *angles, const Vec4 *colors, uint32_t count) {
+	R_DrawSprites(r2, positions, dims, angles, colors, 1, count);
+}
+
+void R_DrawSprites(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const float *angles, Vec4 color, uint32_t count) {
+	R_DrawSprites(r2, positions, dims, angles, &color, 0, count);
+}
+
+void R_DrawSprites(R_Renderer2d *r2, const R_Sprite2d *sprites, uint32_t count) {
+	if (!count) return;
+
+	R_Sprite2d *dst = R_EnsureSprite(r2, count);
+	if (dst) memcpy(dst, sprites, sizeof(R_Sprite2d) * count);
+}
+
+// Local units covered by one pixel of the frame, shapes drawn with a smaller margin would clip their anti-aliased edge
+static float R_ShapeFeather(R_Renderer2d *r2) {
+	Vec2 units = R_CameraUnitsPerPixel(r2);
+	Vec2 scale = R_TransformScale(r2);
+
+	float min_scale = Min(scale.x, scale.y);
+	return min_scale > 0.0f ? Max(units.x, units.y) / min_scale : 0.0f;
+}
+
+static inline uint16_t R_PackAngle(float angle) {
+	float turns = angle * (0.5f * PI_INVERSE);
+	turns -= Floor(turns);
+	return (uint16_t)((uint32_t)(turns * 65536.0f + 0.5f) & 0xffff);
+}
+
+void R_DrawShape(R_Renderer2d *r2, R_Shape_Kind2d kind, Vec2 pos, Vec2 half_dim, float angle, float radius, float thickness, Vec4 color) {
+	float feather = R_ShapeFeather(r2);
+
+	if (R_CulledCircle(r2, pos, Length(half_dim) + feather))
+		return;
+
+	R_Shape2d *shape = R_EnsureShape(r2, 1);
+
+	if (shape) {
+		shape->position  = pos;
+		shape->dimension = half_dim;
+		shape->radius    = Clamp(0.0f, Min(half_dim.x, half_dim.y), radius);
+		shape->angle     = R_PackAngle(angle);
+		shape->kind      = (uint16_t)kind;
+		shape->thickness = R_PackHalf(Max(thickness, 0.0f));
+		shape->feather   = R_PackHalf(feather);
+		shape->color     = R_PackColor(color);
+	}
+}
+
+void R_DrawShapeCircle(R_Renderer2d *r2, Vec2 pos, float radius, Vec4 color) {
+	R_DrawShape(r2, R_SHAPE_KIND_ROUNDED_RECT, pos, Vec2(radius), 0.0f, radius, 0.0f, color);
+}
+
+void R_DrawShapeEllipse(R_Renderer2d *r2, Vec2 pos, float radius_a, float radius_b, Vec4 color) {
+	R_DrawShape(r2, R_SHAPE_KIND_ELLIPSE, pos, Vec2(radius_a, radius_b), 0.0f, 0.0f, 0.0f, color);
+}
+
+void R_DrawShapeRing(R_Renderer2d *r2, Vec2 pos, float radius, float thickness, Vec4 color) {
+	R_DrawShape(r2, R_SHAPE_KIND_ROUNDED_RECT, pos, Vec2(radius), 0.0f, radius, thickness, color);
+}
+
+void R_DrawShapeCapsule(R_Renderer2d *r2, Vec2 a, Vec2 b, float radius, Vec4 color) {
+	Vec2  dir    = b - a;
+	float length = Length(dir);
+	float angle  = length > 0.0f ? ArcTan2(dir.y, dir.x) : 0.0f;
+	R_DrawShape(r2, R_SHAPE_KIND_ROUNDED_RECT, 0.5f * (a + b), Vec2(0.5f * length + radius, radius), angle, radius, 0.0f, color);
+}
+
+void R_DrawShapeLine(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec4 color) {
+	Vec2 points[] = { a, b };
+	R_DrawShapeLines(r2, points, 2, color);
+}
+
+void R_DrawShapeLines(R_Renderer2d *r2, const Vec2 *points, uint32_t count, Vec4 color) {
+	uint32_t segments = count / 2;
+	if (!segments)
+		return;
+
+	R_Shape2d *shapes = R_EnsureShape(r2, segments);
+	if (!shapes)
+		return;
+
+	// Same for every segment, so they are computed once for the whole batch
+	float    margin    = R_ShapeFeather(r2);
+	uint16_t thickness = R_PackHalf(0.0f);
+	uint16_t feather   = R_PackHalf(margin);
+	uint32_t packed    = R_PackColor(color);
+	float    half_dim  = 0.5f * r2->thickness;
+
+	margin += half_dim;
+
+	R_Shape2d *shape = shapes;
+
+	for (uint32_t index = 0; index < segments; ++index) {
+		Vec2 a   = points[2 * index + 0];
+		Vec2 b   = points[2 * index + 1];
+		Vec2 dir = b - a;
+
+		if (IsNull(dir) || R_CulledPoints(r2, &points[2 * index], 2, margin))
+			continue;
+
+		shape->position  = 0.5f * (a + b);
+		shape->dimension = Vec2(0.5f * Length(dir), half_dim);
+		shape->radius    = 0.0f;
+		shape->angle     = R_PackAngle(ArcTan2(dir.y, dir.x));
+		shape->kind      = R_SHAPE_KIND_ROUNDED_RECT;
+		shape->thickness = thickness;
+		shape->feather   = feather;
+		shape->color     = packed;
+		shape += 1;
+	}
+
+	// Zero length and culled segments are not drawn, their instances are given back
+	uint32_t skipped = segments - (uint32_t)(shape - shapes);
+	R_StreamPop(&r2->sprite, skipped);
+	r2->write_command->instance_count -= skipped;
+}
+
+void R_DrawShapeRoundedRect(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color, float radius) {
+	R_DrawShape(r2, R_SHAPE_KIND_ROUNDED_RECT, pos + 0.5f * dim, 0.5f * dim, 0.0f, radius, 0.0f, color);
+}
+
+void R_DrawShapeRoundedRectOutline(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color, float radius) {
+	R_DrawShape(r2, R_SHAPE_KIND_ROUNDED_RECT, pos + 0.5f * dim, 0.5f * dim, 0.0f, radius, r2->thickness, color);
+}
+
+void R_BeginRecord(R_Renderer2d *r2) {
+	Assert(!r2->recording);
+
+	if (R_CommandHasDraws(r2->write_command))
+		R_PushDrawCommand(r2);
+
+	r2->recording      = true;
+	r2->record.command = r2->command.count - 1;
+	r2->record.vertex  = r2->vertex.count;
+	r2->record.index   = r2->index.count;
+	r2->record.sprite  = r2->sprite.count;
+}
+
+static R_Mesh2d *R_CreateMesh(R_Renderer2d *r2, const R_Record_Mark2d &record) {
+	uint32_t command_count = 0;
+	bool     sprites       = false;
+
+	for (ptrdiff_t index = record.command; index < r2->command.count; ++index) {
+		const R_Command2d &cmd = r2->command[index];
+		sprites       |= cmd.instance_count != 0;
+		command_count += cmd.index_count != 0;
+	}
+
+	if (sprites)
+		LogWarning("Renderer2d: Sprites and shapes can not be recorded into a mesh. Skipping them.");
+
+	if (!command_count)
+		return nullptr;
+
+	uint32_t vertex_count = (uint32_t)(r2->vertex.count - record.vertex);
+	uint32_t index_count  = (uint32_t)(r2->index.count - record.index);
+
+	R_Array<R_Vertex2d> split_vertices;
+	R_Array<R_Index2d>  split_indices;
+	Defer{ Free(&split_vertices, r2->allocator); };
+	Defer{ Free(&split_indices, r2->allocator); };
+
+	const R_Vertex2d *vertices = R_StreamRange(&r2->vertex, r2->allocator, &split_vertices, record.vertex, vertex_count);
+	const R_Index2d *indices   = R_StreamRange(&r2->index, r2->allocator, &split_indices, record.index, index_count);
+
+	if (!vertices || !indices) {
+		LogWarning("Renderer2d: Failed to allocate memory for mesh.");
+		return nullptr;
+	}
+
+	size_t allocated = sizeof(R_Mesh2d) + sizeof(R_Mesh_Command2d) * command_count;
+
+	R_Mesh2d *mesh = (R_Mesh2d *)M_Alloc(allocated, r2->allocator);
+	if (!mesh) {
+		LogWarning("Renderer2d: Failed to allocate memory for mesh.");
+		return nullptr;
+	}
+
+	mesh->geometry = r2->backend->CreateGeometry(r2->backend, vertices, vertex_count, indices, index_count);
+	if (!mesh->geometry) {
+		LogWarning("Renderer2d: Failed to create geometry for mesh.");
+		M_Free(mesh, allocated, r2->allocator);
+		return nullptr;
+	}
+
+	mesh->commands      = (R_Mesh_Command2d *)(mesh + 1);
+	mesh->command_count = command_count;
+	mesh->allocated     = allocated;
+
+	R_Texture *atlas = R_SharedAtlas(r2)->texture;
+
+	R_Mesh_Command2d *dst = mesh->commands;
+	for (ptrdiff_t index = record.command; index < r2->command.count; ++index) {
+		const R_Command2d &src = r2->command[index];
+		if (!src.index_count) continue;
+
+		dst->pipeline      = src.pipeline;
+		dst->texture       = src.texture;
+		dst->atlas         = atlas && src.texture == atlas;
+		dst->transform     = src.transform;
+		dst->vertex_offset = (uint32_t)(src.vertex_offset - record.vertex);
+		dst->index_offset  = (uint32_t)(src.index_offset - record.index);
+		dst->index_count   = src.index_count;
+		dst += 1;
+	}
+
+	return mesh;
+}
+
+R_Mesh2d *R_EndRecord(R_Renderer2d *r2) {
+	Assert(r2->recording);
+
+	r2->recording = false;
+
+	if (r2->write_command == &FallbackDrawCmd) {
+		LogWarning("Renderer2d: Buffer overflow while recording. Mesh is not created.");
+		return nullptr;
+	}
+
+	R_Mesh2d *mesh = R_CreateMesh(r2, r2->record);
+
+	// Recorded draws are not part of the frame
+	R_StreamTruncate(&r2->vertex, r2->record.vertex);
+	R_StreamTruncate(&r2->index, r2->record.index);
+	R_StreamTruncate(&r2->sprite, r2->record.sprite);
+
+	r2->command.count = r2->record.command;
+	R_PushDrawCommand(r2);
+
+	return mesh;
+}
+
+void R_DestroyMesh(R_Renderer2d *r2, R_Mesh2d *mesh) {
+	if (!mesh) return;
+	r2->backend->DestroyGeometry(r2->backend, mesh->geometry);
+	M_Free(mesh, mesh->allocated, r2->allocator);
+}
+
+void R_DrawMesh(R_Renderer2d *r2, R_Mesh2d *mesh, const Mat4 &transform) {
+	if (!mesh) return;
+
+	// Mesh commands can not be captured into another mesh
+	Assert(!r2->recording);
+
+	Mat4 base        = Last(r2->transform) * transform;
+	R_Texture *atlas = R_SharedAtlas(r2)->texture;
+
+	for (uint32_t index = 0; index < mesh->command_count; ++index) {
+		const R_Mesh_Command2d &src = mesh->commands[index];
+
+		if (R_CommandHasDraws(r2->write_command))
+			R_PushDrawCommand(r2);
+
+		if (r2->write_command == &FallbackDrawCmd)
+			return;
+
+		R_Command2d *dst   = r2->write_command;
+		dst->pipeline      = src.pipeline;
+		dst->texture       = src.atlas ? atlas : src.texture;
+		dst->transform     = base * src.transform;
+		dst->geometry      = mesh->geometry;
+		dst->vertex_offset = src.vertex_offset;
+		dst->index_offset  = src.index_offset;
+		dst->index_count   = src.index_count;
+	}
+
+	// Draws after the mesh continue with the current state
+	R_PushDrawCommand(r2);
+}
+
+void R_DrawMesh(R_Renderer2d *r2, R_Mesh2d *mesh) {
+	R_DrawMesh(r2, mesh, Identity());
+}
+
+// Full circles are not reduced below a square, arcs down to a single segment
+static constexpr int R_MIN_LOD_CIRCLE_SEGMENTS = 4;
+
+static inline float R_TableAngle(int value_count) {
+	return (float)value_count * (2.0f * PI / (float)MAX_CIRCLE_SEGMENTS);
+}
+
+// One indexed fan per shape, the rim points are looked up the same way the segments are counted
+// Closed fans reuse the first rim point for the last segment
+static void R_DrawEllipseFan(R_Renderer2d *r2, Vec3 pos, float radius_a, float radius_b, int first_index, int value_count, int segments, bool closed, Vec4 color) {
+	if (segments <= 0) return;
+
+	Vec2 radius = Vec2(Abs(radius_a), Abs(radius_b));
+	if (R_Culled(r2, pos._0.xy - radius, pos._0.xy + radius))
+		return;
+
+	uint32_t rim_count = closed ? segments : segments + 1;
+
+	R_Index2d index = R_EnsurePrimitive(r2, 1 + rim_count, 3 * segments);
+	if (index == R_INVALID_INDEX2D)
+		return;
+
+	R_Vertex2d *vtx = r2->write_vertex;
+	R_Index2d * idx = r2->write_index;
+
+	Vec2 uv = R_MapTexCoord(r2, Vec2(0));
+
+	R_SetVertex2d(&vtx[0], pos, uv, color);
+
+	for (uint32_t rim = 0; rim < rim_count; ++rim) {
+		int lookup = first_index + (int)((float)rim / (float)segments * (float)value_count + 0.5f);
+		lookup = lookup & (MAX_CIRCLE_SEGMENTS - 1);
+
+		float px = UnitCircleCosValues[lookup] * radius_a;
+		float py = UnitcircleSinValues[lookup] * radius_b;
+
+		R_SetVertex2d(&vtx[1 + rim], pos + Vec3(px, py, 0), uv, color);
+	}
+
+	for (int segment = 1; segment <= segments; ++segment) {
+		uint32_t next = (uint32_t)segment < rim_count ? segment : 0;
+
+		idx[0] = index;
+		idx[1] = index + 1 + (R_Index2d)next;
+		idx[2] = index + (R_Index2d)segment;
+		idx += 3;
+	}
+}
+
+void R_DrawEllipse(R_Renderer2d *r2, Vec3 pos, float radius_a, float radius_b, Vec4 color, int segments) {
+	segments = Clamp(MIN_CIRCLE_SEGMENTS, MAX_CIRCLE_SEGMENTS - 1, segments);
+	segments = R_ArcSegments(r2, Max(radius_a, radius_b), 2.0f * PI, segments, R_MIN_LOD_CIRCLE_SEGMENTS);
+
+	// The last entry of the table repeats the first one
+	R_DrawEllipseFan(r2, pos, radius_a, radius_b, 0, MAX_CIRCLE_SEGMENTS - 1, segments, true, color);
+}
+
+void R_DrawEllipse(R_Renderer2d *r2, Vec2 pos, float radius_a, float radius_b, Vec4 color, int segments) {
+	R_DrawEllipse(r2, Vec3(pos, 0), radius_a, radius_b, color, segments);
+}
+
+void R_DrawCircle(R_Renderer2d *r2, Vec3 pos, float radius, Vec4 color, int segments) {
+	R_DrawEllipse(r2, pos, radius, radius, color, segments);
+}
+
+void R_DrawCircle(R_Renderer2d *r2, Vec2 pos, float radius, Vec4 color, int segments) {
+	R_DrawEllipse(r2, Vec3(pos, 0), radius, radius, color, segments);
+}
+
+static constexpr uint32_t R_BULK_CIRCLE_CHUNK = 1024;
+
+// Same fans as R_DrawEllipseFan, the radius and color steps are 0 when every circle has the first one
+static void R_DrawCircles(R_Renderer2d *r2, const Vec2 *positions, const float *radii, uint32_t radius_step, const Vec4 *colors, uint32_t color_step, uint32_t count, int segments) {
+	if (!count) return;
+
+	segments = Clamp(MIN_CIRCLE_SEGMENTS, MAX_CIRCLE_SEGMENTS - 1, segments);
+
+	R_Vertex2d center;
+	R_SetVertex2d(&center, Vec3(0), R_MapTexCoord(r2, Vec2(0)), colors[0]);
+
+	// Circles of a batch mostly share their radius, the level of detail is only computed when it changes
+	float lod_radius   = -1.0f;
+	int   lod_segments = 0;
+
+	uint16_t circle_segments[R_BULK_CIRCLE_CHUNK];
+
+	for (uint32_t first = 0; first < count;) {
+		uint32_t chunk  = 0;
+		uint32_t vertex = 0;
+		uint32_t index  = 0;
+
+		while (first + chunk < count && chunk < R_BULK_CIRCLE_CHUNK) {
+			float radius = radii[(first + chunk) * radius_step];
+
+			// Culled circles keep their entry with no segments
+			if (R_CulledCircle(r2, positions[first + chunk], Abs(radius))) {
+				circle_segments[chunk++] = 0;
+				continue;
+			}
+
+			if (radius != lod_radius) {
+				lod_radius   = radius;
+				lod_segments = R_ArcSegments(r2, radius, 2.0f * PI, segments, R_MIN_LOD_CIRCLE_SEGMENTS);
+			}
 
-	R_DrawQuad(r2, Vec3(a, pos.z), Vec3(b, pos.z), Vec3(c, pos.z), Vec3(d, pos.z), uv_a, uv_b, uv_c, uv_d, color);
-}
+			if ((uint64_t)vertex + lod_segments + 1 > R_MAX_VERTICES_PER_COMMAND)
+				break;
 
-void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, Vec2 uv_a, Vec2 uv_b, Vec2 uv_c, Vec2 uv_d, Vec4 color) {
-	R_DrawRectCenteredRotated(r2, Vec3(pos, 0), dim, angle, uv_a, uv_b, uv_c, uv_d, color);
-}
+			circle_segments[chunk++] = (uint16_t)lod_segments;
+			vertex += lod_segments + 1;
+			index  += 3 * lod_segments;
+		}
 
-void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, Vec4 color) {
-	R_DrawRectCenteredRotated(r2, pos, dim, angle, Vec2(0, 0), Vec2(0, 1), Vec2(1, 1), Vec2(1, 0), color);
-}
+		if (!vertex) {
+			first += chunk;
+			continue;
+		}
 
-void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, Vec4 color) {
-	R_DrawRectCenteredRotated(r2, Vec3(pos, 0), dim, angle, Vec2(0, 0), Vec2(0, 1), Vec2(1, 1), Vec2(1, 0), color);
-}
+		R_Index2d next_index = R_EnsurePrimitive(r2, vertex, index);
+		if (next_index == R_INVALID_INDEX2D)
+			return;
 
-void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color) {
-	auto uv_a = rect.min;
-	auto uv_b = Vec2(rect.min.x, rect.max.y);
-	auto uv_c = rect.max;
-	auto uv_d = Vec2(rect.max.x, rect.min.y);
-	R_DrawRectCenteredRotated(r2, pos, dim, angle, uv_a, uv_b, uv_c, uv_d, color);
-}
+		R_Vertex2d *vtx = r2->write_vertex;
+		R_Index2d * idx = r2->write_index;
 
-void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color) {
-	R_DrawRectCenteredRotated(r2, Vec3(pos, 0), dim, angle, rect, color);
-}
+		for (uint32_t circle = 0; circle < chunk; ++circle) {
+			uint32_t item   = first + circle;
+			Vec2     pos    = positions[item];
+			float    radius = radii[item * radius_step];
+			int      rims   = circle_segments[circle];
 
-void R_DrawEllipse(R_Renderer2d *r2, Vec3 pos, float radius_a, float radius_b, Vec4 color, int segments) {
-	segments = Clamp(MIN_CIRCLE_SEGMENTS, MAX_CIRCLE_SEGMENTS - 1, segments);
+			if (!rims)
+				continue;
 
-	float px = UnitCircleCosValues[0] * radius_a;
-	float py = UnitcircleSinValues[0] * radius_b;
+			if (color_step)
+				R_SetVertexColor2d(&center, colors[item]);
 
-	float npx, npy;
-	for (int index = 1; index <= segments; ++index) {
-		int lookup = (int)(((float)index / (float)segments) * (MAX_CIRCLE_SEGMENTS - 1) + 0.5f);
+			vtx[0] = center;
+			R_SetVertexPosition2d(&vtx[0], Vec3(pos, 0));
 
-		npx = UnitCircleCosValues[lookup] * radius_a;
-		npy = UnitcircleSinValues[lookup] * radius_b;
+			// The last entry of the table repeats the first one
+			for (int rim = 0; rim < rims; ++rim) {
+				int lookup = (int)((float)rim / (float)rims * (float)(MAX_CIRCLE_SEGMENTS - 1) + 0.5f);
+				lookup = lookup & (MAX_CIRCLE_SEGMENTS - 1);
 
-		R_DrawTriangle(r2, pos, pos + Vec3(npx, npy, 0), pos + Vec3(px, py, 0), color);
+				float px = UnitCircleCosValues[lookup] * radius;
+				float py = UnitcircleSinValues[lookup] * radius;
 
-		px = npx;
-		py = npy;
-	}
-}
+				vtx[1 + rim] = center;
+				R_SetVertexPosition2d(&vtx[1 + rim], Vec3(pos.x + px, pos.y + py, 0));
+			}
 
-void R_DrawEllipse(R_Renderer2d *r2, Vec2 pos, float radius_a, float radius_b, Vec4 color, int segments) {
-	R_DrawEllipse(r2, Vec3(pos, 0), radius_a, radius_b, color, segments);
+			for (int segment = 1; segment <= rims; ++segment) {
+				int next = segment < rims ? segment : 0;
+
+				idx[0] = next_index;
+				idx[1] = next_index + 1 + (R_Index2d)next;
+				idx[2] = next_index + (R_Index2d)segment;
+				idx += 3;
+			}
+
+			vtx        += rims + 1;
+			next_index += (R_Index2d)(rims + 1);
+		}
+
+		first += chunk;
+	}
 }
 
-void R_DrawCircle(R_Renderer2d *r2, Vec3 pos, float radius, Vec4 color, int segments) {
-	R_DrawEllipse(r2, pos, radius, radius, color, segments);
+void R_DrawCircles(R_Renderer2d *r2, const Vec2 *positions, const float *radii, const Vec4 *colors, uint32_t count, int segments) {
+	R_DrawCircles(r2, positions, radii, 1, colors, 1, count, segments);
 }
 
-void R_DrawCircle(R_Renderer2d *r2, Vec2 pos, float radius, Vec4 color, int segments) {
-	R_DrawEllipse(r2, Vec3(pos, 0), radius, radius, color, segments);
+void R_DrawCircles(R_Renderer2d *r2, const Vec2 *positions, float radius, Vec4 color, uint32_t count, int segments) {
+	R_DrawCircles(r2, positions, &radius, 0, &color, 0, count, segments);
 }
 
 void R_DrawPie(R_Renderer2d *r2, Vec3 pos, float radius_a, float radius_b, float theta_a, float theta_b, Vec4 color, int segments) {
@@ -984,23 +2772,9 @@ void R_DrawPie(R_Renderer2d *r2, Vec3 pos, float radius_a, float radius_b, float
 
 	auto value_count = last_index - first_index;
 	segments = Min(segments, value_count);
+	segments = R_ArcSegments(r2, Max(radius_a, radius_b), R_TableAngle(value_count), segments, 1);
 
-	float px = UnitCircleCosValues[first_index] * radius_a;
-	float py = UnitcircleSinValues[first_index] * radius_b;
-
-	float npx, npy;
-	for (int index = 1; index <= segments; ++index) {
-		auto lookup = first_index + (int)((float)index / (float)segments * (float)value_count + 0.5f);
-		lookup = lookup & (MAX_CIRCLE_SEGMENTS - 1);
-
-		npx = UnitCircleCosValues[lookup] * radius_a;
-		npy = UnitcircleSinValues[lookup] * radius_b;
-
-		R_DrawTriangle(r2, pos, pos + Vec3(npx, npy, 0), pos + Vec3(px, py, 0), color);
-
-		px = npx;
-		py = npy;
-	}
+	R_DrawEllipseFan(r2, pos, radius_a, radius_b, first_index, value_count, segments, false, color);
 }
 
 void R_DrawPie(R_Renderer2d *r2, Vec2 pos, float radius_a, float radius_b, float theta_a, float theta_b, Vec4 color, int segments) {
@@ -1026,29 +2800,50 @@ void R_DrawPiePart(R_Renderer2d *r2, Vec3 pos, float radius_a_min, float radius_
 
 	auto value_count = last_index - first_index;
 	segments = Min(segments, value_count);
+	segments = R_ArcSegments(r2, Max(radius_a_max, radius_b_max), R_TableAngle(value_count), segments, 1);
 
-	float min_px = UnitCircleCosValues[first_index] * radius_a_min;
-	float min_py = UnitcircleSinValues[first_index] * radius_b_min;
-	float max_px = UnitCircleCosValues[first_index] * radius_a_max;
-	float max_py = UnitcircleSinValues[first_index] * radius_b_max;
+	if (segments <= 0) return;
 
-	float min_npx, min_npy;
-	float max_npx, max_npy;
-	for (int index = 1; index <= segments; ++index) {
-		auto lookup = first_index + (int)((float)index / (float)segments * (float)value_count + 0.5f);
+	Vec2 radius = Vec2(Max(Abs(radius_a_min), Abs(radius_a_max)), Max(Abs(radius_b_min), Abs(radius_b_max)));
+	if (R_Culled(r2, pos._0.xy - radius, pos._0.xy + radius))
+		return;
+
+	// Inner and outer rim points alternate, each segment is a quad between two consecutive pairs
+	R_Index2d index = R_EnsurePrimitive(r2, 2 * (segments + 1), 6 * segments);
+	if (index == R_INVALID_INDEX2D)
+		return;
+
+	R_Vertex2d *vtx = r2->write_vertex;
+	R_Index2d * idx = r2->write_index;
+
+	// Every segment keeps the corner tex coords of R_DrawQuad: v is 0 on the inner rim and 1 on the outer rim,
+	// u alternates between the rims so it goes from 1 to 0 across a segment, mirrored on every other segment
+	Vec2 uv_min[2] = { R_MapTexCoord(r2, Vec2(1, 0)), R_MapTexCoord(r2, Vec2(0, 0)) };
+	Vec2 uv_max[2] = { R_MapTexCoord(r2, Vec2(1, 1)), R_MapTexCoord(r2, Vec2(0, 1)) };
+
+	for (int rim = 0; rim <= segments; ++rim) {
+		int lookup = first_index + (int)((float)rim / (float)segments * (float)value_count + 0.5f);
 		lookup = lookup & (MAX_CIRCLE_SEGMENTS - 1);
 
-		min_npx = UnitCircleCosValues[lookup] * radius_a_min;
-		min_npy = UnitcircleSinValues[lookup] * radius_b_min;
-		max_npx = UnitCircleCosValues[lookup] * radius_a_max;
-		max_npy = UnitcircleSinValues[lookup] * radius_b_max;
+		float cos_value = UnitCircleCosValues[lookup];
+		float sin_value = UnitcircleSinValues[lookup];
 
-		R_DrawQuad(r2, pos + Vec3(min_npx, min_npy, 0), pos + Vec3(max_npx, max_npy, 0), pos + Vec3(max_px, max_py, 0), pos + Vec3(min_px, min_py, 0), color);
+		R_SetVertex2d(&vtx[0], pos + Vec3(cos_value * radius_a_min, sin_value * radius_b_min, 0), uv_min[rim & 1], color);
+		R_SetVertex2d(&vtx[1], pos + Vec3(cos_value * radius_a_max, sin_value * radius_b_max, 0), uv_max[rim & 1], color);
+		vtx += 2;
+	}
 
-		min_px = min_npx;
-		min_py = min_npy;
-		max_px = max_npx;
-		max_py = max_npy;
+	for (int segment = 1; segment <= segments; ++segment) {
+		R_Index2d prev = index + (R_Index2d)(2 * (segment - 1));
+		R_Index2d next = index + (R_Index2d)(2 * segment);
+
+		idx[0] = next + 0;
+		idx[1] = next + 1;
+		idx[2] = prev + 1;
+		idx[3] = next + 0;
+		idx[4] = prev + 1;
+		idx[5] = prev + 0;
+		idx += 6;
 	}
 }
 
@@ -1087,6 +2882,56 @@ void R_DrawLine(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec4 color) {
 	R_DrawLine(r2, Vec3(a, 0), Vec3(b, 0), color);
 }
 
+void R_DrawLines(R_Renderer2d *r2, const Vec2 *points, uint32_t count, Vec4 color) {
+	uint32_t segments = count / 2;
+
+	float thickness = r2->thickness * 0.5f;
+	Vec2  uv        = R_MapTexCoord(r2, Vec2(0));
+
+	// Every segment is a quad, the batch is only split where the command runs out of indices
+	uint32_t chunk_segments = (uint32_t)Min((uint64_t)segments, (uint64_t)R_MAX_VERTICES_PER_COMMAND / 4);
+
+	for (uint32_t first = 0; first < segments; first += chunk_segments) {
+		uint32_t chunk = Min(chunk_segments, segments - first);
+
+		R_Index2d index = R_EnsurePrimitive(r2, 4 * chunk, 6 * chunk);
+		if (index == R_INVALID_INDEX2D)
+			return;
+
+		R_Vertex2d *vtx = r2->write_vertex;
+		R_Index2d * idx = r2->write_index;
+
+		for (uint32_t segment = first; segment < first + chunk; ++segment) {
+			Vec2 a = points[2 * segment + 0];
+			Vec2 b = points[2 * segment + 1];
+
+			if (IsNull(b - a) || R_CulledPoints(r2, &points[2 * segment], 2, thickness))
+				continue;
+
+			Vec2 normal = thickness * NormalizeZ(Vec2(a.y - b.y, b.x - a.x));
+
+			R_SetVertex2d(&vtx[0], Vec3(a + normal, 0), uv, color);
+			R_SetVertex2d(&vtx[1], Vec3(b + normal, 0), uv, color);
+			R_SetVertex2d(&vtx[2], Vec3(b - normal, 0), uv, color);
+			R_SetVertex2d(&vtx[3], Vec3(a - normal, 0), uv, color);
+
+			idx[0] = index + 0;
+			idx[1] = index + 1;
+			idx[2] = index + 2;
+			idx[3] = index + 0;
+			idx[4] = index + 2;
+			idx[5] = index + 3;
+
+			vtx   += 4;
+			idx   += 6;
+			index += 4;
+		}
+
+		uint32_t written = (uint32_t)(vtx - r2->write_vertex) / 4;
+		R_TrimPrimitive(r2, 4 * (chunk - written), 6 * (chunk - written));
+	}
+}
+
 void R_PathTo(R_Renderer2d *r2, Vec2 a) {
 	if (r2->path.count) {
 		if (!IsNull(Last(r2->path) - a))
@@ -1118,6 +2963,7 @@ void R_ArcTo(R_Renderer2d *r2, Vec2 position, float radius_a, float radius_b, fl
 
 	auto value_count = last_index - first_index;
 	segments = Min(segments, value_count);
+	segments = R_ArcSegments(r2, Max(radius_a, radius_b), R_TableAngle(value_count), segments, 1);
 
 	float npx, npy;
 	for (int index = 0; index <= segments; ++index) {
@@ -1130,199 +2976,320 @@ void R_ArcTo(R_Renderer2d *r2, Vec2 position, float radius_a, float radius_b, fl
 }
 
 void R_BezierQuadraticTo(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec2 c, int segments) {
+	segments = R_BezierSegments(r2, Length(a - 2.0f * b + c), 0.25f, segments);
+
 	ptrdiff_t index = r2->path.count;
 	if (Resize(&r2->path, r2->allocator, r2->path.count + segments + 1))
 		BuildBezierQuadratic(a, b, c, &r2->path[index], segments);
 }
 
 void R_BezierCubicTo(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec2 c, Vec2 d, int segments) {
+	segments = R_BezierSegments(r2, Max(Length(a - 2.0f * b + c), Length(b - 2.0f * c + d)), 0.75f, segments);
+
 	ptrdiff_t index = r2->path.count;
 	if (Resize(&r2->path, r2->allocator, r2->path.count + segments + 1))
 		BuildBezierCubic(a, b, c, d, &r2->path[index], segments);
 }
 
-static inline Vec2 R_IntersectRay(Vec2 p1, Vec2 q1, Vec2 p2, Vec2 q2) {
-	Vec2 d1 = p1 - q1;
-	Vec2 d2 = p2 - q2;
+// Strokes are emitted in chunks of points, so the reservation of one primitive stays bounded for any path length
+static constexpr int R_STROKE_CHUNK_POINTS    = 1024;
+static constexpr int R_STROKE_ROUND_SEGMENTS  = 16; // upper limit for half a circle of round joins and caps
+
+struct R_Stroker2d {
+	R_Vertex2d *vertex;
+	R_Index2d * index;
+	R_Index2d   next_index;
+	Vec2        tex_coord;
+	Vec4        color;
+	float       z;
+};
+
+// Ends of the incoming segment and starts of the outgoing segment at a point of the path, 0 is the left side
+// Mitered points share both vertices, other joins share the inner one and fill the outer side from the inner vertex
+struct R_Stroke_Join2d {
+	Vec2 end[2];
+	Vec2 start[2];
+	int  outer;    // -1 when mitered
+	int  segments; // arc segments of round joins
+	Vec2 rotation; // cos and sin of one arc segment
+};
+
+static inline R_Index2d R_StrokeVertex(R_Stroker2d *stroker, Vec2 position) {
+	R_SetVertex2d(stroker->vertex++, Vec3(position, stroker->z), stroker->tex_coord, stroker->color);
+	return stroker->next_index++;
+}
+
+static inline void R_StrokeTriangle(R_Stroker2d *stroker, R_Index2d a, R_Index2d b, R_Index2d c) {
+	stroker->index[0] = a;
+	stroker->index[1] = b;
+	stroker->index[2] = c;
+	stroker->index += 3;
+}
+
+static inline void R_StrokeSegment(R_Stroker2d *stroker, R_Index2d *pair, R_Index2d left, R_Index2d right) {
+	R_StrokeTriangle(stroker, pair[0], pair[1], right);
+	R_StrokeTriangle(stroker, right, left, pair[0]);
+	pair[0] = left;
+	pair[1] = right;
+}
+
+static inline Vec2 R_StrokeRotate(Vec2 v, Vec2 rotation) {
+	return Vec2(v.x * rotation.x - v.y * rotation.y, v.x * rotation.y + v.y * rotation.x);
+}
+
+// Fan from pivot through the points of the arc from 'from' to 'to' around center, both ends are already emitted
+static void R_StrokeArc(R_Stroker2d *stroker, R_Index2d pivot, R_Index2d from, R_Index2d to, Vec2 center, Vec2 offset, Vec2 rotation, int segments) {
+	R_Index2d prev = from;
+	for (int index = 1; index < segments; ++index) {
+		offset = R_StrokeRotate(offset, rotation);
+		R_Index2d next = R_StrokeVertex(stroker, center + offset);
+		if (prev != pivot)
+			R_StrokeTriangle(stroker, pivot, prev, next);
+		prev = next;
+	}
+	if (prev != pivot)
+		R_StrokeTriangle(stroker, pivot, prev, to);
+}
+
+static R_Stroke_Join2d R_StrokeJoin(R_Renderer2d *r2, Vec2 point, Vec2 dir_a, Vec2 dir_b, float thickness, int round_segments) {
+	Vec2 norm_a = Vec2(-dir_a.y, dir_a.x);
+	Vec2 norm_b = Vec2(-dir_b.y, dir_b.x);
+
+	float dot   = dir_a.x * dir_b.x + dir_a.y * dir_b.y;
+	float cross = dir_a.x * dir_b.y - dir_a.y * dir_b.x;
+
+	// The miter is (norm_a + norm_b) / (1 + dot), its length in half thicknesses is sqrt(2 / (1 + dot))
+	float limit   = r2->miter_limit;
+	float divisor = Max(1.0f + dot, 2.0f / (limit * limit));
+	Vec2  miter   = (norm_a + norm_b) * (thickness / divisor);
+
+	R_Stroke_Join2d join;
+	join.segments = 0;
+	join.rotation = Vec2(1.0f, 0.0f);
+
+	if (r2->join == R_LINE_JOIN_MITER && 1.0f + dot >= 2.0f / (limit * limit)) {
+		join.outer    = -1;
+		join.end[0]   = join.start[0] = point + miter;
+		join.end[1]   = join.start[1] = point - miter;
+		return join;
+	}
+
+	// Left turns have the outer side on the right
+	int   outer = cross > 0.0f ? 1 : 0;
+	float side  = outer ? -1.0f : 1.0f;
+	int   inner = 1 - outer;
 
-	float d = d1.x * d2.y - d1.y * d2.x;
-	float n2 = -d1.x * (p1.y - p2.y) + d1.y * (p1.x - p2.x);
+	join.outer        = outer;
+	join.end[inner]   = join.start[inner] = point - side * miter;
+	join.end[outer]   = point + side * thickness * norm_a;
+	join.start[outer] = point + side * thickness * norm_b;
 
-	if (d != 0) {
-		float u = n2 / d;
-		return p2 - u * d2;
+	if (r2->join == R_LINE_JOIN_ROUND) {
+		// Round segments are already reduced for half a circle on screen
+		float angle    = ArcTan2(Abs(cross), dot);
+		int   segments = Max(1, (int)Ceil((float)round_segments * angle / PI));
+
+		float step    = (cross > 0.0f ? angle : -angle) / (float)segments;
+		join.segments = segments;
+		join.rotation = Vec2(Cos(step), Sin(step));
+	} else {
+		join.segments = 1;
 	}
 
-	return p1;
+	return join;
 }
 
-static inline void R_CalculateExtrudePoint(Vec2 point, Vec2 norm_a, Vec2 norm_b, float thickness, Vec2 *out, Vec2 *in) {
-	Vec2 perp_a = Vec2(norm_a.y, -norm_a.x);
-	Vec2 perp_b = Vec2(norm_b.y, -norm_b.x);
+// Closes the segment ending at the join, then fills the outer side of the join
+static void R_StrokeJoinEnd(R_Stroker2d *stroker, R_Index2d *pair, const R_Stroke_Join2d &join, Vec2 point) {
+	if (join.outer < 0) {
+		R_Index2d left  = R_StrokeVertex(stroker, join.end[0]);
+		R_Index2d right = R_StrokeVertex(stroker, join.end[1]);
+		R_StrokeSegment(stroker, pair, left, right);
+		return;
+	}
 
-	Vec2 p1, q1, p2, q2;
+	int outer = join.outer;
+	int inner = 1 - outer;
 
-	norm_a *= thickness;
-	norm_b *= thickness;
+	R_Index2d ends[2];
+	ends[inner] = R_StrokeVertex(stroker, join.end[inner]);
+	ends[outer] = R_StrokeVertex(stroker, join.end[outer]);
+	R_StrokeSegment(stroker, pair, ends[0], ends[1]);
 
-	p1 = point + norm_a;
-	q1 = p1 + perp_a;
-	p2 = point + norm_b;
-	q2 = p2 + perp_b;
-	*out = R_IntersectRay(p1, q1, p2, q2);
+	R_Index2d start = R_StrokeVertex(stroker, join.start[outer]);
+	R_StrokeArc(stroker, ends[inner], ends[outer], start, point, join.end[outer] - point, join.rotation, join.segments);
 
-	p1 = point - norm_a;
-	q1 = p1 + perp_a;
-	p2 = point - norm_b;
-	q2 = p2 + perp_b;
-	*in = R_IntersectRay(p1, q1, p2, q2);
+	pair[outer] = start;
 }
 
 void R_DrawPathStroked(R_Renderer2d *r2, Vec4 color, bool closed, float z) {
-	if (r2->path.count < 2) {
-		Reset(&r2->path);
-		return;
+	Vec2 *points = r2->path.data;
+	int   count  = (int)r2->path.count;
+
+	r2->mark.path = Max(r2->mark.path, r2->path.count);
+
+	// Paths built directly by the curve procedures may repeat points, zero length segments have no direction
+	if (count) {
+		int unique = 1;
+		for (int i = 1; i < count; ++i) {
+			if (!IsNull(points[i] - points[unique - 1]))
+				points[unique++] = points[i];
+		}
+		if (closed && unique > 1 && IsNull(points[unique - 1] - points[0]))
+			unique -= 1;
+		count = unique;
 	}
 
-	if (r2->path.count == 2 && closed) {
+	// Miters reach at most miter limit half thicknesses away from the path, square caps half a diagonal
+	float margin = r2->thickness * 0.5f * Max(r2->miter_limit, 1.5f);
+
+	if (count < 2 || (count == 2 && closed) || R_CulledPoints(r2, points, (uint32_t)count, margin)) {
 		Reset(&r2->path);
 		return;
 	}
 
-	int points_count = (int)r2->path.count;
-	int vertex_count = points_count * 2;
-	int index_count = points_count * 6;
+	float thickness = r2->thickness * 0.5f;
 
-	if (!closed) {
-		index_count -= 6;
-	}
+	int round_segments = R_ArcSegments(r2, thickness, PI, R_STROKE_ROUND_SEGMENTS, 1);
+	int join_segments  = r2->join == R_LINE_JOIN_ROUND ? round_segments : 1;
+	int cap_segments   = (!closed && r2->cap == R_LINE_CAP_ROUND) ? round_segments : 0;
 
-	R_Index2d next_index = R_EnsurePrimitive(r2, vertex_count, index_count);
+	// Worst case of each point is a beveled or round join, the caps are reserved with every chunk
+	uint32_t point_vertex = (uint32_t)join_segments + 2;
+	uint32_t point_index  = 6 + 3 * (uint32_t)join_segments;
+	uint32_t cap_vertex   = 2 + 2 * (uint32_t)cap_segments;
+	uint32_t cap_index    = 6 * (uint32_t)cap_segments;
 
-	if (next_index != -1) {
-		R_Index2d first_index = next_index;
+	int chunk_points = (int)Min((uint64_t)R_STROKE_CHUNK_POINTS, (R_MAX_VERTICES_PER_COMMAND - cap_vertex - 2) / point_vertex);
 
-		R_Index2d *index = r2->write_index;
+	R_Stroker2d stroker;
+	stroker.tex_coord = R_MapTexCoord(r2, Vec2(0));
+	stroker.color     = color;
+	stroker.z         = z;
 
-		for (int i = 0; i < points_count - 1; ++i) {
-			index[0] = next_index + 0;
-			index[1] = next_index + 1;
-			index[2] = next_index + 3;
-			index[3] = next_index + 3;
-			index[4] = next_index + 2;
-			index[5] = next_index + 0;
+	int  segment_count = closed ? count : count - 1;
+	Vec2 dir           = NormalizeZ(points[1] - points[0]);
 
-			index += 6;
-			next_index += 2;
-		}
+	// Starts of the first segment
+	R_Stroke_Join2d join;
+	if (closed) {
+		Vec2 dir_last = NormalizeZ(points[0] - points[count - 1]);
+		join = R_StrokeJoin(r2, points[0], dir_last, dir, thickness, round_segments);
+	} else {
+		Vec2 norm  = Vec2(-dir.y, dir.x) * thickness;
+		Vec2 point = r2->cap == R_LINE_CAP_SQUARE ? points[0] - dir * thickness : points[0];
+		join.start[0] = point + norm;
+		join.start[1] = point - norm;
+	}
 
-		if (closed) {
-			index[0] = next_index + 0;
-			index[1] = next_index + 1;
-			index[2] = first_index + 1;
-			index[3] = first_index + 1;
-			index[4] = first_index + 0;
-			index[5] = next_index + 0;
-		}
+	R_Index2d pair[2];
 
-		Vec2 *points = r2->path.data;
+	for (int segment = 0; segment < segment_count;) {
+		int chunk = Min(chunk_points, segment_count - segment);
 
-		// Normal Calculation for closed polygon
-		Vec2 *normals = (Vec2 *)alloca(sizeof(Vec2) * points_count);
-		{
-			int i = 0;
-			for (; i < points_count - 1; ++i) {
-				Vec2 norm = NormalizeZ(points[i + 1] - points[i]);
-				normals[i].x = -norm.y;
-				normals[i].y = norm.x;
-			}
-			Vec2 norm = NormalizeZ(points[0] - points[i]);
-			normals[i].x = -norm.y;
-			normals[i].y = norm.x;
-		}
+		uint32_t vertex_count = 2 + chunk * point_vertex + cap_vertex;
+		uint32_t index_count  = chunk * point_index + cap_index;
 
-		float thickness = r2->thickness * 0.5f;
+		stroker.next_index = R_EnsurePrimitive(r2, vertex_count, index_count);
+		if (stroker.next_index == R_INVALID_INDEX2D)
+			break;
 
-		R_Vertex2d *vertex = r2->write_vertex;
+		stroker.vertex = r2->write_vertex;
+		stroker.index  = r2->write_index;
 
-		Vec2 out_point;
-		Vec2 in_point;
+		R_Index2d first_index = stroker.next_index;
 
-		if (closed) {
-			Vec2 norm_a = normals[points_count - 1];
-			Vec2 norm_b = normals[0];
-			R_CalculateExtrudePoint(points[0], norm_a, norm_b, thickness, &out_point, &in_point);
-		} else {
-			Vec2 ext = normals[0] * thickness;
-			out_point = points[0] + ext;
-			in_point = points[0] - ext;
+		pair[0] = R_StrokeVertex(&stroker, join.start[0]);
+		pair[1] = R_StrokeVertex(&stroker, join.start[1]);
+
+		if (segment == 0 && cap_segments) {
+			Vec2 offset = join.start[0] - points[0];
+			R_StrokeArc(&stroker, pair[0], pair[0], pair[1], points[0], offset, Vec2(Cos(PI / cap_segments), Sin(PI / cap_segments)), cap_segments);
 		}
 
-		vertex[0].position = Vec3(out_point, z);
-		vertex[0].color = color;
-		vertex[0].tex_coord = Vec2(0);
+		for (int last = segment + chunk; segment < last; ++segment) {
+			int  next  = segment + 1 < count ? segment + 1 : 0;
+			Vec2 point = points[next];
+
+			if (segment + 1 < segment_count) {
+				Vec2 dir_next = NormalizeZ(points[next + 1 < count ? next + 1 : 0] - point);
+				join = R_StrokeJoin(r2, point, dir, dir_next, thickness, round_segments);
+				R_StrokeJoinEnd(&stroker, pair, join, point);
+				dir = dir_next;
+			} else if (closed) {
+				Vec2 dir_first = NormalizeZ(points[1] - points[0]);
+				join = R_StrokeJoin(r2, point, dir, dir_first, thickness, round_segments);
+				R_StrokeJoinEnd(&stroker, pair, join, point);
+			} else {
+				Vec2 norm = Vec2(-dir.y, dir.x) * thickness;
+				if (r2->cap == R_LINE_CAP_SQUARE)
+					point += dir * thickness;
+
+				R_Index2d left  = R_StrokeVertex(&stroker, point + norm);
+				R_Index2d right = R_StrokeVertex(&stroker, point - norm);
+				R_StrokeSegment(&stroker, pair, left, right);
+
+				if (cap_segments) {
+					Vec2 rotation = Vec2(Cos(PI / cap_segments), Sin(PI / cap_segments));
+					R_StrokeArc(&stroker, right, right, left, point, -norm, rotation, cap_segments);
+				}
+			}
+		}
 
-		vertex[1].position = Vec3(in_point, z);
-		vertex[1].color = color;
-		vertex[1].tex_coord = Vec2(0);
-		vertex += 2;
+		uint32_t used_vertex = (uint32_t)(stroker.next_index - first_index);
+		uint32_t used_index  = (uint32_t)(stroker.index - r2->write_index);
+		R_TrimPrimitive(r2, vertex_count - used_vertex, index_count - used_index);
+	}
 
-		for (int i = 1; i < points_count - 1; ++i) {
-			Vec2 norm_a = normals[i - 1];
-			Vec2 norm_b = normals[i];
-			R_CalculateExtrudePoint(points[i], norm_a, norm_b, thickness, &out_point, &in_point);
+	Reset(&r2->path);
+}
 
-			vertex[0].position = Vec3(out_point, z);
-			vertex[0].color = color;
-			vertex[0].tex_coord = Vec2(0);
+// Convex polygons are drawn as a fan over shared vertices, others are triangulated, both in one indexed batch
+static void R_DrawPolygonFilled(R_Renderer2d *r2, const Vec2 *points, uint32_t count, float z, Vec4 color) {
+	if (count < 3 || R_CulledPoints(r2, points, count, 0.0f)) return;
 
-			vertex[1].position = Vec3(in_point, z);
-			vertex[1].color = color;
-			vertex[1].tex_coord = Vec2(0);
-			vertex += 2;
-		}
+	const uint32_t *triangles = nullptr;
+	uint32_t index_count      = 3 * (count - 2);
 
-		if (closed) {
-			Vec2 norm_a = normals[points_count - 2];
-			Vec2 norm_b = normals[points_count - 1];
-			R_CalculateExtrudePoint(points[points_count - 1], norm_a, norm_b, thickness, &out_point, &in_point);
+	if (!IsConvexPolygon(points, count)) {
+		if (TriangulatePolygon(&r2->triangulator, points, count)) {
+			triangles   = r2->triangulator.indices.data;
+			index_count = (uint32_t)r2->triangulator.indices.count;
 		} else {
-			Vec2 ext = normals[points_count - 2] * thickness;
-			out_point = points[points_count - 1] + ext;
-			in_point = points[points_count - 1] - ext;
+			LogWarning("Renderer2d: Failed to triangulate polygon with % points. Drawing it as a fan.", count);
 		}
+	}
 
-		vertex[0].position = Vec3(out_point, z);
-		vertex[0].color = color;
-		vertex[0].tex_coord = Vec2(0);
+	if (!index_count) return;
 
-		vertex[1].position = Vec3(in_point, z);
-		vertex[1].color = color;
-		vertex[1].tex_coord = Vec2(0);
+	R_Index2d next_index = R_EnsurePrimitive(r2, count, index_count);
+	if (next_index == R_INVALID_INDEX2D) return;
 
-	#if defined(KR_RENDER2D_ENABLE_DEBUG_INFO)
-		r2->mark.path = Max(r2->mark.path, r2->path.count);
-	#endif
+	R_Vertex2d *vertex = r2->write_vertex;
+	Vec2 tex_coord     = R_MapTexCoord(r2, Vec2(0));
 
-		Reset(&r2->path);
+	for (uint32_t point = 0; point < count; ++point)
+		R_SetVertex2d(&vertex[point], Vec3(points[point], z), tex_coord, color);
+
+	R_Index2d *index = r2->write_index;
+
+	if (triangles) {
+		for (uint32_t i = 0; i < index_count; ++i)
+			index[i] = next_index + (R_Index2d)triangles[i];
+	} else {
+		for (uint32_t point = 1; point + 1 < count; ++point) {
+			index[0] = next_index;
+			index[1] = next_index + point;
+			index[2] = next_index + point + 1;
+			index += 3;
+		}
 	}
 }
 
 void R_DrawPathFilled(R_Renderer2d *r2, Vec4 color, float z) {
-	if (r2->path.count < 3) {
-		Reset(&r2->path);
-		return;
-	}
-
-	Vec2 *path = r2->path.data;
-	int triangle_count = (int)r2->path.count - 2;
-	for (int ti = 0; ti < triangle_count; ++ti) {
-		R_DrawTriangle(r2, Vec3(path[0], z), Vec3(path[ti + 1], z), Vec3(path[ti + 2], z), color);
-	}
+	R_DrawPolygonFilled(r2, r2->path.data, (uint32_t)r2->path.count, z, color);
 
-#if defined(KR_RENDER2D_ENABLE_DEBUG_INFO)
 	r2->mark.path = Max(r2->mark.path, r2->path.count);
-#endif
 
 	Reset(&r2->path);
 }
@@ -1339,10 +3306,7 @@ void R_DrawBezierCubic(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec2 c, Vec2 d, Vec4 co
 
 void R_DrawPolygon(R_Renderer2d *r2, const Vec2 *vertices, uint32_t count, float z, Vec4 color) {
 	Assert(count >= 3);
-	uint32_t triangle_count = count - 2;
-	for (uint32_t triangle_index = 0; triangle_index < triangle_count; ++triangle_index) {
-		R_DrawTriangle(r2, Vec3(vertices[0], z), Vec3(vertices[triangle_index + 1], z), Vec3(vertices[triangle_index + 2], z), color);
-	}
+	R_DrawPolygonFilled(r2, vertices, count, z, color);
 }
 
 void R_DrawPolygon(R_Renderer2d *r2, const Vec2 *vertices, uint32_t count, Vec4 color) {
@@ -1412,7 +3376,13 @@ void R_DrawRectCenteredOutline(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color)
 }
 
 void R_DrawEllipseOutline(R_Renderer2d *r2, Vec3 position, float radius_a, float radius_b, Vec4 color, int segments) {
+	Vec2 radius = Vec2(Abs(radius_a), Abs(radius_b)) + Vec2(0.5f * r2->thickness);
+	if (R_Culled(r2, position._0.xy - radius, position._0.xy + radius))
+		return;
+
 	segments = Clamp(MIN_CIRCLE_SEGMENTS, MAX_CIRCLE_SEGMENTS - 1, segments);
+	segments = R_ArcSegments(r2, Max(radius_a, radius_b), 2.0f * PI, segments, R_MIN_LOD_CIRCLE_SEGMENTS);
+
 	float npx, npy;
 	for (int index = 0; index < segments; ++index) {
 		int lookup = (int)(((float)index / (float)segments) * (MAX_CIRCLE_SEGMENTS - 1) + 0.5f);
@@ -1592,7 +3562,7 @@ static int R_UTF8ToCodepoint(const uint8_t *start, const uint8_t *end, uint32_t
 	}
 
 	if ((first & 0xf0) == 0xe0) {
-		if (start + 2 <= end) {
+		if (start + 2 < end) {
 			*codepoint = ((int)(start[0] & 0x0f) << 12);
 			*codepoint |= ((int)(start[1] & 0x3f) << 6);
 			*codepoint |= (int)(start[2] & 0x3f);
@@ -1621,59 +3591,311 @@ static int R_UTF8ToCodepoint(const uint8_t *start, const uint8_t *end, uint32_t
 	return 1;
 }
 
+static constexpr uint32_t R_TEXT_GLYPH_CHUNK = 256;
+
+// Decodes until the codepoints are full or the end is reached, and advances start past the decoded bytes
+// Runs of 16 ASCII bytes are widened to codepoints at once, other bytes are decoded one codepoint at a time
+// up to and including the next multi-byte sequence before the next run is tried
+static uint32_t R_UTF8ToCodepoints(uint8_t **start, uint8_t *end, uint32_t *codepoints, uint32_t capacity) {
+	uint8_t *cursor = *start;
+	uint32_t count  = 0;
+
+	while (cursor < end && count < capacity) {
+#if defined(R_TEXT_SSE2)
+		if (end - cursor >= 16 && capacity - count >= 16) {
+			__m128i bytes = _mm_loadu_si128((const __m128i *)cursor);
+
+			if (_mm_movemask_epi8(bytes) == 0) {
+				__m128i zero = _mm_setzero_si128();
+				__m128i lo   = _mm_unpacklo_epi8(bytes, zero);
+				__m128i hi   = _mm_unpackhi_epi8(bytes, zero);
+
+				_mm_storeu_si128((__m128i *)(codepoints + count + 0), _mm_unpacklo_epi16(lo, zero));
+				_mm_storeu_si128((__m128i *)(codepoints + count + 4), _mm_unpackhi_epi16(lo, zero));
+				_mm_storeu_si128((__m128i *)(codepoints + count + 8), _mm_unpacklo_epi16(hi, zero));
+				_mm_storeu_si128((__m128i *)(codepoints + count + 12), _mm_unpackhi_epi16(hi, zero));
+
+				cursor += 16;
+				count  += 16;
+				continue;
+			}
+		}
+#endif
+
+		while (cursor < end && count < capacity && *cursor <= 0x7f)
+			codepoints[count++] = *cursor++;
+
+		if (cursor < end && count < capacity)
+			cursor += R_UTF8ToCodepoint(cursor, end, &codepoints[count++]);
+	}
+
+	*start = cursor;
+
+	return count;
+}
+
+// Glyphs of the next chunk of text, R_TEXT_GLYPH_CHUNK at most
+static uint32_t R_NextGlyphs(R_Font *font, uint8_t **start, uint8_t *end, R_Font_Glyph **glyphs) {
+	uint32_t codepoints[R_TEXT_GLYPH_CHUNK];
+	uint32_t count = R_UTF8ToCodepoints(start, end, codepoints, R_TEXT_GLYPH_CHUNK);
+	R_FontFindGlyphs(font, codepoints, count, glyphs);
+	return count;
+}
+
+// Same corners and tex coords as R_DrawRect at each glyph, the pen is moved past the glyphs
+static void R_WriteGlyphQuads(R_Renderer2d *r2, R_Font_Glyph *const *glyphs, uint32_t count, float factor, Vec4 color, Vec3 *pen, R_Vertex2d *vtx) {
+	for (uint32_t position = 0; position < count; ++position) {
+		const R_Font_Glyph *glyph = glyphs[position];
+
+		Vec2 a = pen->_0.xy + glyph->offset * factor;
+		Vec2 c = a + glyph->dimension * factor;
+
+		R_SetVertex2d(&vtx[0], Vec3(a.x, a.y, pen->z), R_MapTexCoord(r2, glyph->uv.min), color);
+		R_SetVertex2d(&vtx[1], Vec3(a.x, c.y, pen->z), R_MapTexCoord(r2, Vec2(glyph->uv.min.x, glyph->uv.max.y)), color);
+		R_SetVertex2d(&vtx[2], Vec3(c.x, c.y, pen->z), R_MapTexCoord(r2, glyph->uv.max), color);
+		R_SetVertex2d(&vtx[3], Vec3(c.x, a.y, pen->z), R_MapTexCoord(r2, Vec2(glyph->uv.max.x, glyph->uv.min.y)), color);
+
+		vtx    += 4;
+		pen->x += glyph->advance * factor;
+	}
+}
+
+// Two triangles per quad of four vertices, in the order of R_DrawQuad
+static void R_WriteQuadIndices(R_Index2d *idx, R_Index2d index, uint32_t quads) {
+	for (uint32_t quad = 0; quad < quads; ++quad) {
+		idx[0] = index + 0;
+		idx[1] = index + 1;
+		idx[2] = index + 2;
+		idx[3] = index + 0;
+		idx[4] = index + 2;
+		idx[5] = index + 3;
+
+		idx   += 6;
+		index += 4;
+	}
+}
+
 float R_PrepareText(R_Renderer2d *r2, String text, R_Font *font, float factor) {
 	float width = 0;
 
 	uint8_t *start = text.data;
 	uint8_t *end = text.data + text.count;
 
-	uint32_t codepoint;
+	R_Font_Glyph *glyphs[R_TEXT_GLYPH_CHUNK];
 
 	for (; start < end; ) {
-		start += R_UTF8ToCodepoint(start, end, &codepoint);
+		uint32_t count = R_NextGlyphs(font, &start, end, glyphs);
 
-		R_Font_Glyph *glyph = R_FontFindGlyph(font, codepoint);
-		width += glyph->advance * factor;
+		for (uint32_t position = 0; position < count; ++position)
+			width += glyphs[position]->advance * factor;
 	}
 
 	return width;
 }
 
-void R_DrawText(R_Renderer2d *r2, Vec3 pos, Vec4 color, String text, R_Font *font, float factor) {
-	R_PushTexture(r2, font->texture);
+// Writes the quads of R_DrawText at the origin with white color, returns the number of vertices written
+// Vertices must have room for four per byte of text
+static uint32_t R_LayoutTextRun(R_Renderer2d *r2, String text, R_Font *font, float factor, R_Vertex2d *vtx, R_Rect *bounds) {
+	Vec3 pen = Vec3(0.0f);
 
-	Vec3 render_pos;
-	Vec2 render_dim;
+	uint8_t *start = text.data;
+	uint8_t *end   = text.data + text.count;
 
-	float start_x = pos.x;
+	R_Font_Glyph *glyphs[R_TEXT_GLYPH_CHUNK];
+	uint32_t      written = 0;
+
+	for (;;) {
+		uint8_t *line_end = (uint8_t *)memchr(start, '\n', end - start);
+		if (!line_end) line_end = end;
+
+		while (start < line_end) {
+			uint32_t count = R_NextGlyphs(font, &start, line_end, glyphs);
+			R_WriteGlyphQuads(r2, glyphs, count, factor, Vec4(1.0f), &pen, vtx + written);
+			written += 4 * count;
+		}
+
+		if (line_end == end)
+			break;
+
+		start  = line_end + 1;
+		pen.x  = 0.0f;
+		pen.y -= (1 + font->height) * factor;
+	}
+
+	*bounds = R_Rect(0.0f, 0.0f, 0.0f, 0.0f);
+
+	for (uint32_t vertex = 0; vertex < written; vertex += 4) {
+		Vec2 a = R_VertexPosition(vtx[vertex + 0])._0.xy;
+		Vec2 c = R_VertexPosition(vtx[vertex + 2])._0.xy;
+
+		if (vertex) {
+			bounds->min = Vec2(Min(bounds->min.x, a.x), Min(bounds->min.y, a.y));
+			bounds->max = Vec2(Max(bounds->max.x, c.x), Max(bounds->max.y, c.y));
+		} else {
+			*bounds = R_Rect(a.x, a.y, c.x, c.y);
+		}
+	}
+
+	return written;
+}
+
+// Finds the laid out text or lays it out into the cache, null when the cache is full
+// Expects the font texture to be the current texture, so the tex coords are mapped into the atlas
+static R_Text_Run2d *R_TextRun(R_Renderer2d *r2, String text, R_Font *font, float factor) {
+	R_Text_Cache2d *cache = &r2->text_cache;
+
+	uint64_t      hash = R_HashTextRun(text, font, factor);
+	R_Text_Run2d *run  = R_FindTextRun(cache, text, font, factor, hash);
+
+	if (run) {
+		// The atlas was packed again since the run was laid out
+		if (memcmp(&run->uv_offset, &r2->uv_offset, sizeof(Vec2)) != 0 || memcmp(&run->uv_scale, &r2->uv_scale, sizeof(Vec2)) != 0) {
+			R_LayoutTextRun(r2, text, font, factor, cache->vertices.data + run->first_vertex, &run->bounds);
+			run->uv_offset = r2->uv_offset;
+			run->uv_scale  = r2->uv_scale;
+		}
+		run->used_frame = cache->frame;
+		return run;
+	}
+
+	ptrdiff_t first_vertex = cache->vertices.count;
+	ptrdiff_t text_offset  = cache->text.count;
+
+	if (first_vertex + 4 * text.count > R_TEXT_CACHE_MAX_VERTICES)
+		return nullptr;
+
+	if (!Resize(&cache->vertices, r2->allocator, first_vertex + 4 * text.count) ||
+		!Resize(&cache->text, r2->allocator, text_offset + text.count) ||
+		!(run = Append(&cache->runs, r2->allocator))) {
+		cache->vertices.count = first_vertex;
+		cache->text.count     = text_offset;
+		return nullptr;
+	}
+
+	memcpy(cache->text.data + text_offset, text.data, text.count);
+
+	run->font         = font;
+	run->generation   = font->generation;
+	run->factor       = factor;
+	run->hash         = hash;
+	run->text_offset  = (uint32_t)text_offset;
+	run->text_count   = (uint32_t)text.count;
+	run->first_vertex = (uint32_t)first_vertex;
+	run->vertex_count = R_LayoutTextRun(r2, text, font, factor, cache->vertices.data + first_vertex, &run->bounds);
+	run->uv_offset    = r2->uv_offset;
+	run->uv_scale     = r2->uv_scale;
+	run->used_frame   = cache->frame;
+
+	cache->vertices.count = first_vertex + run->vertex_count;
+
+	if (2 * cache->runs.count <= cache->slots.count) {
+		R_InsertTextSlot(cache, (uint32_t)cache->runs.count - 1);
+	} else if (!R_RebuildTextSlots(cache, r2->allocator)) {
+		Pop(&cache->runs);
+		cache->vertices.count = first_vertex;
+		cache->text.count     = text_offset;
+		return nullptr;
+	}
+
+	return run;
+}
+
+// Copies the quads of the run and moves them to the pen position
+static void R_DrawTextRun(R_Renderer2d *r2, const R_Text_Run2d *run, Vec3 pos, Vec4 color) {
+	if (!run->vertex_count)
+		return;
+
+	if (R_Culled(r2, pos._0.xy + run->bounds.min, pos._0.xy + run->bounds.max))
+		return;
+
+	R_Vertex2d colored;
+	R_SetVertexColor2d(&colored, color);
+
+	const R_Vertex2d *src = r2->text_cache.vertices.data + run->first_vertex;
+
+	uint32_t quads       = run->vertex_count / 4;
+	uint32_t chunk_quads = (uint32_t)Min((uint64_t)quads, (uint64_t)R_MAX_VERTICES_PER_COMMAND / 4);
+
+	for (uint32_t first = 0; first < quads; first += chunk_quads) {
+		uint32_t chunk = Min(chunk_quads, quads - first);
+
+		R_Index2d index = R_EnsurePrimitive(r2, 4 * chunk, 6 * chunk);
+		if (index == R_INVALID_INDEX2D)
+			return;
+
+		R_Vertex2d *vtx = r2->write_vertex;
+
+		memcpy(vtx, src + 4 * first, sizeof(R_Vertex2d) * 4 * chunk);
+
+		for (uint32_t vertex = 0; vertex < 4 * chunk; ++vertex) {
+			R_SetVertexPosition2d(&vtx[vertex], R_VertexPosition(vtx[vertex]) + pos);
+			vtx[vertex].color = colored.color;
+		}
+
+		R_WriteQuadIndices(r2->write_index, index, chunk);
+	}
+}
 
-	render_pos.z = pos.z;
+// Decodes and draws chunk by chunk, for text that does not fit in the cache
+static void R_DrawTextGlyphs(R_Renderer2d *r2, Vec3 pos, Vec4 color, String text, R_Font *font, float factor) {
+	float start_x = pos.x;
 
 	uint8_t *start = text.data;
 	uint8_t *end   = text.data + text.count;
 
-	uint32_t codepoint;
+	R_Font_Glyph *glyphs[R_TEXT_GLYPH_CHUNK];
 
-	for (; start < end; ) {
-		start += R_UTF8ToCodepoint(start, end, &codepoint);
+	for (;;) {
+		uint8_t *line_end = (uint8_t *)memchr(start, '\n', end - start);
+		if (!line_end) line_end = end;
 
-		if (codepoint == '\n') {
-			pos.x  = start_x;
-			pos.y -= (1 + font->height) * factor;
-			continue;
+		// A line has at most one glyph per byte, lines that are off screen are skipped without decoding them
+		if (r2->cull && font->max_advance > 0.0f) {
+			Vec2 min = pos._0.xy + font->glyph_bounds.min * factor;
+			Vec2 max = pos._0.xy + font->glyph_bounds.max * factor + Vec2((float)(line_end - start) * font->max_advance * factor, 0.0f);
+
+			if (R_Culled(r2, min, max))
+				start = line_end;
 		}
 
-		R_Font_Glyph *glyph = R_FontFindGlyph(font, codepoint);
+		while (start < line_end) {
+			uint32_t count = R_NextGlyphs(font, &start, line_end, glyphs);
 
-		render_pos._0.xy = pos._0.xy + glyph->offset * factor;
-		render_dim = glyph->dimension * factor;
+			R_Index2d index = R_EnsurePrimitive(r2, 4 * count, 6 * count);
+			if (index == R_INVALID_INDEX2D)
+				return;
+
+			R_WriteGlyphQuads(r2, glyphs, count, factor, color, &pos, r2->write_vertex);
+			R_WriteQuadIndices(r2->write_index, index, count);
+		}
 
-		R_DrawRect(r2, render_pos, render_dim, glyph->uv, color);
+		if (line_end == end)
+			break;
 
-		pos.x += glyph->advance * factor;
+		start  = line_end + 1;
+		pos.x  = start_x;
+		pos.y -= (1 + font->height) * factor;
 	}
+}
 
-	R_PopTexture(r2);
+void R_DrawText(R_Renderer2d *r2, Vec3 pos, Vec4 color, String text, R_Font *font, float factor) {
+	if (!text.count)
+		return;
+
+	// Consecutive text of the same font does not need to push the texture again
+	bool push_texture = Last(r2->texture) != font->texture;
+	if (push_texture)
+		R_PushTexture(r2, font->texture);
+
+	R_Text_Run2d *run = R_TextRun(r2, text, font, factor);
+
+	if (run)
+		R_DrawTextRun(r2, run, pos, color);
+	else
+		R_DrawTextGlyphs(r2, pos, color, text, font, factor);
+
+	if (push_texture)
+		R_PopTexture(r2);
 }
 
 void R_DrawText(R_Renderer2d *r2, Vec2 pos, Vec4 color, String text, R_Font *font, float factor) {
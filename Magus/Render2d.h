@@ -5,11 +5,7 @@
 
 #include "RenderFont.h"
 
-#ifndef KR_RENDER2D_ENABLE_DEBUG_INFO
-#if defined(BUILD_DEBUG) || defined(BUILD_DEVELOPER)
-#define KR_RENDER2D_ENABLE_DEBUG_INFO
-#endif
-#endif
+#include <string.h>
 
 constexpr int DEFAULT_CIRCLE_SEGMENTS = 48;
 constexpr int DEFAULT_BEZIER_SEGMENTS = 48;
@@ -17,15 +13,190 @@ constexpr int DEFAULT_BEZIER_SEGMENTS = 48;
 static constexpr int MIN_CIRCLE_SEGMENTS = 12;
 static constexpr int MAX_CIRCLE_SEGMENTS = 512; // MUST BE POWER OF 2
 
+#if defined(KR_RENDER2D_COMPACT_VERTEX)
+// 2D position, RGBA8 color and half precision UVs, must be drawn with Shaders/HLSL/QuadCompact.shader
+// Depth is dropped, every vertex is at z = 0
+// Define KR_RENDER2D_COMPACT_FLOAT_TEXCOORD to keep 32-bit UVs when 11 bits of UV precision is not enough
+struct R_Vertex2d {
+	Vec2     position;
+#if defined(KR_RENDER2D_COMPACT_FLOAT_TEXCOORD)
+	Vec2     tex_coord;
+#else
+	uint16_t tex_coord[2];
+#endif
+	uint32_t color;
+};
+#else
 struct R_Vertex2d {
 	Vec3 position;
 	Vec2 tex_coord;
 	Vec4 color;
 };
+#endif
 
+#if defined(KR_RENDER2D_INDEX16)
+// Indices are relative to the command's vertex offset, commands are split before they reach 65535 vertices
+typedef uint16_t R_Index2d;
+#else
 typedef uint32_t R_Index2d;
+#endif
+
 typedef Region   R_Rect;
 
+// Per instance data of the instanced sprite path, expanded into a quad by the vertex shader
+// See Shaders/HLSL/Sprite.shader, the input layout must match this struct
+struct R_Sprite2d {
+	Vec2     position;  // center
+	Vec2     dimension;
+	float    angle;
+	uint16_t uv[4];     // min.x, min.y, max.x, max.y as unorm16
+	uint32_t color;     // RGBA8, red in the lowest byte
+};
+
+static_assert(sizeof(R_Sprite2d) == 32, "");
+
+enum R_Shape_Kind2d {
+	R_SHAPE_KIND_ROUNDED_RECT, // circles, capsules and rects are rounded rects with the matching radius
+	R_SHAPE_KIND_ELLIPSE,
+	_R_SHAPE_KIND_COUNT
+};
+
+// Per instance data of the signed distance shapes, expanded into a quad and shaded by Shaders/HLSL/Shape.shader
+// Shapes share the instance stream with sprites, the input layout must match this struct
+struct R_Shape2d {
+	Vec2     position;  // center
+	Vec2     dimension; // half extents
+	float    radius;    // corner radius, ignored by ellipses
+	uint16_t angle;     // unorm16 of [0, 2pi)
+	uint16_t kind;      // R_Shape_Kind2d
+	uint16_t thickness; // half, 0 fills the shape, otherwise only the inner band of this width is drawn
+	uint16_t feather;   // half, the quad is grown by it on every side to leave room for the anti-aliased edge
+	uint32_t color;     // RGBA8, red in the lowest byte
+};
+
+static_assert(sizeof(R_Shape2d) == sizeof(R_Sprite2d), "");
+
+// RGBA8, red in the lowest byte
+static inline uint32_t R_PackColor(Vec4 color) {
+	uint32_t packed = 0;
+	for (int c = 0; c < 4; ++c)
+		packed |= (uint32_t)(Clamp(0.0f, 1.0f, color.m[c]) * 255.0f + 0.5f) << (8 * c);
+	return packed;
+}
+
+static inline Vec4 R_UnpackColor(uint32_t packed) {
+	Vec4 color;
+	for (int c = 0; c < 4; ++c)
+		color.m[c] = (float)((packed >> (8 * c)) & 0xff) / 255.0f;
+	return color;
+}
+
+// IEEE half precision, rounded to nearest even
+static inline uint16_t R_PackHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign     = (bits >> 16) & 0x8000;
+	int32_t  exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent >= 31) {
+		bool nan = ((bits >> 23) & 0xff) == 0xff && mantissa;
+		return (uint16_t)(sign | 0x7c00 | (nan ? 0x200 : 0));
+	}
+
+	if (exponent <= 0) {
+		if (exponent < -10) return (uint16_t)sign;
+		mantissa |= 0x800000;
+		uint32_t shift    = (uint32_t)(14 - exponent);
+		uint32_t half     = mantissa >> shift;
+		uint32_t rest     = mantissa & ((1u << shift) - 1);
+		uint32_t midpoint = 1u << (shift - 1);
+		if (rest > midpoint || (rest == midpoint && (half & 1))) half += 1;
+		return (uint16_t)(sign | half);
+	}
+
+	// Rounding may carry into the exponent, which is still the correctly rounded value
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half += 1;
+	return (uint16_t)(sign | half);
+}
+
+static inline float R_UnpackHalf(uint16_t value) {
+	uint32_t sign     = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	if (!exponent) {
+		float result = (float)mantissa * (1.0f / 16777216.0f);
+		return sign ? -result : result;
+	}
+
+	uint32_t bits = exponent == 31 ? (sign | 0x7f800000 | (mantissa << 13)) : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// Vertices must be written and read through these so that the compact layout stays transparent
+static inline void R_SetVertex2d(R_Vertex2d *vertex, Vec3 position, Vec2 tex_coord, Vec4 color) {
+#if defined(KR_RENDER2D_COMPACT_VERTEX)
+	vertex->position = position._0.xy;
+#if defined(KR_RENDER2D_COMPACT_FLOAT_TEXCOORD)
+	vertex->tex_coord = tex_coord;
+#else
+	vertex->tex_coord[0] = R_PackHalf(tex_coord.x);
+	vertex->tex_coord[1] = R_PackHalf(tex_coord.y);
+#endif
+	vertex->color = R_PackColor(color);
+#else
+	vertex->position  = position;
+	vertex->tex_coord = tex_coord;
+	vertex->color     = color;
+#endif
+}
+
+static inline void R_SetVertexPosition2d(R_Vertex2d *vertex, Vec3 position) {
+#if defined(KR_RENDER2D_COMPACT_VERTEX)
+	vertex->position = position._0.xy;
+#else
+	vertex->position = position;
+#endif
+}
+
+static inline void R_SetVertexColor2d(R_Vertex2d *vertex, Vec4 color) {
+#if defined(KR_RENDER2D_COMPACT_VERTEX)
+	vertex->color = R_PackColor(color);
+#else
+	vertex->color = color;
+#endif
+}
+
+static inline Vec3 R_VertexPosition(const R_Vertex2d &vertex) {
+#if defined(KR_RENDER2D_COMPACT_VERTEX)
+	return Vec3(vertex.position, 0.0f);
+#else
+	return vertex.position;
+#endif
+}
+
+static inline Vec2 R_VertexTexCoord(const R_Vertex2d &vertex) {
+#if defined(KR_RENDER2D_COMPACT_VERTEX) && !defined(KR_RENDER2D_COMPACT_FLOAT_TEXCOORD)
+	return Vec2(R_UnpackHalf(vertex.tex_coord[0]), R_UnpackHalf(vertex.tex_coord[1]));
+#else
+	return vertex.tex_coord;
+#endif
+}
+
+static inline Vec4 R_VertexColor(const R_Vertex2d &vertex) {
+#if defined(KR_RENDER2D_COMPACT_VERTEX)
+	return R_UnpackColor(vertex.color);
+#else
+	return vertex.color;
+#endif
+}
+
 struct R_Camera2d {
 	float left;
 	float right;
@@ -37,6 +208,8 @@ struct R_Camera2d {
 
 struct R_Pipeline;
 struct R_Texture;
+struct R_Geometry;
+struct R_Mesh2d;
 
 //
 //
@@ -55,17 +228,34 @@ struct R_Font_Specification2d {
 	float          height;
 };
 
+// When enabled, textures created with R_Backend_CreateTexture and fonts created with R_Backend_CreateFont
+// are packed into one shared atlas and their UVs are remapped when the vertices are written,
+// so texture switches between them do not split draw commands
+// Atlas textures must only be sampled with UVs in [0, 1], sRGB textures and textures that do not fit
+// are created as separate backend textures. Space of destroyed atlas textures is not reused
+struct R_Atlas_Specification2d {
+	uint32_t width; // 0 disables the atlas
+	uint32_t height;
+	uint32_t textures;
+};
+
+// vertex, index and sprite are budgets in number of elements, the address space for them is reserved
+// up front and only committed as it is used. Frames that exceed a budget still render, and the budget
+// is grown for the next frames, see R_Memory2d::overflow_mark
 struct R_Specification2d {
 	uint32_t               command;
 	uint32_t               vertex;
 	uint32_t               index;
+	uint32_t               sprite;
 	uint32_t               path;
 	uint32_t               pipeline;
 	uint32_t               texture;
 	uint32_t               rect;
 	uint32_t               transform;
 	float                  thickness;
+	float                  tolerance; // see R_SetTessellationTolerance
 	R_Font_Specification2d font;
+	R_Atlas_Specification2d atlas;
 };
 
 struct R_Memory2d {
@@ -73,27 +263,32 @@ struct R_Memory2d {
 		size_t command;
 		size_t vertex;
 		size_t index;
+		size_t sprite;
 		size_t path;
 		size_t total;
 	};
 
 	Information allocated;
-#if defined(KR_RENDER2D_ENABLE_DEBUG_INFO)
-	Information used_mark;
-#endif
+	Information budget;
+	Information used_mark;     // largest amount used by a frame
+	Information overflow_mark; // largest amount recorded past the budget by a frame
+	uint32_t    overflow_frames;
 };
 
 constexpr R_Specification2d Renderer2dDefaultSpec = {
 	64,
 	1048576,
 	1048576 * 6,
+	65536,
 	64,
 	64,
 	255,
 	255,
 	255,
 	1.0f,
-	{ nullptr, 14.0f }
+	0.25f,
+	{ nullptr, 14.0f },
+	{ 0, 0, 0 }
 };
 
 struct R_Renderer2d;
@@ -109,14 +304,20 @@ struct R_Backend2d {
 	void       (*DestroyTexture)(R_Backend2d *, R_Texture *texture);
 	R_Font *   (*CreateFont)(R_Backend2d *, const R_Font_Config &config, float height_in_pixels);
 	void       (*DestroyFont)(R_Backend2d *, R_Font *font);
+	R_Geometry *(*CreateGeometry)(R_Backend2d *, const R_Vertex2d *vertices, uint32_t vertex_count, const R_Index2d *indices, uint32_t index_count);
+	void       (*DestroyGeometry)(R_Backend2d *, R_Geometry *geometry);
 
 	bool (*UploadVertexData)(R_Backend2d *, void* context, void *ptr, uint32_t size);
 	bool (*UploadIndexData)(R_Backend2d *, void *context, void *ptr, uint32_t size);
+	bool (*UploadInstanceData)(R_Backend2d *, void *context, void *ptr, uint32_t size);
 	void (*UploadDrawData)(R_Backend2d *, void *context, const R_Backend2d_Draw_Data &draw_data);
 	void (*SetPipeline)(R_Backend2d *, void *context, R_Pipeline *pipeline);
 	void (*SetScissor)(R_Backend2d *, void *context, R_Rect rect);
 	void (*SetTexture)(R_Backend2d *, void *context, R_Texture *texture);
+	void (*SetGeometry)(R_Backend2d *, void *context, R_Geometry *geometry); // nullptr selects the uploaded frame data
 	void (*DrawTriangleList)(R_Backend2d *, void *context, uint32_t index_count, uint32_t index_offset, int32_t vertex_offset);
+	void (*DrawInstancedQuads)(R_Backend2d *, void *context, uint32_t instance_count, uint32_t instance_offset);
+	void (*DrawInstancedShapes)(R_Backend2d *, void *context, uint32_t instance_count, uint32_t instance_offset);
 
 	void (*Release)(R_Backend2d *);
 };
@@ -133,6 +334,7 @@ R_Font *      R_Backend_CreateFont(R_Renderer2d *r2, String font_data, float hei
 void          R_Backend_DestroyFont(R_Renderer2d *r2, R_Font *font);
 
 R_Font_Glyph *R_FontFindGlyph(R_Font *font, uint32_t codepoint);
+void          R_FontFindGlyphs(R_Font *font, const uint32_t *codepoints, uint32_t count, R_Font_Glyph **glyphs);
 
 R_Texture *   R_DefaultTexture(R_Renderer2d *r2);
 R_Font *      R_DefaultFont(R_Renderer2d *r2);
@@ -146,16 +348,65 @@ R_Memory2d    R_GetMemoryInformation(R_Renderer2d *r2);
 //
 //
 
+enum R_Sort_Mode2d {
+	R_SORT_MODE_NONE,  // Commands are submitted in the order they are recorded
+	R_SORT_MODE_STATE, // Commands are sorted by layer, pipeline, texture and draw state, and commands with the same state are merged
+};
+
 void R_NextFrame(R_Renderer2d *r2, R_Rect region = R_Rect(0.0f, 0.0f, 1.0f, 1.0f));
 void R_FinishFrame(R_Renderer2d *r2, void *context);
 void R_NextDrawCommand(R_Renderer2d *r2);
 
+// Recording contexts have their own command, vertex, index and sprite buffers and their own state stacks,
+// so each thread can record into its own context in parallel with the others
+// Contexts share the backend, textures, fonts and atlas of the parent, which must not be created, destroyed
+// or swapped while contexts are recording. A context is recorded with R_NextFrame and the usual draw
+// procedures, but is never finished, it is appended to the parent's frame instead
+R_Renderer2d *R_CreateRecordingContext(R_Renderer2d *parent, const R_Specification2d &spec = Renderer2dDefaultSpec);
+void          R_DestroyRecordingContext(R_Renderer2d *context);
+
+// Appends everything recorded in the context after what has been recorded so far in r2
+// Must be called on the thread recording r2, after the context has finished recording
+void R_AppendContext(R_Renderer2d *r2, R_Renderer2d *context);
+
+// With R_SORT_MODE_STATE, draw order is only guaranteed between different layers
+// Draws that overlap and must blend in order should be put in increasing layers
+// The sort mode must be set before the frame is recorded
+void R_SetSortMode(R_Renderer2d *r2, R_Sort_Mode2d mode);
+void R_SetLayer(R_Renderer2d *r2, uint16_t layer);
+
 void R_CameraView(R_Renderer2d *r2, float left, float right, float bottom, float top, float _near, float _far);
 void R_CameraView(R_Renderer2d *r2, float aspect_ratio, float height);
 void R_CameraDimension(R_Renderer2d *r2, float width, float height);
 
+enum R_Line_Join2d {
+	R_LINE_JOIN_MITER, // sharp corners, beveled when the miter is longer than the miter limit
+	R_LINE_JOIN_BEVEL,
+	R_LINE_JOIN_ROUND,
+};
+
+enum R_Line_Cap2d {
+	R_LINE_CAP_BUTT,   // ends at the first and last point
+	R_LINE_CAP_SQUARE, // extended by half the thickness
+	R_LINE_CAP_ROUND,
+};
+
 void R_SetLineThickness(R_Renderer2d *r2, float thickness);
 
+// Joins and caps of stroked paths and outlines. The miter limit is the longest miter allowed in multiples of half
+// the thickness, it also bounds how far the inner corner of sharp turns can move
+void R_SetLineJoin(R_Renderer2d *r2, R_Line_Join2d join, float miter_limit = 4.0f);
+void R_SetLineCap(R_Renderer2d *r2, R_Line_Cap2d cap);
+
+// Largest distance in pixels allowed between a curve and its tessellation, measured with the current camera and
+// transform. The segments passed to circles, arcs, pies, beziers and rounded rects become an upper limit, small
+// shapes on screen get fewer segments. 0 always uses the given segments
+void R_SetTessellationTolerance(R_Renderer2d *r2, float tolerance);
+
+// Draws whose bounds after the current transform are entirely outside the camera or the current rect are dropped
+// before any of their vertices are written. Off by default. Draws recorded into meshes are never culled
+void R_SetCulling(R_Renderer2d *r2, bool cull);
+
 void R_SetPipeline(R_Renderer2d *r2, R_Pipeline *pipeline);
 void R_PushPipeline(R_Renderer2d *r2, R_Pipeline *pipeline);
 void R_PopPipeline(R_Renderer2d *r2);
@@ -199,6 +450,11 @@ void R_DrawRect(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color);
 void R_DrawRect(R_Renderer2d *r2, Vec3 pos, Vec2 dim, R_Rect rect, Vec4 color);
 void R_DrawRect(R_Renderer2d *r2, Vec2 pos, Vec2 dim, R_Rect rect, Vec4 color);
 
+// Bulk versions of R_DrawRect, the arrays are read in one loop and space for all the rects is reserved once,
+// only split where a command runs out of indices
+void R_DrawRects(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const Vec4 *colors, uint32_t count);
+void R_DrawRects(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, Vec4 color, uint32_t count);
+
 void R_DrawRectRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, Vec2 uv_a, Vec2 uv_b, Vec2 uv_c, Vec2 uv_d, Vec4 color);
 void R_DrawRectRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, Vec2 uv_a, Vec2 uv_b, Vec2 uv_c, Vec2 uv_d, Vec4 color);
 void R_DrawRectRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, Vec4 color);
@@ -220,11 +476,53 @@ void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle
 void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec3 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color);
 void R_DrawRectCenteredRotated(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color);
 
+// Sprites are drawn with the current pipeline, which must be an instanced pipeline like Sprite.shader
+// Only 32 bytes are uploaded per sprite, UVs are limited to [0, 1] and the sprites are drawn at z = 0
+void R_DrawSprite(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, R_Rect rect, Vec4 color);
+void R_DrawSprite(R_Renderer2d *r2, Vec2 pos, Vec2 dim, float angle, Vec4 color);
+void R_DrawSprite(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color);
+
+// Bulk versions of R_DrawSprite, space for all the sprites is reserved once. Angles may be null to draw them unrotated
+void R_DrawSprites(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const float *angles, const Vec4 *colors, uint32_t count);
+void R_DrawSprites(R_Renderer2d *r2, const Vec2 *positions, const Vec2 *dims, const float *angles, Vec4 color, uint32_t count);
+// Instances are copied as they are, their UVs are not mapped into the atlas entry of the current texture
+void R_DrawSprites(R_Renderer2d *r2, const R_Sprite2d *sprites, uint32_t count);
+
+// Shapes are one quad each, the edges are computed per pixel from the signed distance and are always anti-aliased
+// They are drawn with the current pipeline, which must be an instanced pipeline like Shape.shader
+// Textures are not sampled and the shapes are drawn at z = 0
+void R_DrawShape(R_Renderer2d *r2, R_Shape_Kind2d kind, Vec2 pos, Vec2 half_dim, float angle, float radius, float thickness, Vec4 color);
+
+void R_DrawShapeCircle(R_Renderer2d *r2, Vec2 pos, float radius, Vec4 color);
+void R_DrawShapeEllipse(R_Renderer2d *r2, Vec2 pos, float radius_a, float radius_b, Vec4 color);
+void R_DrawShapeRing(R_Renderer2d *r2, Vec2 pos, float radius, float thickness, Vec4 color);
+void R_DrawShapeCapsule(R_Renderer2d *r2, Vec2 a, Vec2 b, float radius, Vec4 color);
+// Anti-aliased versions of R_DrawLine and R_DrawLines, one instance per segment instead of a quad of vertices
+void R_DrawShapeLine(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec4 color);
+void R_DrawShapeLines(R_Renderer2d *r2, const Vec2 *points, uint32_t count, Vec4 color);
+void R_DrawShapeRoundedRect(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color, float radius = 1.0f);
+void R_DrawShapeRoundedRectOutline(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color, float radius = 1.0f);
+
+// Draws in between R_BeginRecord and R_EndRecord are not drawn in the current frame, they are captured into
+// a mesh that is uploaded once and can be drawn in any later frame for the cost of its commands
+// Pipelines, textures and transforms are recorded, the transforms are applied inside the transform the mesh
+// is drawn with. Camera, rect and layer are taken from the frame the mesh is drawn in. Sprites and shapes are not recorded
+// Meshes must be destroyed before the renderer or its backend is released
+void      R_BeginRecord(R_Renderer2d *r2);
+R_Mesh2d *R_EndRecord(R_Renderer2d *r2);
+void      R_DestroyMesh(R_Renderer2d *r2, R_Mesh2d *mesh);
+
+void R_DrawMesh(R_Renderer2d *r2, R_Mesh2d *mesh, const Mat4 &transform);
+void R_DrawMesh(R_Renderer2d *r2, R_Mesh2d *mesh);
+
 void R_DrawEllipse(R_Renderer2d *r2, Vec3 pos, float radius_a, float radius_b, Vec4 color, int segments = DEFAULT_CIRCLE_SEGMENTS);
 void R_DrawEllipse(R_Renderer2d *r2, Vec2 pos, float radius_a, float radius_b, Vec4 color, int segments = DEFAULT_CIRCLE_SEGMENTS);
 
 void R_DrawCircle(R_Renderer2d *r2, Vec3 pos, float radius, Vec4 color, int segments = DEFAULT_CIRCLE_SEGMENTS);
 void R_DrawCircle(R_Renderer2d *r2, Vec2 pos, float radius, Vec4 color, int segments = DEFAULT_CIRCLE_SEGMENTS);
+// Bulk versions of R_DrawCircle, reserved the same way as R_DrawRects
+void R_DrawCircles(R_Renderer2d *r2, const Vec2 *positions, const float *radii, const Vec4 *colors, uint32_t count, int segments = DEFAULT_CIRCLE_SEGMENTS);
+void R_DrawCircles(R_Renderer2d *r2, const Vec2 *positions, float radius, Vec4 color, uint32_t count, int segments = DEFAULT_CIRCLE_SEGMENTS);
 
 void R_DrawPie(R_Renderer2d *r2, Vec3 pos, float radius_a, float radius_b, float theta_a, float theta_b, Vec4 color, int segments = DEFAULT_CIRCLE_SEGMENTS);
 void R_DrawPie(R_Renderer2d *r2, Vec2 pos, float radius_a, float radius_b, float theta_a, float theta_b, Vec4 color, int segments = DEFAULT_CIRCLE_SEGMENTS);
@@ -238,6 +536,8 @@ void R_DrawPiePart(R_Renderer2d *r2, Vec2 pos, float radius_min, float radius_ma
 
 void R_DrawLine(R_Renderer2d *r2, Vec3 a, Vec3 b, Vec4 color);
 void R_DrawLine(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec4 color);
+// Points are taken in pairs, every pair is one segment. All segments are written with one reservation
+void R_DrawLines(R_Renderer2d *r2, const Vec2 *points, uint32_t count, Vec4 color);
 
 void R_PathTo(R_Renderer2d *r2, Vec2 a);
 void R_ArcTo(R_Renderer2d *r2, Vec2 position, float radius_a, float radius_b, float theta_a, float theta_b, int segments = DEFAULT_CIRCLE_SEGMENTS);
@@ -245,6 +545,7 @@ void R_BezierQuadraticTo(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec2 c, int segments
 void R_BezierCubicTo(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec2 c, Vec2 d, int segments = DEFAULT_BEZIER_SEGMENTS);
 
 void R_DrawPathStroked(R_Renderer2d *r2, Vec4 color, bool closed = false, float z = 1.0f);
+// Filled paths and polygons may be concave and may touch themselves, their edges must not cross
 void R_DrawPathFilled(R_Renderer2d *r2, Vec4 color, float z = 1.0f);
 
 void R_DrawBezierQuadratic(R_Renderer2d *r2, Vec2 a, Vec2 b, Vec2 c, Vec4 color, float z = 0, int segments = DEFAULT_BEZIER_SEGMENTS);
@@ -297,6 +598,8 @@ void R_DrawRoundedRectOutline(R_Renderer2d *r2, Vec2 pos, Vec2 dim, Vec4 color,
 float R_GetFontHeight(R_Renderer2d *r2, R_Font *font, float factor = 1.0f);
 float R_PrepareText(R_Renderer2d *r2, String text, R_Font *font, float factor = 1.0f);
 
+// The glyph quads of a string are laid out once and kept while the string is drawn every few frames,
+// drawing it again copies the quads instead of decoding the text and looking up every glyph
 void R_DrawText(R_Renderer2d *r2, Vec3 pos, Vec4 color, String text, R_Font *font, float factor = 1.0f);
 void R_DrawText(R_Renderer2d *r2, Vec2 pos, Vec4 color, String text, R_Font *font, float factor = 1.0f);
 void R_DrawText(R_Renderer2d *r2, Vec3 pos, Vec4 color, String text, float factor = 1.0f);
@@ -7,19 +7,80 @@
 
 #include <string.h>
 
+// Streamed buffers only ever grow, in powers of two, so that the buffers settle after a few frames
+// and are not recreated every time the amount of geometry changes slightly
+static constexpr uint32_t R_STREAM_BUFFER_MIN_SIZE = 64 * 1024;
+
+// Every draw data gets its own slot in the constant ring, slots are bound as constant buffer ranges
+static constexpr uint32_t R_CONSTANT_SLOT_SIZE      = R_CONSTANT_BUFFER_RANGE_ALIGNMENT;
+static constexpr uint32_t R_CONSTANT_RING_MIN_SIZE  = 64 * R_CONSTANT_SLOT_SIZE;
+
+static_assert(sizeof(Mat4) <= R_CONSTANT_SLOT_SIZE, "");
+
+typedef R_Buffer *(*R_Create_Buffer_Proc)(R_Device *device, R_Buffer_Usage usage, uint32_t flags, uint32_t size, void *data);
+
+struct R_Stream_Buffer {
+	R_Buffer *  buffer;
+	uint32_t    allocated;
+};
+
+struct R_Geometry_Impl {
+	R_Buffer *  vertex;
+	R_Buffer *  index;
+};
+
 struct R_Backend2d_Impl {
 	R_Backend2d backend;
 
 	R_Device *  device;
-	R_Buffer *  vertex;
-	R_Buffer *  index;
-	R_Buffer *  constant;
 
-	uint32_t    vertex_allocated;
-	uint32_t    index_allocated;
-	uint32_t    constant_allocated;
+	R_Stream_Buffer vertex;
+	R_Stream_Buffer index;
+	R_Stream_Buffer instance;
+	R_Stream_Buffer constant;
+
+	uint32_t    constant_offset;
+	bool        constant_ranges;
 };
 
+static bool R_ReserveStreamBuffer(R_Device *device, R_Stream_Buffer *stream, R_Create_Buffer_Proc create, uint32_t size, uint32_t min_size) {
+	if (stream->buffer && stream->allocated >= size)
+		return true;
+
+	uint32_t allocated = Max(stream->allocated, min_size);
+	while (allocated < size)
+		allocated *= 2;
+
+	if (stream->buffer)
+		R_DestroyBuffer(stream->buffer);
+
+	stream->buffer    = create(device, R_BUFFER_USAGE_DYNAMIC, R_BUFFER_CPU_WRITE_ACCESS, allocated, nullptr);
+	stream->allocated = stream->buffer ? allocated : 0;
+
+	return stream->buffer != nullptr;
+}
+
+// The first map of a buffer in a deferred list must discard, since the whole frame is uploaded
+// in one go, the stream is simply discarded every frame
+static bool R_UploadStreamBuffer(R_Device *device, R_List *list, R_Stream_Buffer *stream, R_Create_Buffer_Proc create, void *ptr, uint32_t size) {
+	if (!R_ReserveStreamBuffer(device, stream, create, size, R_STREAM_BUFFER_MIN_SIZE))
+		return false;
+
+	void *dst = R_MapBuffer(list, stream->buffer, R_MAP_WRITE_DISCARD);
+	if (!dst) return false;
+
+	memcpy(dst, ptr, size);
+	R_UnmapBuffer(list, stream->buffer);
+	return true;
+}
+
+static void R_ReleaseStreamBuffer(R_Stream_Buffer *stream) {
+	if (stream->buffer)
+		R_DestroyBuffer(stream->buffer);
+	stream->buffer    = nullptr;
+	stream->allocated = 0;
+}
+
 static R_Texture *CreateTextureImpl(R_Backend2d *backend, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels) {
 	R_Backend2d_Impl *impl = (R_Backend2d_Impl *)backend;
 
@@ -61,91 +122,116 @@ static void DestroyFontImpl(R_Backend2d *backend, R_Font *font) {
 	ReleaseFont(font);
 }
 
+static R_Geometry *CreateGeometryImpl(R_Backend2d *backend, const R_Vertex2d *vertices, uint32_t vertex_count, const R_Index2d *indices, uint32_t index_count) {
+	R_Backend2d_Impl *impl = (R_Backend2d_Impl *)backend;
+
+	R_Geometry_Impl *geometry = (R_Geometry_Impl *)M_Alloc(sizeof(R_Geometry_Impl));
+	if (!geometry) return nullptr;
+
+	// Meshes are never written after creation
+	geometry->vertex = R_CreateVertexBuffer(impl->device, R_BUFFER_USAGE_IMMUTABLE, 0, vertex_count * sizeof(R_Vertex2d), (void *)vertices);
+	geometry->index  = R_CreateIndexBuffer(impl->device, R_BUFFER_USAGE_IMMUTABLE, 0, index_count * sizeof(R_Index2d), (void *)indices);
+
+	if (!geometry->vertex || !geometry->index) {
+		if (geometry->vertex) R_DestroyBuffer(geometry->vertex);
+		if (geometry->index) R_DestroyBuffer(geometry->index);
+		M_Free(geometry, sizeof(R_Geometry_Impl));
+		return nullptr;
+	}
+
+	return (R_Geometry *)geometry;
+}
+
+static void DestroyGeometryImpl(R_Backend2d *backend, R_Geometry *_geometry) {
+	R_Geometry_Impl *geometry = (R_Geometry_Impl *)_geometry;
+	R_DestroyBuffer(geometry->vertex);
+	R_DestroyBuffer(geometry->index);
+	M_Free(geometry, sizeof(R_Geometry_Impl));
+}
+
+static void R_BindVertexData(R_List *list, R_Buffer *buffer) {
+	uint32_t stride = sizeof(R_Vertex2d), offset = 0;
+	R_BindVertexBuffers(list, &buffer, &stride, &offset, 0, 1);
+}
+
+static void R_BindIndexData(R_List *list, R_Buffer *buffer) {
+	static_assert(sizeof(R_Index2d) == sizeof(uint32_t) || sizeof(R_Index2d) == sizeof(uint16_t), "");
+
+	R_Format format = sizeof(R_Index2d) == sizeof(uint32_t) ? R_FORMAT_R32_UINT : R_FORMAT_R16_UINT;
+	R_BindIndexBuffer(list, buffer, format, 0);
+}
+
 static bool UploadVertexDataImpl(R_Backend2d *backend, void *_list, void *ptr, uint32_t size) {
 	R_Backend2d_Impl *impl = (R_Backend2d_Impl *)backend;
 	R_List *list           = (R_List *)_list;
 
-	if (impl->vertex_allocated < size) {
-		if (impl->vertex)
-			R_DestroyBuffer(impl->vertex);
-		impl->vertex = R_CreateVertexBuffer(impl->device, R_BUFFER_USAGE_DYNAMIC, R_BUFFER_CPU_WRITE_ACCESS, size, nullptr);
-		impl->vertex_allocated = size;
-	}
+	// Vertex data is uploaded first in every frame, so the constant ring starts over here
+	impl->constant_offset = 0;
 
-	if (!impl->vertex) {
-		impl->vertex_allocated = 0;
+	if (!R_UploadStreamBuffer(impl->device, list, &impl->vertex, R_CreateVertexBuffer, ptr, size))
 		return false;
-	}
 
-	void *dst = R_MapBuffer(list, impl->vertex);
-	if (dst) {
-		memcpy(dst, ptr, size);
-		R_UnmapBuffer(list, impl->vertex);
-		uint32_t stride = sizeof(R_Vertex2d), offset = 0;
-		R_BindVertexBuffers(list, &impl->vertex, &stride, &offset, 0, 1);
-		return true;
-	}
-	return false;
+	R_BindVertexData(list, impl->vertex.buffer);
+	return true;
 }
 
 static bool UploadIndexDataImpl(R_Backend2d *backend, void *_list, void *ptr, uint32_t size) {
 	R_Backend2d_Impl *impl = (R_Backend2d_Impl *)backend;
 	R_List *list           = (R_List *)_list;
 
-	if (impl->index_allocated < size) {
-		if (impl->index)
-			R_DestroyBuffer(impl->index);
-		impl->index = R_CreateIndexBuffer(impl->device, R_BUFFER_USAGE_DYNAMIC, R_BUFFER_CPU_READ_ACCESS, size, nullptr);
-
-		impl->index_allocated = size;
-	}
-
-	if (!impl->index) {
-		impl->index_allocated = 0;
+	if (!R_UploadStreamBuffer(impl->device, list, &impl->index, R_CreateIndexBuffer, ptr, size))
 		return false;
-	}
 
-	void *dst = R_MapBuffer(list, impl->index);
-	if (dst) {
-		memcpy(dst, ptr, size);
-		R_UnmapBuffer(list, impl->index);
+	R_BindIndexData(list, impl->index.buffer);
+	return true;
+}
 
-		static_assert(sizeof(R_Index2d) == sizeof(uint32_t) || sizeof(R_Index2d) == sizeof(uint16_t), "");
+static bool UploadInstanceDataImpl(R_Backend2d *backend, void *_list, void *ptr, uint32_t size) {
+	R_Backend2d_Impl *impl = (R_Backend2d_Impl *)backend;
+	R_List *list           = (R_List *)_list;
 
-		R_Format format = sizeof(R_Index2d) == sizeof(uint32_t) ? R_FORMAT_R32_UINT : R_FORMAT_R16_UINT;
-		R_BindIndexBuffer(list, impl->index, format, 0);
-		return true;
-	}
-	return false;
+	if (!R_UploadStreamBuffer(impl->device, list, &impl->instance, R_CreateVertexBuffer, ptr, size))
+		return false;
+
+	// Instanced pipelines read their per instance data from slot 1, see LoadPipeline
+	uint32_t stride = sizeof(R_Sprite2d), offset = 0;
+	R_BindVertexBuffers(list, &impl->instance.buffer, &stride, &offset, 1, 1);
+	return true;
 }
 
 static void UploadDrawDataImpl(R_Backend2d *backend, void *_list, const R_Backend2d_Draw_Data &draw_data) {
 	R_Backend2d_Impl *impl = (R_Backend2d_Impl *)backend;
 	R_List *list           = (R_List *)_list;
 
-	uint32_t required_size = AlignPower2Up(sizeof(Mat4), 16);
-
-	if (impl->constant_allocated < required_size) {
-		if (impl->constant)
-			R_DestroyBuffer(impl->constant);
-		impl->constant = R_CreateConstantBuffer(impl->device, R_BUFFER_USAGE_DYNAMIC, R_BUFFER_CPU_READ_ACCESS, required_size, nullptr);
-		if (!impl->constant) {
-			impl->constant_allocated = 0;
+	if (!impl->constant_ranges) {
+		// Without constant buffer ranges every draw data discards the whole (single slot) buffer
+		if (!R_ReserveStreamBuffer(impl->device, &impl->constant, R_CreateConstantBuffer, R_CONSTANT_SLOT_SIZE, R_CONSTANT_SLOT_SIZE))
 			return;
-		}
-
-		impl->constant_allocated = required_size;
+		impl->constant_offset = 0;
+	} else if (impl->constant_offset + R_CONSTANT_SLOT_SIZE > impl->constant.allocated) {
+		// The ring is full, grow it and start over, the new buffer is discarded before use like in a new frame
+		uint32_t required_size = impl->constant_offset ? impl->constant.allocated * 2 : R_CONSTANT_SLOT_SIZE;
+		if (!R_ReserveStreamBuffer(impl->device, &impl->constant, R_CreateConstantBuffer, required_size, R_CONSTANT_RING_MIN_SIZE))
+			return;
+		impl->constant_offset = 0;
 	}
 
-	void *dst = R_MapBuffer(list, impl->constant);
+	R_Map_Type map_type = impl->constant_offset ? R_MAP_WRITE_NO_OVERWRITE : R_MAP_WRITE_DISCARD;
+
+	uint8_t *dst = (uint8_t *)R_MapBuffer(list, impl->constant.buffer, map_type);
 	if (dst) {
 		const R_Camera2d &camera = draw_data.camera;
 		Mat4 proj = OrthographicLH(camera.left, camera.right, camera.top, camera.bottom, camera.near, camera.far);
 		Mat4 t = proj * draw_data.transform;
-		memcpy(dst, t.m, sizeof(Mat4));
-		R_UnmapBuffer(list, impl->constant);
-
-		R_BindConstantBuffers(list, R_SHADER_VERTEX, &impl->constant, 0, 1);
+		memcpy(dst + impl->constant_offset, t.m, sizeof(Mat4));
+		R_UnmapBuffer(list, impl->constant.buffer);
+
+		if (impl->constant_ranges) {
+			R_BindConstantBufferRange(list, R_SHADER_VERTEX, impl->constant.buffer, 0, impl->constant_offset, R_CONSTANT_SLOT_SIZE);
+			impl->constant_offset += R_CONSTANT_SLOT_SIZE;
+		} else {
+			R_BindConstantBuffers(list, R_SHADER_VERTEX, &impl->constant.buffer, 0, 1);
+		}
 	}
 }
 
@@ -169,21 +255,41 @@ void SetTextureImpl(R_Backend2d *backend, void *_list, R_Texture *texture) {
 	R_BindTextures(list, &texture, 0, 1);
 }
 
+void SetGeometryImpl(R_Backend2d *backend, void *_list, R_Geometry *_geometry) {
+	R_Backend2d_Impl *impl    = (R_Backend2d_Impl *)backend;
+	R_List *list              = (R_List *)_list;
+	R_Geometry_Impl *geometry = (R_Geometry_Impl *)_geometry;
+
+	R_BindVertexData(list, geometry ? geometry->vertex : impl->vertex.buffer);
+	R_BindIndexData(list, geometry ? geometry->index : impl->index.buffer);
+}
+
 void DrawTriangleListImpl(R_Backend2d *backend, void *_list, uint32_t index_count, uint32_t index_offset, int32_t vertex_offset) {
 	R_List *list = (R_List *)_list;
 	R_SetPrimitiveTopology(list, R_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	R_DrawIndexed(list, index_count, index_offset, vertex_offset);
 }
 
+void DrawInstancedQuadsImpl(R_Backend2d *backend, void *_list, uint32_t instance_count, uint32_t instance_offset) {
+	R_List *list = (R_List *)_list;
+	R_SetPrimitiveTopology(list, R_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	R_DrawInstanced(list, 6, instance_count, 0, instance_offset);
+}
+
+// The shape pipeline expands and shades the instances, the draw is the same as for sprites
+void DrawInstancedShapesImpl(R_Backend2d *backend, void *_list, uint32_t instance_count, uint32_t instance_offset) {
+	DrawInstancedQuadsImpl(backend, _list, instance_count, instance_offset);
+}
+
 void ReleaseImpl(R_Backend2d *backend) {
 	R_Backend2d_Impl *impl = (R_Backend2d_Impl *)backend;
 
-	R_DestroyBuffer(impl->vertex);
-	R_DestroyBuffer(impl->index);
-	R_DestroyBuffer(impl->constant);
+	R_ReleaseStreamBuffer(&impl->vertex);
+	R_ReleaseStreamBuffer(&impl->index);
+	R_ReleaseStreamBuffer(&impl->instance);
+	R_ReleaseStreamBuffer(&impl->constant);
 
-	impl->vertex = impl->index = impl->constant = nullptr;
-	impl->vertex_allocated = impl->index_allocated = impl->constant_allocated = 0;
+	impl->constant_offset = 0;
 }
 
 R_Backend2d *R_CreateBackend2d(R_Device *device) {
@@ -192,23 +298,30 @@ R_Backend2d *R_CreateBackend2d(R_Device *device) {
 
 	memset(impl, 0, sizeof(*impl));
 
-	impl->backend.CreateTexture      = CreateTextureImpl;
-	impl->backend.CreateTextureSRGBA = CreateTextureSRGBAImpl;
-	impl->backend.DestroyTexture     = DestroyTextureImpl;
-	impl->backend.CreateFont         = CreateFontImpl;
-	impl->backend.DestroyFont        = DestroyFontImpl;
-
-	impl->backend.UploadVertexData   = UploadVertexDataImpl;
-	impl->backend.UploadIndexData    = UploadIndexDataImpl;
-	impl->backend.UploadDrawData     = UploadDrawDataImpl;
-	impl->backend.SetPipeline        = SetPipelineImpl;
-	impl->backend.SetScissor         = SetScissorImpl;
-	impl->backend.SetTexture         = SetTextureImpl;
-	impl->backend.DrawTriangleList   = DrawTriangleListImpl;
-
-	impl->backend.Release            = ReleaseImpl;
+	impl->backend.CreateTexture       = CreateTextureImpl;
+	impl->backend.CreateTextureSRGBA  = CreateTextureSRGBAImpl;
+	impl->backend.DestroyTexture      = DestroyTextureImpl;
+	impl->backend.CreateFont          = CreateFontImpl;
+	impl->backend.DestroyFont         = DestroyFontImpl;
+	impl->backend.CreateGeometry      = CreateGeometryImpl;
+	impl->backend.DestroyGeometry     = DestroyGeometryImpl;
+
+	impl->backend.UploadVertexData    = UploadVertexDataImpl;
+	impl->backend.UploadIndexData     = UploadIndexDataImpl;
+	impl->backend.UploadInstanceData  = UploadInstanceDataImpl;
+	impl->backend.UploadDrawData      = UploadDrawDataImpl;
+	impl->backend.SetPipeline         = SetPipelineImpl;
+	impl->backend.SetScissor          = SetScissorImpl;
+	impl->backend.SetTexture          = SetTextureImpl;
+	impl->backend.SetGeometry         = SetGeometryImpl;
+	impl->backend.DrawTriangleList    = DrawTriangleListImpl;
+	impl->backend.DrawInstancedQuads  = DrawInstancedQuadsImpl;
+	impl->backend.DrawInstancedShapes = DrawInstancedShapesImpl;
+
+	impl->backend.Release             = ReleaseImpl;
 
 	impl->device                     = device;
+	impl->constant_ranges            = R_SupportsConstantBufferRanges(device);
 
 	return &impl->backend;
 }
@@ -0,0 +1,875 @@
+#include "Render2dSoftware.h"
+#include "Jobs.h"
+
+#include "Kr/KrMemory.h"
+#include "Kr/KrLog.h"
+
+#include "ResourceLoaders/Loaders.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define R_SOFTWARE_SSE2
+#include <emmintrin.h>
+#endif
+
+static constexpr int32_t R_SOFTWARE_TILE_SIZE = 64;
+
+// Always stored as RGBA8, R8 and RG8 are expanded the same way the GPU samples them
+struct R_Software_Texture {
+	uint32_t width;
+	uint32_t height;
+	size_t   allocated;
+	bool     white;
+	uint8_t *pixels;
+};
+
+// E(x, y) = a * x + b * y + c, positive inside the triangle
+// Pixel centers exactly on the edge are only owned by one of the two triangles sharing the edge
+struct R_Software_Edge {
+	float a, b, c;
+	bool  inclusive;
+};
+
+// Signed distance shape covering a triangle, the triangle's uv are the local coordinates of the shape
+struct R_Software_Shape {
+	uint32_t kind;  // R_Shape_Kind2d
+	Vec2     half;
+	float    radius;
+	float    thickness;
+	float    pixel; // local units per pixel
+};
+
+struct R_Software_Triangle {
+	R_Software_Edge      edges[3]; // edge k is opposite to vertex k
+	float                inv_area;
+	Vec2                 uv[3];
+	Vec4                 color[3];
+	int32_t              min_x, min_y;
+	int32_t              max_x, max_y;
+	R_Software_Texture * texture;
+	bool                 is_shape;
+	R_Software_Shape     shape;
+};
+
+struct R_Software_Geometry {
+	Array<R_Vertex2d>          vertices;
+	Array<R_Index2d>           indices;
+};
+
+struct R_Backend2d_Software {
+	R_Backend2d                backend;
+
+	uint32_t                   width;
+	uint32_t                   height;
+	Array<uint8_t>             pixels;
+
+	Array<R_Vertex2d>          vertices;
+	Array<R_Index2d>           indices;
+	Array<R_Sprite2d>          sprites;
+
+	Mat4                       transform;
+	R_Rect                     scissor;
+	R_Software_Texture *       texture;
+	R_Software_Geometry *      geometry;
+
+	Array<R_Software_Triangle> triangles;
+
+	int32_t                    tiles_x;
+	int32_t                    tiles_y;
+	Array<uint32_t>            bin_offsets;
+	Array<uint32_t>            bin_items;
+};
+
+static float SRGBToLinear[256];
+
+//
+//
+//
+
+static R_Software_Texture *R_SoftwareAllocateTexture(uint32_t w, uint32_t h) {
+	size_t allocated = sizeof(R_Software_Texture) + (size_t)w * h * 4;
+
+	R_Software_Texture *texture = (R_Software_Texture *)M_Alloc(allocated);
+	if (!texture) {
+		LogError("Software: Failed to allocate texture of size %x%", w, h);
+		return nullptr;
+	}
+
+	texture->width     = w;
+	texture->height    = h;
+	texture->allocated = allocated;
+	texture->white     = false;
+	texture->pixels    = (uint8_t *)(texture + 1);
+
+	return texture;
+}
+
+static R_Texture *R_SoftwareCreateTexture(void *context, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels) {
+	if (n != 1 && n != 2 && n != 4) {
+		LogError("Software: Unsupported texture channel count %", n);
+		return nullptr;
+	}
+
+	R_Software_Texture *texture = R_SoftwareAllocateTexture(w, h);
+	if (!texture) return nullptr;
+
+	uint8_t *dst = texture->pixels;
+	for (uint32_t index = 0; index < w * h; ++index, dst += 4, pixels += n) {
+		dst[0] = pixels[0];
+		dst[1] = n >= 2 ? pixels[1] : 0;
+		dst[2] = n == 4 ? pixels[2] : 0;
+		dst[3] = n == 4 ? pixels[3] : 0xff;
+	}
+
+	texture->white = (w == 1 && h == 1 && n == 4 && memcmp(texture->pixels, "\xff\xff\xff\xff", 4) == 0);
+
+	return (R_Texture *)texture;
+}
+
+static void R_SoftwareReleaseTexture(R_Texture *_texture) {
+	R_Software_Texture *texture = (R_Software_Texture *)_texture;
+	M_Free(texture, texture->allocated);
+}
+
+static R_Texture *CreateTextureSoftware(R_Backend2d *backend, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels) {
+	return R_SoftwareCreateTexture(backend, w, h, n, pixels);
+}
+
+static R_Texture *CreateTextureSRGBASoftware(R_Backend2d *backend, uint32_t w, uint32_t h, const uint8_t *pixels) {
+	R_Software_Texture *texture = (R_Software_Texture *)R_SoftwareCreateTexture(backend, w, h, 4, pixels);
+	if (!texture) return nullptr;
+
+	// The GPU returns linear values when sampling sRGB textures
+	uint8_t *dst = texture->pixels;
+	for (uint32_t index = 0; index < w * h; ++index, dst += 4) {
+		for (int c = 0; c < 3; ++c)
+			dst[c] = (uint8_t)(SRGBToLinear[dst[c]] * 255.0f + 0.5f);
+	}
+
+	return (R_Texture *)texture;
+}
+
+static void DestroyTextureSoftware(R_Backend2d *backend, R_Texture *texture) {
+	R_SoftwareReleaseTexture(texture);
+}
+
+static R_Font *CreateFontSoftware(R_Backend2d *backend, const R_Font_Config &config, float height_in_pixels) {
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	R_Font *font = LoadFont(arena, config, height_in_pixels);
+	if (!font) return nullptr;
+
+	if (UploadFontTexture(font, R_SoftwareCreateTexture, R_SoftwareReleaseTexture, backend)) {
+		return font;
+	}
+
+	ReleaseFont(font);
+	return nullptr;
+}
+
+static void DestroyFontSoftware(R_Backend2d *backend, R_Font *font) {
+	ReleaseFont(font);
+}
+
+static R_Geometry *CreateGeometrySoftware(R_Backend2d *backend, const R_Vertex2d *vertices, uint32_t vertex_count, const R_Index2d *indices, uint32_t index_count) {
+	R_Software_Geometry *geometry = new R_Software_Geometry;
+
+	if (!Resize(&geometry->vertices, vertex_count) || !Resize(&geometry->indices, index_count)) {
+		LogError("Software: Failed to allocate geometry of % vertices and % indices", vertex_count, index_count);
+		Free(&geometry->vertices);
+		Free(&geometry->indices);
+		delete geometry;
+		return nullptr;
+	}
+
+	memcpy(geometry->vertices.data, vertices, vertex_count * sizeof(R_Vertex2d));
+	memcpy(geometry->indices.data, indices, index_count * sizeof(R_Index2d));
+
+	return (R_Geometry *)geometry;
+}
+
+static void DestroyGeometrySoftware(R_Backend2d *backend, R_Geometry *_geometry) {
+	R_Backend2d_Software *impl     = (R_Backend2d_Software *)backend;
+	R_Software_Geometry *geometry = (R_Software_Geometry *)_geometry;
+	if (impl->geometry == geometry)
+		impl->geometry = nullptr;
+	Free(&geometry->vertices);
+	Free(&geometry->indices);
+	delete geometry;
+}
+
+// Uploading the frame's vertices binds them again, like the stream buffers of the D3D11 backend
+static bool UploadVertexDataSoftware(R_Backend2d *backend, void *context, void *ptr, uint32_t size) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	impl->geometry = nullptr;
+
+	if (!Resize(&impl->vertices, size / sizeof(R_Vertex2d)))
+		return false;
+	memcpy(impl->vertices.data, ptr, size);
+	return true;
+}
+
+static bool UploadIndexDataSoftware(R_Backend2d *backend, void *context, void *ptr, uint32_t size) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	if (!Resize(&impl->indices, size / sizeof(R_Index2d)))
+		return false;
+	memcpy(impl->indices.data, ptr, size);
+	return true;
+}
+
+static bool UploadInstanceDataSoftware(R_Backend2d *backend, void *context, void *ptr, uint32_t size) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	if (!Resize(&impl->sprites, size / sizeof(R_Sprite2d)))
+		return false;
+	memcpy(impl->sprites.data, ptr, size);
+	return true;
+}
+
+static void UploadDrawDataSoftware(R_Backend2d *backend, void *context, const R_Backend2d_Draw_Data &draw_data) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+	const R_Camera2d &camera   = draw_data.camera;
+	Mat4 proj       = OrthographicLH(camera.left, camera.right, camera.top, camera.bottom, camera.near, camera.far);
+	impl->transform = proj * draw_data.transform;
+}
+
+static void SetPipelineSoftware(R_Backend2d *backend, void *context, R_Pipeline *pipeline) {}
+
+static void SetScissorSoftware(R_Backend2d *backend, void *context, R_Rect rect) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+	impl->scissor = rect;
+}
+
+static void SetTextureSoftware(R_Backend2d *backend, void *context, R_Texture *texture) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+	impl->texture = (R_Software_Texture *)texture;
+}
+
+static void SetGeometrySoftware(R_Backend2d *backend, void *context, R_Geometry *geometry) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+	impl->geometry = (R_Software_Geometry *)geometry;
+}
+
+//
+//
+//
+
+static bool R_SoftwareSetupEdge(R_Software_Edge *edge, Vec2 p, Vec2 q, Vec2 opposite) {
+	// Evaluate the edge in a canonical direction so that both triangles sharing it compute
+	// exactly the same (negated) values, which keeps the rasterization watertight
+	bool flip = (p.x > q.x) || (p.x == q.x && p.y > q.y);
+	if (flip) Swap(&p, &q);
+
+	float a = -(q.y - p.y);
+	float b = q.x - p.x;
+	float c = -(a * p.x + b * p.y);
+
+	float side = a * opposite.x + b * opposite.y + c;
+	if (side == 0.0f) return false;
+
+	float sign = side > 0.0f ? 1.0f : -1.0f;
+
+	edge->a         = sign * a;
+	edge->b         = sign * b;
+	edge->c         = sign * c;
+	edge->inclusive = sign > 0.0f;
+
+	return true;
+}
+
+struct R_Software_Scissor {
+	int32_t min_x, min_y;
+	int32_t max_x, max_y;
+};
+
+static bool R_SoftwareGetScissor(R_Backend2d_Software *impl, R_Software_Scissor *scissor) {
+	// Scissor rect has origin at bottom left
+	scissor->min_x = Clamp(0, (int32_t)impl->width, (int32_t)impl->scissor.min.x);
+	scissor->max_x = Clamp(0, (int32_t)impl->width, (int32_t)impl->scissor.max.x);
+	scissor->min_y = Clamp(0, (int32_t)impl->height, (int32_t)impl->height - (int32_t)impl->scissor.max.y);
+	scissor->max_y = Clamp(0, (int32_t)impl->height, (int32_t)impl->height - (int32_t)impl->scissor.min.y);
+
+	return scissor->min_x < scissor->max_x && scissor->min_y < scissor->max_y;
+}
+
+// Returns false only when the triangle buffer overflows
+// Shapes pass their local coordinates separately, they do not fit the precision of the compact vertex layout
+static bool R_SoftwarePushTriangle(R_Backend2d_Software *impl, const R_Software_Scissor &scissor, const R_Vertex2d *vertex[3], const R_Software_Shape *shape = nullptr, const Vec2 *local = nullptr) {
+	float width  = (float)impl->width;
+	float height = (float)impl->height;
+
+	Vec2 screen[3];
+	for (int k = 0; k < 3; ++k) {
+		Vec4 clip = impl->transform * Vec4(R_VertexPosition(*vertex[k]), 1.0f);
+		float inv_w = 1.0f / clip.w;
+
+		screen[k].x = (clip.x * inv_w * 0.5f + 0.5f) * width;
+		screen[k].y = (0.5f - clip.y * inv_w * 0.5f) * height;
+	}
+
+	float min_x = Min(screen[0].x, Min(screen[1].x, screen[2].x));
+	float max_x = Max(screen[0].x, Max(screen[1].x, screen[2].x));
+	float min_y = Min(screen[0].y, Min(screen[1].y, screen[2].y));
+	float max_y = Max(screen[0].y, Max(screen[1].y, screen[2].y));
+
+	R_Software_Triangle triangle;
+	triangle.min_x = Max(scissor.min_x, (int32_t)Floor(min_x));
+	triangle.max_x = Min(scissor.max_x, (int32_t)Ceil(max_x));
+	triangle.min_y = Max(scissor.min_y, (int32_t)Floor(min_y));
+	triangle.max_y = Min(scissor.max_y, (int32_t)Ceil(max_y));
+
+	if (triangle.min_x >= triangle.max_x || triangle.min_y >= triangle.max_y)
+		return true;
+
+	if (!R_SoftwareSetupEdge(&triangle.edges[0], screen[1], screen[2], screen[0]) ||
+		!R_SoftwareSetupEdge(&triangle.edges[1], screen[2], screen[0], screen[1]) ||
+		!R_SoftwareSetupEdge(&triangle.edges[2], screen[0], screen[1], screen[2]))
+		return true;
+
+	const R_Software_Edge &edge = triangle.edges[0];
+	triangle.inv_area = 1.0f / (edge.a * screen[0].x + edge.b * screen[0].y + edge.c);
+	triangle.texture  = impl->texture;
+
+	for (int k = 0; k < 3; ++k) {
+		triangle.uv[k]    = shape ? local[k] : R_VertexTexCoord(*vertex[k]);
+		triangle.color[k] = R_VertexColor(*vertex[k]);
+	}
+
+	triangle.is_shape = shape != nullptr;
+
+	if (shape) {
+		// The local coordinates are affine in screen space, what ddx and ddy return in Shape.shader
+		Vec2 dx = Vec2(0.0f), dy = Vec2(0.0f);
+		for (int k = 0; k < 3; ++k) {
+			dx = dx + triangle.edges[k].a * triangle.inv_area * triangle.uv[k];
+			dy = dy + triangle.edges[k].b * triangle.inv_area * triangle.uv[k];
+		}
+
+		triangle.shape       = *shape;
+		triangle.shape.pixel = SquareRoot(Abs(dx.x * dy.y - dx.y * dy.x));
+	}
+
+	if (!Append(&impl->triangles, triangle)) {
+		LogWarning("Software: Triangle buffer overflow. Next triangles will not be rasterized.");
+		return false;
+	}
+
+	return true;
+}
+
+static void DrawTriangleListSoftware(R_Backend2d *backend, void *context, uint32_t index_count, uint32_t index_offset, int32_t vertex_offset) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	const Array<R_Vertex2d> &vertices = impl->geometry ? impl->geometry->vertices : impl->vertices;
+	const Array<R_Index2d> &indices   = impl->geometry ? impl->geometry->indices : impl->indices;
+
+	if ((size_t)index_offset + index_count > (size_t)indices.count) {
+		LogWarning("Software: Draw call out of index buffer bounds. Skipping draw call.");
+		return;
+	}
+
+	if (!impl->texture) {
+		LogWarning("Software: Draw call without texture. Skipping draw call.");
+		return;
+	}
+
+	R_Software_Scissor scissor;
+	if (!R_SoftwareGetScissor(impl, &scissor))
+		return;
+
+	const R_Index2d *triangles = indices.data + index_offset;
+
+	for (uint32_t first = 0; first + 3 <= index_count; first += 3) {
+		const R_Vertex2d *vertex[3];
+
+		bool valid = true;
+		for (int k = 0; k < 3; ++k) {
+			int64_t index = (int64_t)vertex_offset + triangles[first + k];
+			if (index < 0 || index >= vertices.count) {
+				valid = false;
+				break;
+			}
+			vertex[k] = &vertices.data[index];
+		}
+
+		if (!valid) continue;
+
+		if (!R_SoftwarePushTriangle(impl, scissor, vertex))
+			return;
+	}
+}
+
+// Expands the sprites the same way Sprite.shader does
+static void DrawInstancedQuadsSoftware(R_Backend2d *backend, void *context, uint32_t instance_count, uint32_t instance_offset) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	if ((size_t)instance_offset + instance_count > (size_t)impl->sprites.count) {
+		LogWarning("Software: Draw call out of instance buffer bounds. Skipping draw call.");
+		return;
+	}
+
+	if (!impl->texture) {
+		LogWarning("Software: Draw call without texture. Skipping draw call.");
+		return;
+	}
+
+	R_Software_Scissor scissor;
+	if (!R_SoftwareGetScissor(impl, &scissor))
+		return;
+
+	static const Vec2 Corners[4] = { Vec2(-0.5f, -0.5f), Vec2(-0.5f, 0.5f), Vec2(0.5f, 0.5f), Vec2(0.5f, -0.5f) };
+
+	const R_Sprite2d *sprites = impl->sprites.data + instance_offset;
+
+	for (uint32_t index = 0; index < instance_count; ++index) {
+		const R_Sprite2d &sprite = sprites[index];
+
+		float cv = Cos(sprite.angle);
+		float sv = Sin(sprite.angle);
+
+		Vec2 uv_min = Vec2((float)sprite.uv[0], (float)sprite.uv[1]) / 65535.0f;
+		Vec2 uv_max = Vec2((float)sprite.uv[2], (float)sprite.uv[3]) / 65535.0f;
+
+		Vec4 color = R_UnpackColor(sprite.color);
+
+		R_Vertex2d quad[4];
+		for (int k = 0; k < 4; ++k) {
+			Vec2 offset = Corners[k] * sprite.dimension;
+			Vec3 position;
+			position.x = sprite.position.x + offset.x * cv - offset.y * sv;
+			position.y = sprite.position.y + offset.x * sv + offset.y * cv;
+			position.z = 0.0f;
+			R_SetVertex2d(&quad[k], position, uv_min + (Corners[k] + Vec2(0.5f)) * (uv_max - uv_min), color);
+		}
+
+		const R_Vertex2d *first[3]  = { &quad[0], &quad[1], &quad[2] };
+		const R_Vertex2d *second[3] = { &quad[0], &quad[2], &quad[3] };
+
+		if (!R_SoftwarePushTriangle(impl, scissor, first) || !R_SoftwarePushTriangle(impl, scissor, second))
+			return;
+	}
+}
+
+// Expands the shapes the same way Shape.shader does
+static void DrawInstancedShapesSoftware(R_Backend2d *backend, void *context, uint32_t instance_count, uint32_t instance_offset) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	if ((size_t)instance_offset + instance_count > (size_t)impl->sprites.count) {
+		LogWarning("Software: Draw call out of instance buffer bounds. Skipping draw call.");
+		return;
+	}
+
+	R_Software_Scissor scissor;
+	if (!R_SoftwareGetScissor(impl, &scissor))
+		return;
+
+	static const Vec2 Corners[4] = { Vec2(-1.0f, -1.0f), Vec2(-1.0f, 1.0f), Vec2(1.0f, 1.0f), Vec2(1.0f, -1.0f) };
+
+	// Shapes share the instance stream with sprites
+	const R_Shape2d *shapes = (const R_Shape2d *)impl->sprites.data + instance_offset;
+
+	for (uint32_t index = 0; index < instance_count; ++index) {
+		const R_Shape2d &src = shapes[index];
+
+		float angle = (float)src.angle * (2.0f * PI / 65536.0f);
+		float cv    = Cos(angle);
+		float sv    = Sin(angle);
+
+		float feather = R_UnpackHalf(src.feather);
+		Vec2  extent  = src.dimension + Vec2(feather);
+
+		R_Software_Shape shape;
+		shape.kind      = src.kind;
+		shape.half      = src.dimension;
+		shape.radius    = src.radius;
+		shape.thickness = R_UnpackHalf(src.thickness);
+		shape.pixel     = 0.0f;
+
+		Vec4 color = R_UnpackColor(src.color);
+
+		R_Vertex2d quad[4];
+		Vec2       local[4];
+		for (int k = 0; k < 4; ++k) {
+			local[k] = Corners[k] * extent;
+			Vec3 position;
+			position.x = src.position.x + local[k].x * cv - local[k].y * sv;
+			position.y = src.position.y + local[k].x * sv + local[k].y * cv;
+			position.z = 0.0f;
+			R_SetVertex2d(&quad[k], position, Vec2(0.0f), color);
+		}
+
+		const R_Vertex2d *first[3]  = { &quad[0], &quad[1], &quad[2] };
+		const R_Vertex2d *second[3] = { &quad[0], &quad[2], &quad[3] };
+		const Vec2 first_local[3]   = { local[0], local[1], local[2] };
+		const Vec2 second_local[3]  = { local[0], local[2], local[3] };
+
+		if (!R_SoftwarePushTriangle(impl, scissor, first, &shape, first_local) ||
+			!R_SoftwarePushTriangle(impl, scissor, second, &shape, second_local))
+			return;
+	}
+}
+
+static void ReleaseSoftware(R_Backend2d *backend) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	Free(&impl->pixels);
+	Free(&impl->vertices);
+	Free(&impl->indices);
+	Free(&impl->sprites);
+	Free(&impl->triangles);
+	Free(&impl->bin_offsets);
+	Free(&impl->bin_items);
+
+	impl->width = impl->height = 0;
+}
+
+//
+//
+//
+
+static inline int32_t R_SoftwareWrap(int32_t value, int32_t size) {
+	int32_t result = value % size;
+	return result < 0 ? result + size : result;
+}
+
+static void R_SoftwareSampleBilinear(const R_Software_Texture *texture, float u, float v, float *out) {
+	int32_t w = (int32_t)texture->width;
+	int32_t h = (int32_t)texture->height;
+
+	float x  = u * (float)w - 0.5f;
+	float y  = v * (float)h - 0.5f;
+	float fx = Floor(x);
+	float fy = Floor(y);
+	float tx = x - fx;
+	float ty = y - fy;
+
+	int32_t x0 = R_SoftwareWrap((int32_t)fx, w);
+	int32_t y0 = R_SoftwareWrap((int32_t)fy, h);
+	int32_t x1 = x0 + 1 < w ? x0 + 1 : 0;
+	int32_t y1 = y0 + 1 < h ? y0 + 1 : 0;
+
+	const uint8_t *p00 = texture->pixels + ((size_t)y0 * w + x0) * 4;
+	const uint8_t *p10 = texture->pixels + ((size_t)y0 * w + x1) * 4;
+	const uint8_t *p01 = texture->pixels + ((size_t)y1 * w + x0) * 4;
+	const uint8_t *p11 = texture->pixels + ((size_t)y1 * w + x1) * 4;
+
+	float w00 = (1.0f - tx) * (1.0f - ty);
+	float w10 = tx * (1.0f - ty);
+	float w01 = (1.0f - tx) * ty;
+	float w11 = tx * ty;
+
+	for (int c = 0; c < 4; ++c) {
+		out[c] = (w00 * p00[c] + w10 * p10[c] + w01 * p01[c] + w11 * p11[c]) * (1.0f / 255.0f);
+	}
+}
+
+// Same distances as Shape.shader, negative inside
+static float R_SoftwareShapeDistance(const R_Software_Shape &shape, float x, float y) {
+	float distance;
+
+	if (shape.kind == R_SHAPE_KIND_ELLIPSE) {
+		float a = shape.half.x, b = shape.half.y;
+		// Approximation that is exact on the boundary, which is all the anti-aliasing needs
+		float k0 = SquareRoot((x * x) / (a * a) + (y * y) / (b * b));
+		float k1 = SquareRoot((x * x) / (a * a * a * a) + (y * y) / (b * b * b * b));
+		distance = k1 > 0.0f ? k0 * (k0 - 1.0f) / k1 : -Min(a, b);
+	} else {
+		float qx = Abs(x) - shape.half.x + shape.radius;
+		float qy = Abs(y) - shape.half.y + shape.radius;
+		float ox = Max(qx, 0.0f), oy = Max(qy, 0.0f);
+		distance = SquareRoot(ox * ox + oy * oy) + Min(Max(qx, qy), 0.0f) - shape.radius;
+	}
+
+	if (shape.thickness > 0.0f)
+		distance = Abs(distance + 0.5f * shape.thickness) - 0.5f * shape.thickness;
+
+	return distance;
+}
+
+static inline void R_SoftwareShadePixel(const R_Software_Triangle &triangle, float e0, float e1, uint8_t *dst) {
+	float w0 = e0 * triangle.inv_area;
+	float w1 = e1 * triangle.inv_area;
+	float w2 = 1.0f - w0 - w1;
+
+	float color[4];
+	for (int c = 0; c < 4; ++c) {
+		color[c] = w0 * triangle.color[0].m[c] + w1 * triangle.color[1].m[c] + w2 * triangle.color[2].m[c];
+	}
+
+	if (triangle.is_shape) {
+		float x = w0 * triangle.uv[0].x + w1 * triangle.uv[1].x + w2 * triangle.uv[2].x;
+		float y = w0 * triangle.uv[0].y + w1 * triangle.uv[1].y + w2 * triangle.uv[2].y;
+
+		const R_Software_Shape &shape = triangle.shape;
+
+		float distance = R_SoftwareShapeDistance(shape, x, y);
+		float coverage = shape.pixel > 0.0f ? Clamp(0.0f, 1.0f, 0.5f - distance / shape.pixel) : (distance <= 0.0f ? 1.0f : 0.0f);
+
+		if (coverage <= 0.0f)
+			return;
+
+		color[3] *= coverage;
+	} else if (!triangle.texture->white) {
+		float u = w0 * triangle.uv[0].x + w1 * triangle.uv[1].x + w2 * triangle.uv[2].x;
+		float v = w0 * triangle.uv[0].y + w1 * triangle.uv[1].y + w2 * triangle.uv[2].y;
+
+		float sample[4];
+		R_SoftwareSampleBilinear(triangle.texture, u, v, sample);
+
+		for (int c = 0; c < 4; ++c)
+			color[c] *= sample[c];
+	}
+
+	// Blend0: src * src_alpha + dst * (1 - src_alpha), same for the alpha channel
+	float alpha   = Clamp(0.0f, 1.0f, color[3]);
+	float inverse = 1.0f - alpha;
+
+	for (int c = 0; c < 4; ++c) {
+		float value = Clamp(0.0f, 1.0f, color[c]) * alpha + (float)dst[c] * (1.0f / 255.0f) * inverse;
+		dst[c] = (uint8_t)(value * 255.0f + 0.5f);
+	}
+}
+
+static void R_SoftwareRasterizeTriangle(R_Backend2d_Software *impl, const R_Software_Triangle &triangle, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+	const R_Software_Edge *edges = triangle.edges;
+
+#if defined(R_SOFTWARE_SSE2)
+	const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero    = _mm_setzero_ps();
+
+	__m128 a[3], b[3], c[3];
+	for (int k = 0; k < 3; ++k) {
+		a[k] = _mm_set1_ps(edges[k].a);
+		b[k] = _mm_set1_ps(edges[k].b);
+		c[k] = _mm_set1_ps(edges[k].c);
+	}
+#endif
+
+	for (int32_t y = y0; y < y1; ++y) {
+		float py = (float)y + 0.5f;
+
+		uint8_t *row = impl->pixels.data + (size_t)y * impl->width * 4;
+
+		for (int32_t x = x0; x < x1; x += 4) {
+			alignas(16) float e[3][4];
+			uint32_t mask = 0;
+
+#if defined(R_SOFTWARE_SSE2)
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+			__m128 vy = _mm_set1_ps(py);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int k = 0; k < 3; ++k) {
+				__m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[k], px), _mm_mul_ps(b[k], vy)), c[k]);
+				__m128 test  = edges[k].inclusive ? _mm_cmpge_ps(value, zero) : _mm_cmpgt_ps(value, zero);
+				inside = _mm_and_ps(inside, test);
+				_mm_store_ps(e[k], value);
+			}
+			mask = (uint32_t)_mm_movemask_ps(inside);
+#else
+			for (int i = 0; i < 4; ++i) {
+				float px = (float)(x + i) + 0.5f;
+				bool inside = true;
+				for (int k = 0; k < 3; ++k) {
+					float value = edges[k].a * px + edges[k].b * py + edges[k].c;
+					inside = inside && (edges[k].inclusive ? value >= 0.0f : value > 0.0f);
+					e[k][i] = value;
+				}
+				if (inside) mask |= (1u << i);
+			}
+#endif
+
+			if (x1 - x < 4)
+				mask &= (1u << (x1 - x)) - 1;
+
+			for (int i = 0; mask; ++i, mask >>= 1) {
+				if (mask & 1)
+					R_SoftwareShadePixel(triangle, e[0][i], e[1][i], row + (size_t)(x + i) * 4);
+			}
+		}
+	}
+}
+
+static void R_SoftwareRasterizeTiles(void *data, uint32_t first, uint32_t last, uint32_t thread) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)data;
+
+	for (uint32_t tile = first; tile < last; ++tile) {
+		int32_t tile_x0 = (int32_t)(tile % impl->tiles_x) * R_SOFTWARE_TILE_SIZE;
+		int32_t tile_y0 = (int32_t)(tile / impl->tiles_x) * R_SOFTWARE_TILE_SIZE;
+		int32_t tile_x1 = Min(tile_x0 + R_SOFTWARE_TILE_SIZE, (int32_t)impl->width);
+		int32_t tile_y1 = Min(tile_y0 + R_SOFTWARE_TILE_SIZE, (int32_t)impl->height);
+
+		for (uint32_t item = impl->bin_offsets[tile]; item < impl->bin_offsets[tile + 1]; ++item) {
+			const R_Software_Triangle &triangle = impl->triangles[impl->bin_items[item]];
+
+			int32_t x0 = Max(tile_x0, triangle.min_x);
+			int32_t y0 = Max(tile_y0, triangle.min_y);
+			int32_t x1 = Min(tile_x1, triangle.max_x);
+			int32_t y1 = Min(tile_y1, triangle.max_y);
+
+			R_SoftwareRasterizeTriangle(impl, triangle, x0, y0, x1, y1);
+		}
+	}
+}
+
+static void R_SoftwareFlush(R_Backend2d_Software *impl) {
+	if (impl->triangles.count == 0)
+		return;
+
+	uint32_t tile_count = (uint32_t)(impl->tiles_x * impl->tiles_y);
+
+	if (!Resize(&impl->bin_offsets, tile_count + 1)) {
+		LogError("Software: Failed to allocate tile bins. Discarding pending triangles.");
+		Reset(&impl->triangles);
+		return;
+	}
+
+	memset(impl->bin_offsets.data, 0, ArrSizeInBytes(impl->bin_offsets));
+
+	// Bin the triangles into tiles, two passes so that the bins can be stored contiguously
+	for (const R_Software_Triangle &triangle : impl->triangles) {
+		for (int32_t ty = triangle.min_y / R_SOFTWARE_TILE_SIZE; ty <= (triangle.max_y - 1) / R_SOFTWARE_TILE_SIZE; ++ty) {
+			for (int32_t tx = triangle.min_x / R_SOFTWARE_TILE_SIZE; tx <= (triangle.max_x - 1) / R_SOFTWARE_TILE_SIZE; ++tx) {
+				impl->bin_offsets[ty * impl->tiles_x + tx + 1] += 1;
+			}
+		}
+	}
+
+	for (uint32_t tile = 0; tile < tile_count; ++tile) {
+		impl->bin_offsets[tile + 1] += impl->bin_offsets[tile];
+	}
+
+	if (!Resize(&impl->bin_items, impl->bin_offsets[tile_count])) {
+		LogError("Software: Failed to allocate tile bins. Discarding pending triangles.");
+		Reset(&impl->triangles);
+		return;
+	}
+
+	M_Arena *arena   = ThreadScratchpad();
+	M_Temporary temp = M_BeginTemporaryMemory(arena);
+	Defer{ M_EndTemporaryMemory(&temp); };
+
+	uint32_t *cursor = M_PushArray(arena, uint32_t, tile_count);
+	memcpy(cursor, impl->bin_offsets.data, sizeof(uint32_t) * tile_count);
+
+	for (uint32_t index = 0; index < (uint32_t)impl->triangles.count; ++index) {
+		const R_Software_Triangle &triangle = impl->triangles[index];
+		for (int32_t ty = triangle.min_y / R_SOFTWARE_TILE_SIZE; ty <= (triangle.max_y - 1) / R_SOFTWARE_TILE_SIZE; ++ty) {
+			for (int32_t tx = triangle.min_x / R_SOFTWARE_TILE_SIZE; tx <= (triangle.max_x - 1) / R_SOFTWARE_TILE_SIZE; ++tx) {
+				impl->bin_items[cursor[ty * impl->tiles_x + tx]++] = index;
+			}
+		}
+	}
+
+	J_ParallelFor(tile_count, 1, R_SoftwareRasterizeTiles, impl);
+
+	Reset(&impl->triangles);
+}
+
+//
+//
+//
+
+R_Backend2d *R_CreateSoftwareBackend2d(uint32_t width, uint32_t height) {
+	static bool Initialized = false;
+
+	if (!Initialized) {
+		for (int i = 0; i < 256; ++i) {
+			float c = (float)i / 255.0f;
+			SRGBToLinear[i] = c <= 0.04045f ? c / 12.92f : Pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		Initialized = true;
+	}
+
+	R_Backend2d_Software *impl = new R_Backend2d_Software;
+
+	impl->backend.CreateTexture       = CreateTextureSoftware;
+	impl->backend.CreateTextureSRGBA  = CreateTextureSRGBASoftware;
+	impl->backend.DestroyTexture      = DestroyTextureSoftware;
+	impl->backend.CreateFont          = CreateFontSoftware;
+	impl->backend.DestroyFont         = DestroyFontSoftware;
+	impl->backend.CreateGeometry      = CreateGeometrySoftware;
+	impl->backend.DestroyGeometry     = DestroyGeometrySoftware;
+
+	impl->backend.UploadVertexData    = UploadVertexDataSoftware;
+	impl->backend.UploadIndexData     = UploadIndexDataSoftware;
+	impl->backend.UploadInstanceData  = UploadInstanceDataSoftware;
+	impl->backend.UploadDrawData      = UploadDrawDataSoftware;
+	impl->backend.SetPipeline         = SetPipelineSoftware;
+	impl->backend.SetScissor          = SetScissorSoftware;
+	impl->backend.SetTexture          = SetTextureSoftware;
+	impl->backend.SetGeometry         = SetGeometrySoftware;
+	impl->backend.DrawTriangleList    = DrawTriangleListSoftware;
+	impl->backend.DrawInstancedQuads  = DrawInstancedQuadsSoftware;
+	impl->backend.DrawInstancedShapes = DrawInstancedShapesSoftware;
+
+	impl->backend.Release             = ReleaseSoftware;
+
+	impl->width     = 0;
+	impl->height    = 0;
+	impl->transform = Identity();
+	impl->scissor   = R_Rect(0.0f, 0.0f, 0.0f, 0.0f);
+	impl->texture   = nullptr;
+	impl->geometry  = nullptr;
+	impl->tiles_x   = 0;
+	impl->tiles_y   = 0;
+
+	R_SoftwareResizeTarget(&impl->backend, width, height);
+
+	return &impl->backend;
+}
+
+R_Renderer2d *R_CreateRenderer2dSoftware(uint32_t width, uint32_t height, const R_Specification2d &spec) {
+	R_Backend2d *backend = R_CreateSoftwareBackend2d(width, height);
+	return R_CreateRenderer2d(backend, spec);
+}
+
+void R_SoftwareResizeTarget(R_Backend2d *backend, uint32_t width, uint32_t height) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	R_SoftwareFlush(impl);
+
+	if (!Resize(&impl->pixels, (ptrdiff_t)width * height * 4)) {
+		LogError("Software: Failed to allocate framebuffer of size %x%", width, height);
+		width = height = 0;
+		Reset(&impl->pixels);
+	}
+
+	impl->width   = width;
+	impl->height  = height;
+	impl->tiles_x = (int32_t)((width + R_SOFTWARE_TILE_SIZE - 1) / R_SOFTWARE_TILE_SIZE);
+	impl->tiles_y = (int32_t)((height + R_SOFTWARE_TILE_SIZE - 1) / R_SOFTWARE_TILE_SIZE);
+
+	memset(impl->pixels.data, 0, ArrSizeInBytes(impl->pixels));
+}
+
+void R_SoftwareClearTarget(R_Backend2d *backend, Vec4 color) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	R_SoftwareFlush(impl);
+
+	uint8_t value[4];
+	for (int c = 0; c < 4; ++c)
+		value[c] = (uint8_t)(Clamp(0.0f, 1.0f, color.m[c]) * 255.0f + 0.5f);
+
+	uint8_t *dst = impl->pixels.data;
+	for (uint32_t index = 0; index < impl->width * impl->height; ++index, dst += 4) {
+		memcpy(dst, value, 4);
+	}
+}
+
+const uint8_t *R_SoftwareResolve(R_Backend2d *backend, uint32_t *width, uint32_t *height) {
+	R_Backend2d_Software *impl = (R_Backend2d_Software *)backend;
+
+	R_SoftwareFlush(impl);
+
+	*width  = impl->width;
+	*height = impl->height;
+
+	return impl->pixels.data;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "Render2d.h"
+
+// CPU implementation of R_Backend2d that rasterizes into an in-memory RGBA8 framebuffer
+// Pipelines are ignored, every draw is shaded as Quad.shader (texture * color, alpha blended) and shapes as Shape.shader
+// Draws are binned into tiles and rasterized on the worker threads when the target is resolved
+
+R_Backend2d * R_CreateSoftwareBackend2d(uint32_t width, uint32_t height);
+R_Renderer2d *R_CreateRenderer2dSoftware(uint32_t width, uint32_t height, const R_Specification2d &spec = Renderer2dDefaultSpec);
+
+void          R_SoftwareResizeTarget(R_Backend2d *backend, uint32_t width, uint32_t height);
+void          R_SoftwareClearTarget(R_Backend2d *backend, Vec4 color);
+
+// Rasterizes the pending draws, returned pixels are RGBA8 with the top row first
+// Pixels are valid until the next call to any of the R_Software* procedures
+const uint8_t *R_SoftwareResolve(R_Backend2d *backend, uint32_t *width, uint32_t *height);
@@ -33,6 +33,17 @@ enum R_Buffer_Flags {
 	R_BUFFER_CPU_WRITE_ACCESS = 0x2
 };
 
+// The first map of a buffer in every list must discard
+// Later maps in the same list may promise not to overwrite anything the list already uses
+enum R_Map_Type {
+	R_MAP_WRITE_DISCARD,
+	R_MAP_WRITE_NO_OVERWRITE,
+	_R_MAP_TYPE_COUNT
+};
+
+// Offset and size of constant buffer ranges must be multiples of this
+static constexpr uint32_t R_CONSTANT_BUFFER_RANGE_ALIGNMENT = 256;
+
 enum R_Shader {
 	R_SHADER_VERTEX,
 	R_SHADER_PIXEL,
@@ -52,6 +63,7 @@ enum R_Format {
 	R_FORMAT_RG32_FLOAT,
 	R_FORMAT_RG32_SINT,
 	R_FORMAT_RG32_UINT,
+	R_FORMAT_RG16_FLOAT,
 	R_FORMAT_RG8_UNORM,
 	R_FORMAT_R32_FLOAT,
 	R_FORMAT_R32_SINT,
@@ -340,7 +352,9 @@ void              R_DestroyBuffer(R_Buffer *buffer);
 R_Texture *       R_CreateTexture(R_Device *device, R_Format format, uint32_t width, uint32_t height, uint32_t pitch, const uint8_t *pixels, uint32_t flags);
 void              R_DestroyTexture(R_Texture *texture);
 
-void *            R_MapBuffer(R_List *list, R_Buffer *buffer);
+bool              R_SupportsConstantBufferRanges(R_Device *device);
+
+void *            R_MapBuffer(R_List *list, R_Buffer *buffer, R_Map_Type type = R_MAP_WRITE_DISCARD);
 void              R_UnmapBuffer(R_List *list, R_Buffer *buffer);
 
 void              R_ClearRenderTarget(R_List *list, R_Render_Target *render_target, const float color[4]);
@@ -348,6 +362,7 @@ void              R_BindPipeline(R_List *list, R_Pipeline *pipeline);
 void              R_BindVertexBuffers(R_List *list, R_Buffer **buffer, uint32_t *stride, uint32_t *offset, uint32_t location, uint32_t count);
 void              R_BindIndexBuffer(R_List *list, R_Buffer *buffer, R_Format format, uint32_t offset);
 void              R_BindConstantBuffers(R_List *list, R_Shader shader, R_Buffer **buffer, uint32_t location, uint32_t count);
+void              R_BindConstantBufferRange(R_List *list, R_Shader shader, R_Buffer *buffer, uint32_t location, uint32_t offset, uint32_t size);
 void              R_BindTextures(R_List *list, R_Texture **texture, uint32_t location, uint32_t count);
 void              R_BindRenderTargets(R_List *list, uint32_t count, R_Render_Target *render_targets[], R_Depth_Stencil *depth_stencil);
 void              R_SetPrimitiveTopology(R_List *list, R_Primitive_Topology topology);
@@ -355,3 +370,4 @@ void              R_SetViewports(R_List *list, R_Viewport *viewports, uint32_t c
 void              R_SetScissors(R_List *list, R_Scissor *scissors, uint32_t count);
 void              R_Draw(R_List *list, uint32_t vertex_count, uint32_t start_vertex_location);
 void              R_DrawIndexed(R_List *list, uint32_t index_count, uint32_t start_index_location, int32_t base_vertex_location);
+void              R_DrawInstanced(R_List *list, uint32_t vertex_count_per_instance, uint32_t instance_count, uint32_t start_vertex_location, uint32_t start_instance_location);
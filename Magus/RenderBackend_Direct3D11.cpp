@@ -107,6 +107,7 @@ static constexpr DXGI_FORMAT FormatMap[] = {
 	DXGI_FORMAT_R32G32_FLOAT,
 	DXGI_FORMAT_R32G32_SINT,
 	DXGI_FORMAT_R32G32_UINT,
+	DXGI_FORMAT_R16G16_FLOAT,
 	DXGI_FORMAT_R8G8_UNORM,
 	DXGI_FORMAT_R32_FLOAT,
 	DXGI_FORMAT_R32_SINT,
@@ -177,6 +178,9 @@ static constexpr D3D11_TEXTURE_ADDRESS_MODE TextureAddressModeMap[] = {
 };
 static_assert(ArrayCount(TextureAddressModeMap) == _R_TEXTURE_ADDRESS_MODE_COUNT, "");
 
+static constexpr D3D11_MAP MapTypeMap[] = { D3D11_MAP_WRITE_DISCARD, D3D11_MAP_WRITE_NO_OVERWRITE };
+static_assert(ArrayCount(MapTypeMap) == _R_MAP_TYPE_COUNT, "");
+
 static constexpr D3D11_INPUT_CLASSIFICATION ClassificationMap[] = { D3D11_INPUT_PER_VERTEX_DATA, D3D11_INPUT_PER_INSTANCE_DATA };
 static_assert(ArrayCount(ClassificationMap) == _R_INPUT_CLASSIFICATION_COUNT, "");
 
@@ -891,14 +895,25 @@ R_RENDER_API void R_DestroyTexture(R_Texture *texture) {
 	shader_resource_view->Release();
 }
 
-R_RENDER_API void *R_MapBuffer(R_List *list, R_Buffer *buffer) {
+R_RENDER_API bool R_SupportsConstantBufferRanges(R_Device *device) {
+	ID3D11Device1 *device1 = (ID3D11Device1 *)device;
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	HRESULT hresult = device1->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (FAILED(hresult))
+		return false;
+
+	return options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+}
+
+R_RENDER_API void *R_MapBuffer(R_List *list, R_Buffer *buffer, R_Map_Type type) {
 	ID3D11DeviceContext1 *deferred_context = (ID3D11DeviceContext1 *)list;
 
 	ID3D11Resource *resource = (ID3D11Resource *)buffer;
 
 	D3D11_MAPPED_SUBRESOURCE mapped;
 
-	HRESULT hresult = deferred_context->Map(resource, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	HRESULT hresult = deferred_context->Map(resource, 0, MapTypeMap[type], 0, &mapped);
 	if (SUCCEEDED(hresult)) {
 		return mapped.pData;
 	}
@@ -955,6 +970,24 @@ R_RENDER_API void R_BindConstantBuffers(R_List *list, R_Shader shader, R_Buffer
 		Unreachable();
 }
 
+R_RENDER_API void R_BindConstantBufferRange(R_List *list, R_Shader shader, R_Buffer *buffer, uint32_t location, uint32_t offset, uint32_t size) {
+	ID3D11DeviceContext1 *deferred_context = (ID3D11DeviceContext1 *)list;
+
+	Assert(offset % R_CONSTANT_BUFFER_RANGE_ALIGNMENT == 0);
+
+	// Ranges are given in number of shader constants, which are 16 bytes each
+	UINT first_constant = offset / 16;
+	UINT num_constants  = AlignPower2Up(size, R_CONSTANT_BUFFER_RANGE_ALIGNMENT) / 16;
+	ID3D11Buffer *buffer_handle = (ID3D11Buffer *)buffer;
+
+	if (shader == R_SHADER_VERTEX)
+		deferred_context->VSSetConstantBuffers1(location, 1, &buffer_handle, &first_constant, &num_constants);
+	else if (shader == R_SHADER_PIXEL)
+		deferred_context->PSSetConstantBuffers1(location, 1, &buffer_handle, &first_constant, &num_constants);
+	else
+		Unreachable();
+}
+
 R_RENDER_API void R_BindTextures(R_List *list, R_Texture **texture, uint32_t location, uint32_t count) {
 	ID3D11DeviceContext1 *deferred_context = (ID3D11DeviceContext1 *)list;
 	deferred_context->PSSetShaderResources(location, count, (ID3D11ShaderResourceView **)texture);
@@ -1040,3 +1073,8 @@ R_RENDER_API void R_DrawIndexed(R_List *list, uint32_t index_count, uint32_t sta
 	ID3D11DeviceContext1 *deferred_context = (ID3D11DeviceContext1 *)list;
 	deferred_context->DrawIndexed(index_count, start_index_location, (INT)base_vertex_location);
 }
+
+R_RENDER_API void R_DrawInstanced(R_List *list, uint32_t vertex_count_per_instance, uint32_t instance_count, uint32_t start_vertex_location, uint32_t start_instance_location) {
+	ID3D11DeviceContext1 *deferred_context = (ID3D11DeviceContext1 *)list;
+	deferred_context->DrawInstanced(vertex_count_per_instance, instance_count, start_vertex_location, start_instance_location);
+}
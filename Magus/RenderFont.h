@@ -13,11 +13,14 @@ struct R_Texture;
 
 struct R_Font {
 	float                    height;
+	float                    max_advance;  // widest advance, bounds a run of text without decoding it
+	Region                   glyph_bounds; // union of the glyph rects relative to the pen position
 	Array_View<uint16_t>     index;
 	Array_View<R_Font_Glyph> glyphs;
 	R_Font_Glyph *           replacement;
 	R_Texture *              texture;
 	void *                   _internal;
+	uint32_t                 generation;   // unique per loaded font, a font loaded at the address of a freed one never matches it
 };
 
 struct R_Font_File {
@@ -7,6 +7,7 @@
 #include "RenderBackend.h"
 
 #include <string.h>
+#include <atomic>
 
 struct R_Texture;
 
@@ -22,6 +23,8 @@ struct R_Font_Internal {
 	uint8_t *           pixels;
 };
 
+static std::atomic<uint32_t> FontGeneration = 0;
+
 R_Font *LoadFont(M_Arena *arena, const R_Font_Config &config, float height) {
 	int padding        = 1;
 	float oversample_h = 2;
@@ -192,8 +195,9 @@ R_Font *LoadFont(M_Arena *arena, const R_Font_Config &config, float height) {
 	mem += ArrSizeInBytes(font->glyphs);
 
 	font->_internal = mem;
-	font->height    = height;
-	font->texture   = nullptr;
+	font->height     = height;
+	font->texture    = nullptr;
+	font->generation = ++FontGeneration;
 
 	R_Font_Internal *_internal = (R_Font_Internal *)(font->_internal);
 	_internal->release_texture = nullptr;
@@ -268,6 +272,18 @@ R_Font *LoadFont(M_Arena *arena, const R_Font_Config &config, float height) {
 		font->replacement->uv = uv;
 	}
 
+	font->max_advance  = 0.0f;
+	font->glyph_bounds = Region(0.0f, 0.0f, 0.0f, 0.0f);
+
+	for (const R_Font_Glyph &glyph : font->glyphs) {
+		Region &bounds = font->glyph_bounds;
+		font->max_advance = Max(font->max_advance, glyph.advance);
+		bounds.min.x      = Min(bounds.min.x, glyph.offset.x);
+		bounds.min.y      = Min(bounds.min.y, glyph.offset.y);
+		bounds.max.x      = Max(bounds.max.x, glyph.offset.x + glyph.dimension.x);
+		bounds.max.y      = Max(bounds.max.y, glyph.offset.y + glyph.dimension.y);
+	}
+
 	if (rgba_pixels) {
 		uint8_t *dst_pixel = rgba_pixels;
 		uint8_t *src_pixel = gray_pixels;
@@ -317,6 +333,21 @@ bool UploadFontTexture(R_Device *device, R_Font *font) {
 	return false;
 }
 
+bool UploadFontTexture(R_Font *font, R_Texture *(*create)(void *context, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels), void (*release)(R_Texture *texture), void *context) {
+	R_Font_Internal *_internal = (R_Font_Internal *)font->_internal;
+
+	uint32_t n = (_internal->kind == R_FONT_TEXTURE_GRAYSCALE || _internal->kind == R_FONT_TEXTURE_SIGNED_DISTANCE_FIELD) ? 1 : 4;
+
+	font->texture = create(context, _internal->width, _internal->height, n, _internal->pixels);
+	if (font->texture) {
+		_internal->release_texture = release;
+		FreeFontTexturePixels(font);
+		return true;
+	}
+
+	return false;
+}
+
 void ReleaseFont(R_Font *font) {
 	FreeFontTexturePixels(font);
 
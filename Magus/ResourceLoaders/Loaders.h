@@ -16,4 +16,5 @@ void        ReleaseTexture(R_Texture *texture);
 R_Font *    LoadFont(M_Arena *arena, const R_Font_Config &config, float height);
 void        FreeFontTexturePixels(R_Font *font);
 bool        UploadFontTexture(R_Device *device, R_Font *font);
+bool        UploadFontTexture(R_Font *font, R_Texture *(*create)(void *context, uint32_t w, uint32_t h, uint32_t n, const uint8_t *pixels), void (*release)(R_Texture *texture), void *context);
 void        ReleaseFont(R_Font *font);
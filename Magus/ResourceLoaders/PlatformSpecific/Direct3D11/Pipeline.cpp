@@ -9,11 +9,22 @@
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "dxguid.lib")
 
+struct Shader_Input_Format {
+	String   semantic;
+	R_Format format;
+	uint32_t size;
+};
+
+static constexpr int MAX_SHADER_INPUT_FORMATS = 8;
+
 struct Shader_Header {
-	R_Blend         blend;
-	R_Depth_Stencil depth_stencil;
-	R_Rasterizer    rasterizer;
-	R_Sampler       sampler;
+	R_Blend             blend;
+	R_Depth_Stencil     depth_stencil;
+	R_Rasterizer        rasterizer;
+	R_Sampler           sampler;
+	bool                instanced;
+	Shader_Input_Format input_formats[MAX_SHADER_INPUT_FORMATS];
+	int                 input_format_count;
 };
 
 typedef void(*Parse_Shader_Header_Property_Value_Proc)(String property, String value, Shader_Header *header);
@@ -77,6 +88,10 @@ static void ParseFilterValue(String property, String value, Shader_Header *heade
 		LogWarning("HLSL: Expected \"linear\" or \"point\" but got \"%\" for property %. Ignoring...", value, property);
 }
 
+static void ParseInstancedValue(String property, String value, Shader_Header *header) {
+	header->instanced = ParseBoolean(property, value);
+}
+
 static void ParseShaderHeaderBlendIndexed(String property, int index, String value, Shader_Header *header) {
 	if (ParseBoolean(property, value)) {
 		header->blend.render_target[index].enable     = true;
@@ -93,18 +108,50 @@ static void ParseShaderHeaderBlend(String property, String value, Shader_Header
 }
 
 static const String HeaderPropertyList[] = {
-	"Depth", "Fill", "Cull", "Scissor", "FrontFace", "Filter",
+	"Depth", "Fill", "Cull", "Scissor", "FrontFace", "Filter", "Instanced",
 	"Blend0", "Blend1", "Blend2", "Blend3", "Blend4", "Blend5", "Blend6", "Blend7",
 };
 
 static const Parse_Shader_Header_Property_Value_Proc HeaderPropertyParse[] = {
-	ParseDepthValue, ParseFillValue, ParseCullValue, ParseScissorValue, ParseFrontFaceValue, ParseFilterValue,
+	ParseDepthValue, ParseFillValue, ParseCullValue, ParseScissorValue, ParseFrontFaceValue, ParseFilterValue, ParseInstancedValue,
 	ParseShaderHeaderBlend, ParseShaderHeaderBlend, ParseShaderHeaderBlend, ParseShaderHeaderBlend,
 	ParseShaderHeaderBlend, ParseShaderHeaderBlend, ParseShaderHeaderBlend, ParseShaderHeaderBlend,
 };
 
 static_assert(ArrayCount(HeaderPropertyList) == ArrayCount(HeaderPropertyParse), "");
 
+static const String InputFormatNames[] = { "rgba8_unorm", "rgba16_float", "rg16_float" };
+static const R_Format InputFormats[]    = { R_FORMAT_RGBA8_UNORM, R_FORMAT_RGBA16_FLOAT, R_FORMAT_RG16_FLOAT };
+static const uint32_t InputFormatSize[] = { 4, 8, 4 };
+
+static_assert(ArrayCount(InputFormatNames) == ArrayCount(InputFormats), "");
+static_assert(ArrayCount(InputFormatNames) == ArrayCount(InputFormatSize), "");
+
+// Input.SEMANTIC=format overrides the format that is otherwise derived from the shader's input signature,
+// the vertex shader still sees the converted values (e.g. rgba8_unorm is read as float4)
+static bool ParseInputFormat(String property, String value, Shader_Header *header) {
+	String semantic = RemovePrefix(property, 6); // removing Input.
+
+	if (header->input_format_count == MAX_SHADER_INPUT_FORMATS) {
+		LogError("HLSL: Too many input formats, maximum is %", MAX_SHADER_INPUT_FORMATS);
+		return false;
+	}
+
+	for (int i = 0; i < ArrayCount(InputFormatNames); ++i) {
+		if (value == InputFormatNames[i]) {
+			Shader_Input_Format *input = &header->input_formats[header->input_format_count++];
+			input->semantic = semantic;
+			input->format   = InputFormats[i];
+			input->size     = InputFormatSize[i];
+			return true;
+		}
+	}
+
+	LogError("HLSL: Unknown input format \"%\" for property %", value, property);
+
+	return false;
+}
+
 static bool ParseShaderHeaderField(String field, Shader_Header *header) {
 	String property, value;
 	if (!SplitString(field, '=', &property, &value)) {
@@ -115,6 +162,9 @@ static bool ParseShaderHeaderField(String field, Shader_Header *header) {
 	property = TrimString(property);
 	value    = TrimString(value);
 
+	if (StringStartsWith(property, "Input."))
+		return ParseInputFormat(property, value, header);
+
 	for (int i = 0; i < ArrayCount(HeaderPropertyList); ++i) {
 		if (property == HeaderPropertyList[i]) {
 			HeaderPropertyParse[i](HeaderPropertyList[i], value, header);
@@ -224,6 +274,10 @@ R_Pipeline *LoadPipeline(M_Arena *arena, R_Device *device, String content, Strin
 		D3D11_SIGNATURE_PARAMETER_DESC param_desc;
 		reflector->GetInputParameterDesc(i, &param_desc);
 
+		// System values like SV_VertexID are generated by the input assembler
+		if (param_desc.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
+
 		R_Input_Layout_Element *elem = Append(&input_elements);
 		if (!elem) {
 			LogError("HLSL: Could not create pipeline: %. Reason: Out of temporary memory.", path);
@@ -232,39 +286,58 @@ R_Pipeline *LoadPipeline(M_Arena *arena, R_Device *device, String content, Strin
 
 		elem->name                    = param_desc.SemanticName;
 		elem->index                   = param_desc.SemanticIndex;
-		elem->input                   = 0;
 		elem->offset                  = current_offset;
-		elem->classification          = R_INPUT_CLASSIFICATION_PER_VERTEX;
-		elem->instance_data_step_rate = 0;
 
+		// Instanced shaders read every input per instance from slot 1, leaving slot 0 to the per vertex data
+		if (header.instanced) {
+			elem->input                   = 1;
+			elem->classification          = R_INPUT_CLASSIFICATION_PER_INSTANCE;
+			elem->instance_data_step_rate = 1;
+		} else {
+			elem->input                   = 0;
+			elem->classification          = R_INPUT_CLASSIFICATION_PER_VERTEX;
+			elem->instance_data_step_rate = 0;
+		}
+
+		uint32_t size = 0;
 		if (param_desc.Mask == 1) {
 			if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elem->format = R_FORMAT_R32_UINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elem->format = R_FORMAT_R32_SINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elem->format = R_FORMAT_R32_FLOAT;
 			else Unreachable();
-			current_offset += sizeof(float) * 1;
+			size = sizeof(float) * 1;
 		} else if (param_desc.Mask <= 3) {
 			if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elem->format = R_FORMAT_RG32_UINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elem->format = R_FORMAT_RG32_SINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elem->format = R_FORMAT_RG32_FLOAT;
 			else Unreachable();
-			current_offset += sizeof(float) * 2;
+			size = sizeof(float) * 2;
 		} else if (param_desc.Mask <= 7) {
 			if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elem->format = R_FORMAT_RGB32_UINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elem->format = R_FORMAT_RGB32_SINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elem->format = R_FORMAT_RGB32_FLOAT;
 			else Unreachable();
-			current_offset += sizeof(float) * 3;
+			size = sizeof(float) * 3;
 		} else if (param_desc.Mask <= 15) {
 			if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elem->format = R_FORMAT_RGBA32_UINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elem->format = R_FORMAT_RGBA32_SINT;
 			else if (param_desc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elem->format = R_FORMAT_RGBA32_FLOAT;
 			else Unreachable();
-			current_offset += sizeof(float) * 4;
+			size = sizeof(float) * 4;
 		} else {
 			Unreachable();
 		}
 
+		for (int format_index = 0; format_index < header.input_format_count; ++format_index) {
+			const Shader_Input_Format &input = header.input_formats[format_index];
+			if (input.semantic == String(param_desc.SemanticName)) {
+				elem->format = input.format;
+				size         = input.size;
+				break;
+			}
+		}
+
+		current_offset += size;
 	}
 
 	R_Input_Layout input_layout = input_elements;
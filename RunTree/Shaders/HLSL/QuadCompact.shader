@@ -0,0 +1,36 @@
+[[Blend0=true, Depth=true, Fill=solid, Cull=none, Scissor=true, FrontFace=ccw, Filter=linear]]
+[[Input.TEXCOORD=rg16_float, Input.COLOR=rgba8_unorm]]
+
+// Vertex layout of Renderer2d built with KR_RENDER2D_COMPACT_VERTEX
+// Remove the TEXCOORD input format when KR_RENDER2D_COMPACT_FLOAT_TEXCOORD is also defined
+
+struct Vertex_Input {
+	float2 Position : POSITION;
+	float2 TexCoord : TEXCOORD;
+	float4 Color    : COLOR;
+};
+
+struct Vertex_Output {
+	float2 TexCoord : TEXCOORD;
+	float4 Color    : COLOR;
+	float4 Position : SV_Position;
+};
+
+cbuffer constants : register(b0) {
+	row_major float4x4 Transform;
+}
+
+Vertex_Output VertexMain(Vertex_Input vertex) {
+	Vertex_Output ouput;
+	ouput.Position = mul(Transform, float4(vertex.Position, 0.0f, 1.0f));
+	ouput.TexCoord = vertex.TexCoord;
+	ouput.Color = vertex.Color;
+	return ouput;
+}
+
+Texture2D    TexImage : register(t0);
+SamplerState Sampler  : register(s0);
+
+float4 PixelMain(Vertex_Output input) : SV_Target {
+	return TexImage.Sample(Sampler, input.TexCoord) * input.Color;
+}
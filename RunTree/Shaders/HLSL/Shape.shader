@@ -0,0 +1,89 @@
+[[Blend0=true, Depth=true, Fill=solid, Cull=none, Scissor=true, FrontFace=ccw, Filter=linear, Instanced=true]]
+
+// Layout must match R_Shape2d
+struct Instance_Input {
+	float2 Position  : POSITION;
+	float2 Dimension : DIMENSION;
+	float  Radius    : RADIUS;
+	uint2  Params    : PARAMS;    // angle | kind << 16, thickness | feather << 16
+	uint   Color     : COLOR;
+	uint   VertexId  : SV_VertexID;
+};
+
+struct Vertex_Output {
+	float2 Local                 : LOCAL;
+	nointerpolation float4 Shape : SHAPE;     // half extents, radius, thickness
+	nointerpolation uint   Kind  : KIND;
+	float4 Color                 : COLOR;
+	float4 Position              : SV_Position;
+};
+
+cbuffer constants : register(b0) {
+	row_major float4x4 Transform;
+}
+
+// Same corners and triangles as R_DrawRectCenteredRotated
+static const float2 Corners[6] = {
+	float2(-1.0f, -1.0f), float2(-1.0f, 1.0f), float2(1.0f, 1.0f),
+	float2(-1.0f, -1.0f), float2(1.0f, 1.0f), float2(1.0f, -1.0f),
+};
+
+static const uint ShapeKindEllipse = 1;
+
+Vertex_Output VertexMain(Instance_Input instance) {
+	float angle     = float(instance.Params.x & 0xffff) * (6.28318530718f / 65536.0f);
+	float thickness = f16tof32(instance.Params.y & 0xffff);
+	float feather   = f16tof32(instance.Params.y >> 16);
+
+	// The quad is grown so that the anti-aliased edge is not clipped
+	float2 local = Corners[instance.VertexId] * (instance.Dimension + feather);
+
+	float c = cos(angle);
+	float s = sin(angle);
+	float2 position = instance.Position + float2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+	uint4 color = uint4(instance.Color, instance.Color >> 8, instance.Color >> 16, instance.Color >> 24) & 0xff;
+
+	Vertex_Output ouput;
+	ouput.Position = mul(Transform, float4(position, 0.0f, 1.0f));
+	ouput.Local    = local;
+	ouput.Shape    = float4(instance.Dimension, instance.Radius, thickness);
+	ouput.Kind     = instance.Params.x >> 16;
+	ouput.Color    = float4(color) / 255.0f;
+	return ouput;
+}
+
+// Negative inside, the ellipse distance is approximate but exact on the boundary
+float ShapeDistance(float2 p, float4 shape, uint kind) {
+	float2 half_dim = shape.xy;
+	float  radius   = shape.z;
+	float  distance;
+
+	if (kind == ShapeKindEllipse) {
+		float k0 = length(p / half_dim);
+		float k1 = length(p / (half_dim * half_dim));
+		distance = k1 > 0.0f ? k0 * (k0 - 1.0f) / k1 : -min(half_dim.x, half_dim.y);
+	} else {
+		float2 q = abs(p) - half_dim + radius;
+		distance = length(max(q, 0.0f)) + min(max(q.x, q.y), 0.0f) - radius;
+	}
+
+	if (shape.w > 0.0f)
+		distance = abs(distance + 0.5f * shape.w) - 0.5f * shape.w;
+
+	return distance;
+}
+
+float4 PixelMain(Vertex_Output input) : SV_Target {
+	float distance = ShapeDistance(input.Local, input.Shape, input.Kind);
+
+	// Local units per pixel, same as the software backend
+	float2 dx    = ddx(input.Local);
+	float2 dy    = ddy(input.Local);
+	float  pixel = sqrt(abs(dx.x * dy.y - dx.y * dy.x));
+
+	float coverage = saturate(0.5f - distance / max(pixel, 1e-6f));
+	clip(coverage - 1.0f / 255.0f);
+
+	return float4(input.Color.rgb, input.Color.a * coverage);
+}
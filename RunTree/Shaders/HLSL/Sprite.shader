@@ -0,0 +1,54 @@
+[[Blend0=true, Depth=true, Fill=solid, Cull=none, Scissor=true, FrontFace=ccw, Filter=linear, Instanced=true]]
+
+// Layout must match R_Sprite2d
+struct Instance_Input {
+	float2 Position  : POSITION;
+	float2 Dimension : DIMENSION;
+	float  Angle     : ANGLE;
+	uint2  TexRect   : TEXRECT;
+	uint   Color     : COLOR;
+	uint   VertexId  : SV_VertexID;
+};
+
+struct Vertex_Output {
+	float2 TexCoord : TEXCOORD;
+	float4 Color    : COLOR;
+	float4 Position : SV_Position;
+};
+
+cbuffer constants : register(b0) {
+	row_major float4x4 Transform;
+}
+
+// Same corners and triangles as R_DrawRectCenteredRotated
+static const float2 Corners[6] = {
+	float2(-0.5f, -0.5f), float2(-0.5f, 0.5f), float2(0.5f, 0.5f),
+	float2(-0.5f, -0.5f), float2(0.5f, 0.5f), float2(0.5f, -0.5f),
+};
+
+Vertex_Output VertexMain(Instance_Input instance) {
+	float2 corner = Corners[instance.VertexId];
+	float2 offset = corner * instance.Dimension;
+
+	float c = cos(instance.Angle);
+	float s = sin(instance.Angle);
+	float2 position = instance.Position + float2(offset.x * c - offset.y * s, offset.x * s + offset.y * c);
+
+	float2 uv_min = float2(instance.TexRect.x & 0xffff, instance.TexRect.x >> 16) / 65535.0f;
+	float2 uv_max = float2(instance.TexRect.y & 0xffff, instance.TexRect.y >> 16) / 65535.0f;
+
+	uint4 color = uint4(instance.Color, instance.Color >> 8, instance.Color >> 16, instance.Color >> 24) & 0xff;
+
+	Vertex_Output ouput;
+	ouput.Position = mul(Transform, float4(position, 0.0f, 1.0f));
+	ouput.TexCoord = lerp(uv_min, uv_max, corner + 0.5f);
+	ouput.Color    = float4(color) / 255.0f;
+	return ouput;
+}
+
+Texture2D    TexImage : register(t0);
+SamplerState Sampler  : register(s0);
+
+float4 PixelMain(Vertex_Output input) : SV_Target {
+	return TexImage.Sample(Sampler, input.TexCoord) * input.Color;
+}